@@ -0,0 +1,177 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+//
+// Helpers shared by spedi-bench and spedi-accuracy.
+
+#pragma once
+
+#include <binutils/elf/elf++.hh>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+namespace bench {
+
+/*
+ * Phases print their progress to stdout. That output is discarded while
+ * measuring so that it does not interleave with the report.
+ */
+class StdoutSilencer {
+public:
+    StdoutSilencer() {
+        std::cout.flush();
+        fflush(stdout);
+        m_saved_fd = dup(STDOUT_FILENO);
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+
+    ~StdoutSilencer() {
+        std::cout.flush();
+        fflush(stdout);
+        dup2(m_saved_fd, STDOUT_FILENO);
+        close(m_saved_fd);
+    }
+
+    StdoutSilencer(const StdoutSilencer &src) = delete;
+    StdoutSilencer &operator=(const StdoutSilencer &src) = delete;
+
+private:
+    int m_saved_fd;
+};
+
+/*
+ * Maps the file at path. Errors are reported with path.
+ */
+inline bool openElf(const std::string &path, elf::elf &elf_file) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    elf_file = elf::elf(elf::create_mmap_loader(fd));
+    return true;
+}
+
+/*
+ * returns .text of an ARM file or nullptr. Errors are reported with name.
+ */
+inline const elf::section *findArmText
+    (const elf::elf &elf_file, const std::string &name) {
+    if (elf_file.get_hdr().machine != EM_ARM) {
+        std::cerr << name << ": Elf file architecture is not ARM!\n";
+        return nullptr;
+    }
+    auto &sec = elf_file.get_section(".text");
+    if (!sec.valid() || sec.size() == 0) {
+        std::cerr << name << ": .text section was not found!\n";
+        return nullptr;
+    }
+    return &sec;
+}
+
+/*
+ * Writes str as a quoted JSON string.
+ */
+inline void writeJsonString(std::ostream &out, const std::string &str) {
+    out << '"';
+    for (unsigned char c : str) {
+        switch (c) {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            case '\t':
+                out << "\\t";
+                break;
+            default:
+                if (c < 0x20) {
+                    char escape[8];
+                    snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    out << escape;
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+/*
+ * Reads a JSON string whose opening quote is at pos into str. Returns the
+ * position following the closing quote or std::string::npos if malformed.
+ * \u escapes beyond ASCII are not supported as writeJsonString does not
+ * produce them.
+ */
+inline size_t readJsonString
+    (const std::string &text, size_t pos, std::string &str) {
+    if (pos >= text.size() || text[pos] != '"') {
+        return std::string::npos;
+    }
+    str.clear();
+    for (++pos; pos < text.size(); ++pos) {
+        char c = text[pos];
+        if (c == '"') {
+            return pos + 1;
+        }
+        if (c != '\\') {
+            str += c;
+            continue;
+        }
+        if (++pos == text.size()) {
+            break;
+        }
+        switch (text[pos]) {
+            case 'n':
+                str += '\n';
+                break;
+            case 't':
+                str += '\t';
+                break;
+            case 'r':
+                str += '\r';
+                break;
+            case 'b':
+                str += '\b';
+                break;
+            case 'f':
+                str += '\f';
+                break;
+            case 'u': {
+                if (pos + 4 >= text.size()) {
+                    return std::string::npos;
+                }
+                auto code = std::strtoul
+                    (text.substr(pos + 1, 4).c_str(), nullptr, 16);
+                if (code > 0x7f) {
+                    return std::string::npos;
+                }
+                str += static_cast<char>(code);
+                pos += 4;
+                break;
+            }
+            default:
+                // '"', '\\', and '/' stand for themselves
+                str += text[pos];
+        }
+    }
+    return std::string::npos;
+}
+}
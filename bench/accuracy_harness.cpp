@@ -0,0 +1,538 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+//
+// Runs speculative disassembly and analysis of .text on a corpus of ARM
+// ELF files and scores the result against ground truth. Precision and
+// recall of code bytes and function entries are reported next to
+// throughput. Results can be compared with a baseline report; the
+// harness exits with 1 if a file got slower or less accurate than the
+// configured thresholds allow, or if the corpus and the baseline do not
+// list the same files. Regenerate the baseline after changing the corpus.
+//
+// Ground truth of a file is taken from, in order of preference,
+//  - a labels file next to it as written by synthetic-elf-gen,
+//  - mapping symbols and function symbols of .symtab,
+//  - functions of DWARF debug info.
+
+#include "BenchCommon.h"
+#include <binutils/elf/elf++.hh>
+#include <disasm/DwarfIndex.h>
+#include <disasm/ElfDisassembler.h>
+#include <disasm/analysis/SectionDisassemblyAnalyzerARM.h>
+#include <util/cmdline.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+
+using namespace disasm;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+enum ByteLabel : uint8_t {
+    kUnknown,
+    kCode,
+    kData
+};
+
+/*
+ * Ground truth of .text. Labels are indexed by offset into the section.
+ */
+struct GroundTruth {
+    std::string m_source;
+    std::vector<uint8_t> m_labels;
+    std::vector<addr_t> m_functions;
+};
+
+struct Score {
+    Score() : m_true_positives{0}, m_false_positives{0},
+              m_false_negatives{0} { }
+
+    double precision() const {
+        auto predicted = m_true_positives + m_false_positives;
+        return predicted == 0 ? 1.0
+                              : static_cast<double>(m_true_positives)
+                / predicted;
+    }
+
+    double recall() const {
+        auto actual = m_true_positives + m_false_negatives;
+        return actual == 0 ? 1.0
+                           : static_cast<double>(m_true_positives) / actual;
+    }
+
+    uint64_t m_true_positives;
+    uint64_t m_false_positives;
+    uint64_t m_false_negatives;
+};
+
+struct FileResult {
+    std::string m_file;
+    std::string m_truth_source;
+    size_t m_text_size;
+    double m_best_ns;
+    Score m_code;
+    Score m_functions;
+
+    double megabytesPerSecond() const {
+        return m_best_ns > 0 ? m_text_size / m_best_ns * 1e3 : 0;
+    }
+};
+
+void labelRange
+    (std::vector<uint8_t> &labels, addr_t sec_addr, addr_t start_addr,
+     addr_t end_addr, ByteLabel label) {
+    auto sec_end_addr = sec_addr + labels.size();
+    start_addr = std::max(start_addr, sec_addr);
+    end_addr = std::min(end_addr, sec_end_addr);
+    if (start_addr < end_addr) {
+        std::fill(labels.begin() + (start_addr - sec_addr),
+                  labels.begin() + (end_addr - sec_addr), label);
+    }
+}
+
+bool loadLabelsFile
+    (const std::string &path, const elf::section &sec, GroundTruth &truth) {
+    std::ifstream file{path};
+    if (!file) {
+        return false;
+    }
+    auto sec_addr = sec.get_hdr().addr;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields{line};
+        std::string kind;
+        addr_t start_addr, end_addr;
+        fields >> kind >> std::hex >> start_addr;
+        if (kind == "func") {
+            if (sec_addr <= start_addr
+                && start_addr < sec_addr + truth.m_labels.size()) {
+                truth.m_functions.push_back(start_addr);
+            }
+            continue;
+        }
+        fields >> end_addr;
+        labelRange(truth.m_labels, sec_addr, start_addr, end_addr,
+                   kind == "data" ? kData : kCode);
+    }
+    truth.m_source = "labels";
+    return true;
+}
+
+bool loadSymbols
+    (const elf::elf &elf_file, const elf::section &sec, GroundTruth &truth) {
+    const auto &sym_sec = elf_file.get_section(".symtab");
+    if (!sym_sec.valid()) {
+        return false;
+    }
+    auto sec_addr = sec.get_hdr().addr;
+    auto sec_end_addr = sec_addr + sec.get_hdr().size;
+    std::vector<std::pair<addr_t, ByteLabel>> mapping_symbols;
+    for (auto symbol : sym_sec.as_symtab()) {
+        auto &data = symbol.get_data();
+        auto name = symbol.get_name(nullptr);
+        addr_t addr = data.value & ~1U;
+        if (addr < sec_addr || addr >= sec_end_addr) {
+            continue;
+        }
+        if (data.type() == elf::stt::func) {
+            truth.m_functions.push_back(addr);
+        } else if (name[0] == '$' && name[1] != '\0' && name[2] == '\0') {
+            if (name[1] == 'a' || name[1] == 't') {
+                mapping_symbols.push_back({addr, kCode});
+            } else if (name[1] == 'd') {
+                mapping_symbols.push_back({addr, kData});
+            }
+        }
+    }
+    if (mapping_symbols.empty()) {
+        truth.m_functions.clear();
+        return false;
+    }
+    std::sort(mapping_symbols.begin(), mapping_symbols.end());
+    for (size_t i = 0; i < mapping_symbols.size(); ++i) {
+        auto end_addr = i + 1 < mapping_symbols.size()
+                        ? mapping_symbols[i + 1].first : sec_end_addr;
+        labelRange(truth.m_labels, sec_addr, mapping_symbols[i].first,
+                   end_addr, mapping_symbols[i].second);
+    }
+    truth.m_source = "symbols";
+    return true;
+}
+
+bool loadDebugInfo
+    (const elf::elf &elf_file, const elf::section &sec, GroundTruth &truth) {
+    DwarfIndex dwarf_index{&elf_file};
+    if (!dwarf_index.isAvailable()) {
+        return false;
+    }
+    auto sec_addr = sec.get_hdr().addr;
+    for (auto &function : dwarf_index.functions()) {
+        addr_t start_addr = function.m_start_addr & ~1U;
+        if (start_addr < sec_addr
+            || start_addr >= sec_addr + truth.m_labels.size()) {
+            continue;
+        }
+        truth.m_functions.push_back(start_addr);
+        // DWARF knows code only, literal pools are part of functions
+        labelRange(truth.m_labels, sec_addr, start_addr,
+                   function.m_end_addr, kCode);
+    }
+    truth.m_source = "dwarf";
+    return true;
+}
+
+bool loadGroundTruth
+    (const std::string &path, const elf::elf &elf_file,
+     const elf::section &sec, GroundTruth &truth) {
+    truth.m_labels.assign(sec.get_hdr().size, kUnknown);
+    truth.m_functions.clear();
+    if (!loadLabelsFile(path + ".labels", sec, truth)
+        && !loadSymbols(elf_file, sec, truth)
+        && !loadDebugInfo(elf_file, sec, truth)) {
+        return false;
+    }
+    std::sort(truth.m_functions.begin(), truth.m_functions.end());
+    truth.m_functions.erase(std::unique(truth.m_functions.begin(),
+                                        truth.m_functions.end()),
+                            truth.m_functions.end());
+    return true;
+}
+
+Score scoreCode
+    (const SectionDisassemblyAnalyzerARM &analyzer, const elf::section &sec,
+     const GroundTruth &truth) {
+    auto sec_addr = sec.get_hdr().addr;
+    std::vector<uint8_t> predicted(truth.m_labels.size(), 0);
+    for (auto node_iter = analyzer.getCFG().cbegin();
+         node_iter < analyzer.getCFG().cend(); ++node_iter) {
+        if ((*node_iter).isData()) {
+            continue;
+        }
+        addr_t start_addr = (*node_iter).getCandidateStartAddr();
+        if (start_addr == 0) {
+            start_addr = (*node_iter).maximalBlock()->addrOfFirstInst();
+        }
+        std::fill(predicted.begin() + (start_addr - sec_addr),
+                  predicted.begin()
+                      + ((*node_iter).maximalBlock()->endAddr() - sec_addr),
+                  1);
+    }
+    Score score;
+    for (size_t i = 0; i < predicted.size(); ++i) {
+        if (truth.m_labels[i] == kUnknown) {
+            continue;
+        }
+        bool is_code = truth.m_labels[i] == kCode;
+        if (predicted[i] != 0) {
+            is_code ? ++score.m_true_positives : ++score.m_false_positives;
+        } else if (is_code) {
+            ++score.m_false_negatives;
+        }
+    }
+    return score;
+}
+
+Score scoreFunctions
+    (const SectionDisassemblyAnalyzerARM &analyzer, const GroundTruth &truth) {
+    std::vector<addr_t> predicted;
+    for (auto &proc : analyzer.getCallGraph().getMainProcedures()) {
+        predicted.push_back(proc.entryAddr());
+    }
+    std::sort(predicted.begin(), predicted.end());
+    predicted.erase(std::unique(predicted.begin(), predicted.end()),
+                    predicted.end());
+    std::vector<addr_t> matched;
+    std::set_intersection(predicted.begin(), predicted.end(),
+                          truth.m_functions.begin(), truth.m_functions.end(),
+                          std::back_inserter(matched));
+    Score score;
+    score.m_true_positives = matched.size();
+    score.m_false_positives = predicted.size() - matched.size();
+    score.m_false_negatives = truth.m_functions.size() - matched.size();
+    return score;
+}
+
+bool evaluateFile
+    (const std::string &path, unsigned runs, FileResult &result) {
+    elf::elf elf_file;
+    if (!bench::openElf(path, elf_file)) {
+        return false;
+    }
+    auto text_sec = bench::findArmText(elf_file, path);
+    if (text_sec == nullptr) {
+        return false;
+    }
+    auto &sec = *text_sec;
+    GroundTruth truth;
+    if (!loadGroundTruth(path, elf_file, sec, truth)) {
+        std::cerr << path << ": no labels, mapping symbols, or debug info\n";
+        return false;
+    }
+    result.m_file = path;
+    result.m_truth_source = truth.m_source;
+    result.m_text_size = sec.size();
+    result.m_best_ns = 0;
+
+    ElfDisassembler disassembler{elf_file};
+    for (unsigned run = 0; run < runs; ++run) {
+        bench::StdoutSilencer silencer;
+        auto start = Clock::now();
+        auto sec_disasm = disassembler.disassembleSectionSpeculative(sec);
+        SectionDisassemblyAnalyzerARM analyzer{&elf_file, &sec_disasm};
+        analyzer.buildCFG();
+        analyzer.refineCFG();
+        analyzer.buildCallGraph();
+        double elapsed =
+            std::chrono::duration<double, std::nano>(Clock::now() - start)
+                .count();
+        if (run == 0 || elapsed < result.m_best_ns) {
+            result.m_best_ns = elapsed;
+        }
+        if (run == 0) {
+            // analysis is deterministic, scoring the first run suffices
+            result.m_code = scoreCode(analyzer, sec, truth);
+            result.m_functions = scoreFunctions(analyzer, truth);
+        }
+    }
+    return true;
+}
+
+void writeJson(std::ostream &out, const std::vector<FileResult> &results) {
+    out << std::setprecision(6) << std::fixed;
+    out << "{\n  \"files\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto &result = results[i];
+        // one file per line, read back by loadBaseline
+        out << "    {\"file\": ";
+        bench::writeJsonString(out, result.m_file);
+        out << ", \"truth\": \"" << result.m_truth_source << "\""
+            << ", \"text_bytes\": " << result.m_text_size
+            << ", \"best_ns\": " << result.m_best_ns
+            << ", \"mb_per_s\": " << result.megabytesPerSecond()
+            << ", \"code_precision\": " << result.m_code.precision()
+            << ", \"code_recall\": " << result.m_code.recall()
+            << ", \"function_precision\": "
+            << result.m_functions.precision()
+            << ", \"function_recall\": " << result.m_functions.recall()
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+struct BaselineEntry {
+    double m_best_ns;
+    double m_code_precision;
+    double m_code_recall;
+    double m_function_precision;
+    double m_function_recall;
+};
+
+/*
+ * looks up key starting at pos, i.e., after the file name which may
+ * contain anything.
+ */
+double readJsonNumber
+    (const std::string &line, size_t pos, const std::string &key) {
+    pos = line.find("\"" + key + "\": ", pos);
+    if (pos == std::string::npos) {
+        return 0;
+    }
+    return std::strtod(line.c_str() + pos + key.size() + 4, nullptr);
+}
+
+bool loadBaseline
+    (const std::string &path, std::map<std::string, BaselineEntry> &baseline) {
+    std::ifstream file{path};
+    if (!file) {
+        return false;
+    }
+    std::string line;
+    const std::string file_key = "{\"file\": ";
+    std::string name;
+    while (std::getline(file, line)) {
+        auto pos = line.find(file_key);
+        if (pos == std::string::npos) {
+            continue;
+        }
+        pos = bench::readJsonString(line, pos + file_key.size(), name);
+        if (pos == std::string::npos) {
+            return false;
+        }
+        baseline[name] = {readJsonNumber(line, pos, "best_ns"),
+                          readJsonNumber(line, pos, "code_precision"),
+                          readJsonNumber(line, pos, "code_recall"),
+                          readJsonNumber(line, pos, "function_precision"),
+                          readJsonNumber(line, pos, "function_recall")};
+    }
+    return true;
+}
+
+/*
+ * returns the number of violated thresholds and reports each of them.
+ */
+unsigned checkRegression
+    (const FileResult &result, const BaselineEntry &base,
+     double max_slowdown, double max_accuracy_drop) {
+    unsigned violations = 0;
+    auto check_accuracy = [&](const char *metric, double value, double ref) {
+        if ((ref - value) * 100 > max_accuracy_drop) {
+            std::cerr << result.m_file << ": " << metric << " dropped from "
+                << ref * 100 << "% to " << value * 100 << "%\n";
+            ++violations;
+        }
+    };
+    check_accuracy("code precision", result.m_code.precision(),
+                   base.m_code_precision);
+    check_accuracy("code recall", result.m_code.recall(), base.m_code_recall);
+    check_accuracy("function precision", result.m_functions.precision(),
+                   base.m_function_precision);
+    check_accuracy("function recall", result.m_functions.recall(),
+                   base.m_function_recall);
+    if (base.m_best_ns > 0
+        && result.m_best_ns > base.m_best_ns * (1 + max_slowdown / 100)) {
+        std::cerr << result.m_file << ": slowed down from "
+            << base.m_best_ns / 1e6 << " ms to " << result.m_best_ns / 1e6
+            << " ms\n";
+        ++violations;
+    }
+    return violations;
+}
+}
+
+int main(int argc, char **argv) {
+    cmdline::parser cmd_parser;
+    cmd_parser.add<std::string>("corpus", 'c',
+                                "File listing one ARM ELF path per line",
+                                true, "");
+    cmd_parser.add<unsigned>("runs", 'r',
+                             "Runs per file, the fastest one is reported",
+                             false, 3);
+    cmd_parser.add<std::string>("json", 'j',
+                                "Write results as JSON to given file",
+                                false, "");
+    cmd_parser.add<std::string>("baseline", 'b',
+                                "JSON results of a previous run to "
+                                    "compare with",
+                                false, "");
+    cmd_parser.add<double>("max-slowdown", 's',
+                           "Allowed slowdown against baseline in percent",
+                           false, 10);
+    cmd_parser.add<double>("max-accuracy-drop", 'a',
+                           "Allowed drop of precision or recall against "
+                               "baseline in percentage points",
+                           false, 0.5);
+    cmd_parser.add<double>("min-code-precision", '\0',
+                           "Minimum code precision in percent", false, 0);
+    cmd_parser.add<double>("min-code-recall", '\0',
+                           "Minimum code recall in percent", false, 0);
+    cmd_parser.add<double>("min-function-recall", '\0',
+                           "Minimum function recall in percent", false, 0);
+    cmd_parser.parse_check(argc, argv);
+
+    auto runs = std::max(1U, cmd_parser.get<unsigned>("runs"));
+    std::ifstream corpus_file{cmd_parser.get<std::string>("corpus")};
+    if (!corpus_file) {
+        std::cerr << cmd_parser.get<std::string>("corpus")
+            << ": could not be read\n";
+        return 2;
+    }
+    std::map<std::string, BaselineEntry> baseline;
+    auto baseline_path = cmd_parser.get<std::string>("baseline");
+    if (!baseline_path.empty() && !loadBaseline(baseline_path, baseline)) {
+        std::cerr << baseline_path << ": could not be read\n";
+        return 2;
+    }
+
+    std::vector<FileResult> results;
+    std::string path;
+    while (std::getline(corpus_file, path)) {
+        if (path.empty() || path[0] == '#') {
+            continue;
+        }
+        FileResult result;
+        if (!evaluateFile(path, runs, result)) {
+            return 2;
+        }
+        results.push_back(result);
+    }
+
+    std::cout << std::left << std::setw(40) << "file"
+        << std::right << std::setw(10) << "truth"
+        << std::setw(10) << "MB/s"
+        << std::setw(10) << "code P"
+        << std::setw(10) << "code R"
+        << std::setw(10) << "func P"
+        << std::setw(10) << "func R" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    unsigned violations = 0;
+    auto min_code_precision = cmd_parser.get<double>("min-code-precision");
+    auto min_code_recall = cmd_parser.get<double>("min-code-recall");
+    auto min_function_recall = cmd_parser.get<double>("min-function-recall");
+    for (auto &result : results) {
+        std::cout << std::left << std::setw(40) << result.m_file
+            << std::right << std::setw(10) << result.m_truth_source
+            << std::setw(10) << result.megabytesPerSecond()
+            << std::setw(10) << result.m_code.precision() * 100
+            << std::setw(10) << result.m_code.recall() * 100
+            << std::setw(10) << result.m_functions.precision() * 100
+            << std::setw(10) << result.m_functions.recall() * 100 << "\n";
+        if (result.m_code.precision() * 100 < min_code_precision
+            || result.m_code.recall() * 100 < min_code_recall
+            || result.m_functions.recall() * 100 < min_function_recall) {
+            std::cerr << result.m_file << ": below minimum accuracy\n";
+            ++violations;
+        }
+        if (baseline_path.empty()) {
+            continue;
+        }
+        auto base_iter = baseline.find(result.m_file);
+        if (base_iter == baseline.end()) {
+            std::cerr << result.m_file << ": not in baseline\n";
+            ++violations;
+            continue;
+        }
+        violations += checkRegression
+            (result, base_iter->second,
+             cmd_parser.get<double>("max-slowdown"),
+             cmd_parser.get<double>("max-accuracy-drop"));
+    }
+    if (!baseline_path.empty()) {
+        std::set<std::string> evaluated;
+        for (auto &result : results) {
+            evaluated.insert(result.m_file);
+        }
+        for (auto &entry : baseline) {
+            if (evaluated.find(entry.first) == evaluated.end()) {
+                std::cerr << entry.first
+                    << ": in baseline but not in corpus\n";
+                ++violations;
+            }
+        }
+    }
+
+    auto json_path = cmd_parser.get<std::string>("json");
+    if (!json_path.empty()) {
+        std::ofstream json_file{json_path};
+        writeJson(json_file, results);
+        if (!json_file) {
+            std::cerr << json_path << ": could not be written\n";
+            return 2;
+        }
+    }
+    return violations == 0 ? 0 : 1;
+}
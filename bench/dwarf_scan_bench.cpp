@@ -0,0 +1,127 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+//
+// Compares the serial DIE traversal of dwarf++ against the parallel
+// compilation unit scan. Each run uses a fresh dwarf object so that no
+// lazily built state is reused between runs.
+
+#include <binutils/elf/elf++.hh>
+#include <binutils/dwarf/dwarf++.hh>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct ScanResult {
+    size_t m_die_count;
+    // order sensitive hash of DIE offsets
+    size_t m_hash;
+};
+
+static void hashOffset(ScanResult &result, dwarf::section_offset offset) {
+    result.m_die_count++;
+    result.m_hash = result.m_hash * 31 + offset;
+}
+
+static void traverse(const dwarf::die &node, ScanResult &result) {
+    hashOffset(result, node.get_unit_offset());
+    for (auto &child : node) {
+        traverse(child, result);
+    }
+}
+
+static ScanResult serialTraversal(const elf::elf &elf_file) {
+    dwarf::dwarf dw(dwarf::elf::create_loader(elf_file));
+    ScanResult result{0, 0};
+    for (auto &unit : dw.compilation_units()) {
+        traverse(unit.root(), result);
+    }
+    return result;
+}
+
+static ScanResult parallelScan(const elf::elf &elf_file, unsigned threads) {
+    dwarf::dwarf dw(dwarf::elf::create_loader(elf_file));
+    dw.scan_units(threads);
+    ScanResult result{0, 0};
+    for (auto &unit : dw.compilation_units()) {
+        for (auto offset : unit.die_offsets()) {
+            hashOffset(result, offset);
+        }
+    }
+    return result;
+}
+
+/*
+ * returns the best time of given runs in milliseconds.
+ */
+static double measure
+    (unsigned runs,
+     const std::function<ScanResult()> &scan,
+     ScanResult &result) {
+    double best = 0;
+    for (unsigned i = 0; i < runs; ++i) {
+        auto start = Clock::now();
+        result = scan();
+        std::chrono::duration<double, std::milli> time = Clock::now() - start;
+        if (i == 0 || time.count() < best) {
+            best = time.count();
+        }
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0]
+            << " ELF-file [thread-count] [runs]\n";
+        return 2;
+    }
+    unsigned threads = argc > 2 ? std::stoul(argv[2])
+                                : std::thread::hardware_concurrency();
+    unsigned runs = argc > 3 ? std::stoul(argv[3]) : 5;
+    int fd = open(argv[1], O_RDONLY);
+    if (fd < 0) {
+        std::cerr << argv[1] << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+    elf::elf elf_file(elf::create_mmap_loader(fd));
+
+    ScanResult serial, scan_single, scan_parallel;
+    auto serial_time = measure
+        (runs, [&]() { return serialTraversal(elf_file); }, serial);
+    auto single_time = measure
+        (runs, [&]() { return parallelScan(elf_file, 1); }, scan_single);
+    auto parallel_time = measure
+        (runs, [&]() { return parallelScan(elf_file, threads); },
+         scan_parallel);
+
+    std::cout << "compilation units: "
+        << dwarf::dwarf(dwarf::elf::create_loader(elf_file))
+            .compilation_units().size()
+        << ", DIEs: " << serial.m_die_count << "\n";
+    std::cout << std::left
+        << std::setw(24) << "serial traversal:" << serial_time << " ms\n"
+        << std::setw(24) << "scan, 1 thread:" << single_time << " ms\n"
+        << std::setw(24)
+        << ("scan, " + std::to_string(threads) + " threads:")
+        << parallel_time << " ms\n";
+
+    if (serial.m_die_count != scan_parallel.m_die_count
+        || serial.m_hash != scan_single.m_hash
+        || serial.m_hash != scan_parallel.m_hash) {
+        std::cerr << "scan does not match serial traversal!\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,335 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+//
+// Measures decoding, maximal block building, and each analysis phase of
+// speculative disassembly separately. Results are reported per byte of
+// .text and per decoded instruction. Without an input file, a Thumb ELF
+// is generated by synthetic-elf-gen from a fixed seed so that runs are
+// comparable across machines, standard libraries, and revisions.
+
+#include "BenchCommon.h"
+#include <binutils/elf/elf++.hh>
+#include <disasm/ElfDisassembler.h>
+#include <disasm/ITBlockTracker.h>
+#include <disasm/MaximalBlockBuilder.h>
+#include <disasm/MCParser.h>
+#include <disasm/RawInstAnalyzer.h>
+#include <disasm/analysis/SectionDisassemblyAnalyzerARM.h>
+#include <SyntheticElfGenerator.h>
+#include <util/cmdline.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <unistd.h>
+#include <vector>
+
+using namespace disasm;
+using Clock = std::chrono::steady_clock;
+
+struct BenchResult {
+    std::string m_name;
+    std::vector<double> m_times_ns;
+    size_t m_bytes;
+    size_t m_insts;
+
+    double best() const {
+        return *std::min_element(m_times_ns.begin(), m_times_ns.end());
+    }
+
+    double median() const {
+        auto times = m_times_ns;
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+};
+
+static double elapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start)
+        .count();
+}
+
+/*
+ * Writes a Thumb only file of synthetic-elf-gen to an unlinked temporary
+ * file and returns its descriptor, or -1 on failure.
+ */
+static int generateSyntheticElf(uint64_t seed, uint32_t text_size) {
+    synthetic::Config config;
+    config.m_seed = seed;
+    config.m_text_size = text_size & ~3U;
+    // the decode and builder benchmarks decode .text as Thumb
+    config.m_arm_percent = 0;
+    if (!synthetic::isValidConfig(config)) {
+        return -1;
+    }
+    FILE *elf_tmp = tmpfile();
+    FILE *labels_file = fopen("/dev/null", "w");
+    int fd = -1;
+    if (elf_tmp != nullptr && labels_file != nullptr
+        && synthetic::generateElf(config, elf_tmp, labels_file)
+        && fflush(elf_tmp) == 0) {
+        fd = dup(fileno(elf_tmp));
+    }
+    if (elf_tmp != nullptr) {
+        fclose(elf_tmp);
+    }
+    if (labels_file != nullptr) {
+        fclose(labels_file);
+    }
+    return fd;
+}
+
+/*
+ * Decodes at every half-word like speculative disassembly does.
+ */
+static BenchResult benchDecode(const elf::section &sec, unsigned runs) {
+    BenchResult result{"mcparser_disasm", {}, sec.size(), 0};
+    auto code = static_cast<const uint8_t *>(sec.data());
+    addr_t start_addr = sec.get_hdr().addr;
+    addr_t end_addr = start_addr + sec.size();
+    MCParser parser;
+    parser.initialize(CS_ARCH_ARM, CS_MODE_THUMB, end_addr);
+    cs_insn *inst = cs_malloc(parser.handle());
+    for (unsigned run = 0; run < runs; ++run) {
+        size_t decoded = 0;
+        auto start = Clock::now();
+        for (addr_t addr = start_addr; addr < end_addr; addr += 2) {
+            if (parser.disasm(code + (addr - start_addr), 4, addr, inst)) {
+                ++decoded;
+            }
+        }
+        result.m_times_ns.push_back(elapsedNs(start));
+        result.m_insts = decoded;
+    }
+    cs_free(inst, 1);
+    return result;
+}
+
+/*
+ * Measures feeding valid instructions to the builder only. Instructions
+ * are decoded in batches outside of the measured time, so memory stays
+ * bounded regardless of the size of .text.
+ */
+static BenchResult benchBuilder(const elf::section &sec, unsigned runs) {
+    // valid instructions decoded ahead of feeding them to the builder
+    const size_t kBatchSize = 1024;
+    BenchResult result{"mb_builder", {}, sec.size(), 0};
+    auto code = static_cast<const uint8_t *>(sec.data());
+    addr_t start_addr = sec.get_hdr().addr;
+    addr_t end_addr = start_addr + sec.size();
+    MCParser parser;
+    parser.initialize(CS_ARCH_ARM, CS_MODE_THUMB, end_addr);
+    RawInstAnalyzer analyzer{ISAType::kThumb};
+    struct DecodedInst {
+        cs_insn *m_inst;
+        arm_cc m_it_condition;
+        bool m_is_branch;
+    };
+    std::vector<DecodedInst> batch(kBatchSize);
+    for (auto &decoded : batch) {
+        decoded.m_inst = cs_malloc(parser.handle());
+    }
+    for (unsigned run = 0; run < runs; ++run) {
+        ITBlockTracker it_tracker;
+        MaximalBlockBuilder mb_builder;
+        double elapsed_ns = 0;
+        size_t inst_count = 0;
+        addr_t addr = start_addr;
+        while (addr < end_addr) {
+            size_t count = 0;
+            for (; addr < end_addr && count < kBatchSize; addr += 2) {
+                auto inst = batch[count].m_inst;
+                if (!parser.disasm
+                    (code + (addr - start_addr), 4, addr, inst)) {
+                    it_tracker.trackFailure(addr);
+                    continue;
+                }
+                auto it_condition = it_tracker.track(inst);
+                if (!analyzer.isValid(inst)) {
+                    continue;
+                }
+                batch[count].m_it_condition = it_condition;
+                batch[count].m_is_branch = analyzer.isBranch(inst);
+                ++count;
+            }
+            auto start = Clock::now();
+            for (size_t i = 0; i < count; ++i) {
+                auto &decoded = batch[i];
+                if (decoded.m_is_branch) {
+                    mb_builder.appendBranch
+                        (decoded.m_inst, decoded.m_it_condition);
+                    mb_builder.build();
+                } else {
+                    mb_builder.append(decoded.m_inst, decoded.m_it_condition);
+                }
+            }
+            elapsed_ns += elapsedNs(start);
+            inst_count += count;
+        }
+        result.m_times_ns.push_back(elapsed_ns);
+        result.m_insts = inst_count;
+    }
+    for (auto &decoded : batch) {
+        cs_free(decoded.m_inst, 1);
+    }
+    return result;
+}
+
+/*
+ * Runs the whole pipeline per run on a fresh disassembly and times
+ * each phase.
+ */
+static std::vector<BenchResult> benchAnalysis
+    (elf::elf &elf_file, const elf::section &sec, unsigned runs) {
+    std::vector<BenchResult> results;
+    for (auto name : {"speculative_disasm",
+                      "build_cfg",
+                      "refine_nodes",
+                      "recover_switch_statements",
+                      "identify_pc_relative_load_data",
+                      "build_call_graph"}) {
+        results.push_back({name, {}, sec.size(), 0});
+    }
+    ElfDisassembler disassembler{elf_file};
+    for (unsigned run = 0; run < runs; ++run) {
+        bench::StdoutSilencer silencer;
+        auto start = Clock::now();
+        auto sec_disasm = disassembler.disassembleSectionSpeculative(sec);
+        results[0].m_times_ns.push_back(elapsedNs(start));
+        size_t inst_count = 0;
+        for (auto iter = sec_disasm.cbegin(); iter < sec_disasm.cend();
+             ++iter) {
+            inst_count += (*iter).instructionsCount();
+        }
+        for (auto &result : results) {
+            result.m_insts = inst_count;
+        }
+        SectionDisassemblyAnalyzerARM analyzer{&elf_file, &sec_disasm};
+        const std::function<void()> phases[] = {
+            [&]() { analyzer.buildCFG(); },
+            [&]() { analyzer.refineNodes(); },
+            [&]() { analyzer.recoverSwitchStatements(); },
+            [&]() { analyzer.identifyPCRelativeLoadData(); },
+            [&]() { analyzer.buildCallGraph(); }};
+        for (size_t i = 0; i < 5; ++i) {
+            start = Clock::now();
+            phases[i]();
+            results[i + 1].m_times_ns.push_back(elapsedNs(start));
+        }
+    }
+    return results;
+}
+
+static void writeJson
+    (std::ostream &out,
+     const std::string &input,
+     size_t text_size,
+     unsigned runs,
+     const std::vector<BenchResult> &results) {
+    out << std::setprecision(6) << std::fixed;
+    out << "{\n  \"input\": ";
+    bench::writeJsonString(out, input);
+    out << ",\n  \"text_bytes\": " << text_size << ",\n"
+        << "  \"runs\": " << runs << ",\n"
+        << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto &result = results[i];
+        out << "    {\"name\": \"" << result.m_name << "\""
+            << ", \"best_ns\": " << result.best()
+            << ", \"median_ns\": " << result.median()
+            << ", \"bytes\": " << result.m_bytes
+            << ", \"instructions\": " << result.m_insts
+            << ", \"ns_per_byte\": " << result.best() / result.m_bytes
+            << ", \"ns_per_instruction\": "
+            << (result.m_insts > 0 ? result.best() / result.m_insts : 0.0)
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char **argv) {
+    cmdline::parser cmd_parser;
+    cmd_parser.add<std::string>("file", 'f',
+                                "ARM ELF file to benchmark, a synthetic "
+                                    "Thumb file is generated otherwise",
+                                false, "");
+    cmd_parser.add<unsigned long long>("seed", 's',
+                                       "Seed of the synthetic file", false, 1);
+    cmd_parser.add<uint32_t>("size", 'n',
+                             "Size of synthetic .text in bytes",
+                             false, 1 << 20);
+    cmd_parser.add<unsigned>("runs", 'r', "Runs per benchmark", false, 5);
+    cmd_parser.add<std::string>("json", 'j',
+                                "Write results as JSON to given file",
+                                false, "");
+    cmd_parser.parse_check(argc, argv);
+
+    auto file_path = cmd_parser.get<std::string>("file");
+    auto runs = std::max(1U, cmd_parser.get<unsigned>("runs"));
+    std::string input;
+    elf::elf elf_file;
+    if (file_path.empty()) {
+        auto seed = cmd_parser.get<unsigned long long>("seed");
+        int fd = generateSyntheticElf(seed, cmd_parser.get<uint32_t>("size"));
+        if (fd < 0) {
+            std::cerr << "synthetic file could not be generated, "
+                "size must be at least " << synthetic::kMinTextSize << "\n";
+            return 1;
+        }
+        elf_file = elf::elf(elf::create_mmap_loader(fd));
+        input = "synthetic:" + std::to_string(seed);
+    } else {
+        if (!bench::openElf(file_path, elf_file)) {
+            return 1;
+        }
+        input = file_path;
+    }
+    auto text_sec = bench::findArmText(elf_file, input);
+    if (text_sec == nullptr) {
+        return 1;
+    }
+    auto &sec = *text_sec;
+
+    std::vector<BenchResult> results;
+    results.push_back(benchDecode(sec, runs));
+    results.push_back(benchBuilder(sec, runs));
+    for (auto &result : benchAnalysis(elf_file, sec, runs)) {
+        results.push_back(result);
+    }
+
+    std::cout << input << ", .text: " << sec.size() << " bytes, runs: "
+        << runs << "\n";
+    std::cout << std::left << std::setw(32) << "benchmark"
+        << std::right << std::setw(12) << "best ms"
+        << std::setw(12) << "median ms"
+        << std::setw(12) << "ns/byte"
+        << std::setw(12) << "ns/inst" << "\n";
+    std::cout << std::fixed << std::setprecision(3);
+    for (auto &result : results) {
+        std::cout << std::left << std::setw(32) << result.m_name
+            << std::right << std::setw(12) << result.best() / 1e6
+            << std::setw(12) << result.median() / 1e6
+            << std::setw(12) << result.best() / result.m_bytes
+            << std::setw(12)
+            << (result.m_insts > 0 ? result.best() / result.m_insts : 0.0)
+            << "\n";
+    }
+    auto json_path = cmd_parser.get<std::string>("json");
+    if (!json_path.empty()) {
+        std::ofstream json_file(json_path);
+        writeJson(json_file, input, sec.size(), runs, results);
+        if (!json_file) {
+            std::cerr << json_path << ": could not be written\n";
+            return 1;
+        }
+    }
+    return 0;
+}
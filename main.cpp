@@ -1,7 +1,17 @@
 #include "binutils/elf/elf++.hh"
 #include "disasm/ElfDisassembler.h"
+#include "disasm/DwarfIndex.h"
+#include "disasm/AnalysisBudget.h"
+#include "disasm/DecisionTrace.h"
+#include "disasm/Progress.h"
+#include "disasm/Stats.h"
+#include "disasm/analysis/NoReturnDatabase.h"
 #include "disasm/analysis/SectionDisassemblyAnalyzerARM.h"
+#include <csignal>
 #include <fcntl.h>
+#include <fstream>
+#include <memory>
+#include <unistd.h>
 #include <util/cmdline.h>
 
 struct ConfigConsts {
@@ -9,20 +19,63 @@ struct ConfigConsts {
     const std::string kNoSymbols;
     const std::string kSpeculative;
     const std::string kText;
+    const std::string kWindow;
+    const std::string kJobs;
+    const std::string kLines;
+    const std::string kLineCache;
+    const std::string kStats;
+    const std::string kStatsJson;
+    const std::string kPerf;
+    const std::string kPerfMarkers;
+    const std::string kTrace;
+    const std::string kProgress;
+    const std::string kProgressFile;
+    const std::string kTimeBudget;
+    const std::string kMemoryBudget;
+    const std::string kNodeBudget;
+    const std::string kPopulate;
+    const std::string kHugePages;
+    const std::string kNoReturnDb;
 
     ConfigConsts() : kFile{"file"},
                      kNoSymbols{"no-symbols"},
                      kSpeculative{"speculative"},
-                     kText{"text"} { }
+                     kText{"text"},
+                     kWindow{"window"},
+                     kJobs{"jobs"},
+                     kLines{"lines"},
+                     kLineCache{"line-cache"},
+                     kStats{"stats"},
+                     kStatsJson{"stats-json"},
+                     kPerf{"perf"},
+                     kPerfMarkers{"perf-markers"},
+                     kTrace{"trace"},
+                     kProgress{"progress"},
+                     kProgressFile{"progress-file"},
+                     kTimeBudget{"time-budget"},
+                     kMemoryBudget{"memory-budget"},
+                     kNodeBudget{"node-budget"},
+                     kPopulate{"populate"},
+                     kHugePages{"huge-pages"},
+                     kNoReturnDb{"noreturn-db"} { }
 };
 
+static disasm::AnalysisBudget *g_budget = nullptr;
+
+// a second signal terminates as usual
+static void cancelOnSignal(int signal_number) {
+    g_budget->cancel();
+    std::signal(signal_number, SIG_DFL);
+}
+
 int main(int argc, char **argv) {
     ConfigConsts config;
 
     cmdline::parser cmd_parser;
     cmd_parser.add<std::string>(config.kFile,
                                 'f',
-                                "Path to an ARM ELF file to be disassembled",
+                                "Path to an ARM ELF file to be disassembled, "
+                                    "'-' reads it from standard input",
                                 true,
                                 "");
     cmd_parser.add(config.kSpeculative, 's',
@@ -31,17 +84,211 @@ int main(int argc, char **argv) {
     cmd_parser.add(config.kText, 't',
                    "Disassemble .text section only");
 
+    cmd_parser.add<size_t>(config.kWindow,
+                           'w',
+                           "Analyze speculative disassembly of .text in "
+                               "windows of given size in bytes",
+                           false,
+                           0);
+
+    cmd_parser.add<unsigned>(config.kJobs,
+                             'j',
+                             "Number of threads used by symbol-driven "
+                                 "disassembly",
+                             false,
+                             1);
+
+    cmd_parser.add(config.kLines, 'l',
+                   "Annotate instructions with source lines from DWARF");
+
+    cmd_parser.add<std::string>(config.kLineCache,
+                                'c',
+                                "Sidecar file caching the line table used "
+                                    "by --lines",
+                                false,
+                                "");
+
+    cmd_parser.add(config.kStats, 'S',
+                   "Print phase timings, counters, and heap usage if "
+                       "compiled in, to standard error");
+
+    cmd_parser.add<std::string>(config.kStatsJson,
+                                'J',
+                                "Write phase timings and counters as JSON "
+                                    "to given file",
+                                false,
+                                "");
+
+    cmd_parser.add(config.kPerf, 'P',
+                   "Read hardware perf counters per phase, implies --stats "
+                       "unless --stats-json is given");
+
+    cmd_parser.add<std::string>(config.kPerfMarkers,
+                                'M',
+                                "Write phase begin and end markers with "
+                                    "monotonic timestamps to given file",
+                                false,
+                                "");
+
+    cmd_parser.add<std::string>(config.kTrace,
+                                'T',
+                                "Write a binary trace of analyzer decisions "
+                                    "to given file, compare traces with "
+                                    "trace-diff",
+                                false,
+                                "");
+
+    cmd_parser.add<unsigned>(config.kProgress,
+                             'p',
+                             "Report progress every given milliseconds to "
+                                 "standard error, 0 disables",
+                             false,
+                             0);
+
+    cmd_parser.add<std::string>(config.kProgressFile,
+                                'F',
+                                "Report progress as JSON to given status "
+                                    "file instead, every second unless "
+                                    "--progress is given",
+                                false,
+                                "");
+
+    cmd_parser.add<unsigned>(config.kTimeBudget,
+                             '\0',
+                             "Stop after given milliseconds and keep the "
+                                 "partial result, 0 is unlimited",
+                             false,
+                             0);
+
+    cmd_parser.add<unsigned>(config.kMemoryBudget,
+                             '\0',
+                             "Stop once given megabytes are in use and keep "
+                                 "the partial result, 0 is unlimited",
+                             false,
+                             0);
+
+    cmd_parser.add<size_t>(config.kNodeBudget,
+                           '\0',
+                           "Stop after decoding given number of maximal "
+                               "blocks and keep the partial result, 0 is "
+                               "unlimited",
+                           false,
+                           0);
+
+    cmd_parser.add(config.kPopulate, '\0',
+                   "Pre-fault all pages of the mapped file");
+
+    cmd_parser.add<unsigned>(config.kHugePages,
+                             '\0',
+                             "Map files of at least given megabytes on "
+                                 "transparent huge pages, 0 disables",
+                             false,
+                             0);
+
+    cmd_parser.add<std::string>(config.kNoReturnDb,
+                                '\0',
+                                "Add names of non-returning procedures read "
+                                    "from given file, one per line, to the "
+                                    "builtin ones",
+                                false,
+                                "");
+
     cmd_parser.parse_check(argc, argv);
 
     auto file_path = cmd_parser.get<std::string>(config.kFile);
+    auto stats_json_path = cmd_parser.get<std::string>(config.kStatsJson);
+    auto markers_path = cmd_parser.get<std::string>(config.kPerfMarkers);
+    bool perf = cmd_parser.exist(config.kPerf);
+    bool print_stats = cmd_parser.exist(config.kStats)
+        || (perf && stats_json_path.empty());
+#ifdef SPEDI_STATS
+    disasm::Stats::enable(print_stats || !stats_json_path.empty()
+                              || !markers_path.empty());
+    if (perf && !disasm::Stats::enablePerfCounters(true)) {
+        fprintf(stderr, "Perf counters are not available, "
+            "check /proc/sys/kernel/perf_event_paranoid\n");
+    }
+    if (!markers_path.empty()
+        && !disasm::Stats::setMarkerFile(markers_path)) {
+        fprintf(stderr, "%s: could not be written\n", markers_path.c_str());
+        return 1;
+    }
+#else
+    if (print_stats || !stats_json_path.empty() || !markers_path.empty()) {
+        fprintf(stderr, "Statistics were compiled out, "
+            "rebuild with SPEDI_STATS enabled\n");
+    }
+#endif
+    auto trace_path = cmd_parser.get<std::string>(config.kTrace);
+#ifdef SPEDI_TRACE
+    if (!trace_path.empty() && !disasm::DecisionTrace::open(trace_path)) {
+        fprintf(stderr, "%s: could not be written\n", trace_path.c_str());
+        return 1;
+    }
+#else
+    if (!trace_path.empty()) {
+        fprintf(stderr, "Decision trace was compiled out, "
+            "rebuild with SPEDI_TRACE enabled\n");
+    }
+#endif
 
-    int fd = open(file_path.c_str(), O_RDONLY);
-    if (fd < 0) {
-        fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+    auto progress_interval = cmd_parser.get<unsigned>(config.kProgress);
+    auto progress_path = cmd_parser.get<std::string>(config.kProgressFile);
+    std::unique_ptr<disasm::ProgressReporter> progress_reporter;
+    if (progress_interval > 0 || !progress_path.empty()) {
+        progress_reporter.reset(new disasm::ProgressReporter
+                                    (progress_interval > 0
+                                     ? progress_interval : 1000,
+                                     progress_path));
+    }
+
+    auto noreturn_path = cmd_parser.get<std::string>(config.kNoReturnDb);
+    disasm::NoReturnDatabase noreturn_db;
+    noreturn_db.addBuiltinNames();
+    if (!noreturn_path.empty() && !noreturn_db.loadFile(noreturn_path)) {
+        fprintf(stderr, "%s: could not be read\n", noreturn_path.c_str());
         return 1;
     }
+    noreturn_db.build();
+
+    // interrupting keeps the partial result as well
+    disasm::AnalysisBudget budget;
+    budget.setTimeLimit(std::chrono::milliseconds
+                            (cmd_parser.get<unsigned>(config.kTimeBudget)));
+    budget.setMemoryLimit
+        (static_cast<uint64_t>(cmd_parser.get<unsigned>(config.kMemoryBudget))
+             << 20);
+    budget.setNodeLimit(cmd_parser.get<size_t>(config.kNodeBudget));
+    g_budget = &budget;
+    std::signal(SIGINT, cancelOnSignal);
+    std::signal(SIGTERM, cancelOnSignal);
+    disasm::ScopedAnalysisBudget budget_scope{&budget};
 
-    elf::elf elf_file(elf::create_mmap_loader(fd));
+#ifdef SPEDI_STATS
+    // faults of a mapped file are taken while decoding rather than loading
+    auto faults_at_start = elf::get_page_fault_count();
+#endif
+    elf::elf elf_file;
+    {
+        SPEDI_PHASE(kElfLoad);
+        if (file_path == "-") {
+            // pipes can't be mapped, read only what is needed instead.
+            elf_file = elf::elf(elf::create_stream_loader(STDIN_FILENO));
+        } else {
+            int fd = open(file_path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+                return 1;
+            }
+            elf::mmap_loader_options loader_options;
+            loader_options.populate = cmd_parser.exist(config.kPopulate);
+            loader_options.hugepage_threshold =
+                static_cast<size_t>(cmd_parser.get<unsigned>
+                    (config.kHugePages)) << 20;
+            elf_file = elf::elf(elf::create_mmap_loader(fd, loader_options));
+            elf_file.advise_access();
+        }
+    }
 
     // We disassmble ARM/Thumb executables only
     if ((elf_file.get_hdr().machine) != EM_ARM) {
@@ -50,13 +297,36 @@ int main(int argc, char **argv) {
     }
 
     disasm::ElfDisassembler disassembler{elf_file};
+    // debug info is only parsed if requested
+    disasm::DwarfIndex dwarf_index{&elf_file};
+    if (cmd_parser.exist(config.kLines)) {
+        dwarf_index.setLineTableCache
+            (cmd_parser.get<std::string>(config.kLineCache));
+        disassembler.setLineTable(&dwarf_index.lineTable());
+    }
     if (cmd_parser.exist(config.kSpeculative)) {
         std::cout << "Speculative disassembly of file: "
             << file_path << "\n";
-        if (cmd_parser.exist(config.kText)) {
+        auto window_size = cmd_parser.get<size_t>(config.kWindow);
+        if (cmd_parser.exist(config.kText) && window_size > 0) {
+            auto &sec = elf_file.get_section(".text");
+            if (sec.valid()) {
+                disassembler.disassembleSectionSpeculative
+                    (sec, window_size,
+                     [&elf_file, &noreturn_db]
+                         (disasm::SectionDisassemblyARM &window) {
+                         disasm::SectionDisassemblyAnalyzerARM
+                             analyzer{&elf_file, &window};
+                         analyzer.setNoReturnDatabase(&noreturn_db);
+                         analyzer.buildCFG();
+                         analyzer.refineCFG();
+                     });
+            }
+        } else if (cmd_parser.exist(config.kText)) {
             auto result =
                 disassembler.disassembleSectionbyNameSpeculative(".text");
             disasm::SectionDisassemblyAnalyzerARM analyzer{&elf_file, &result};
+            analyzer.setNoReturnDatabase(&noreturn_db);
             analyzer.buildCFG();
             analyzer.refineCFG();
 //            disassembler.prettyPrintSectionCFG
@@ -71,8 +341,10 @@ int main(int argc, char **argv) {
         std::cout << "Disassembly using symbol table of file: "
             << file_path << "\n";
         if (cmd_parser.exist(config.kText)) {
-            auto result = disassembler.disassembleSectionbyName(".text");
+            auto result = disassembler.disassembleSectionbyName
+                (".text", cmd_parser.get<unsigned>(config.kJobs));
             disasm::SectionDisassemblyAnalyzerARM analyzer{&elf_file, &result};
+            analyzer.setNoReturnDatabase(&noreturn_db);
             analyzer.buildCFG();
             analyzer.refineCFG();
             disassembler.prettyPrintSectionCFG
@@ -84,5 +356,39 @@ int main(int argc, char **argv) {
             disassembler.disassembleCodeUsingSymbols();
     } else
         std::cout << "Symbol table was not found!!" << "\n";
+
+    // reports completion
+    progress_reporter.reset();
+#ifdef SPEDI_TRACE
+    if (!disasm::DecisionTrace::close()) {
+        fprintf(stderr, "%s: could not be written\n", trace_path.c_str());
+        return 1;
+    }
+#endif
+#ifdef SPEDI_STATS
+    auto stats = disasm::Stats::collect();
+    auto faults = elf::get_page_fault_count();
+    stats.setPageFaults
+        (static_cast<uint64_t>(faults.minor - faults_at_start.minor),
+         static_cast<uint64_t>(faults.major - faults_at_start.major));
+    if (print_stats) {
+        std::cout.flush();
+        stats.print(std::cerr);
+    }
+    if (!stats_json_path.empty()) {
+        std::ofstream json_file{stats_json_path};
+        stats.writeJson(json_file);
+        if (!json_file) {
+            fprintf(stderr, "%s: could not be written\n",
+                    stats_json_path.c_str());
+            return 1;
+        }
+    }
+#endif
+    if (budget.isExhausted()) {
+        fprintf(stderr, "Stopped early, %s, results are partial\n",
+                disasm::AnalysisBudget::nameOf(budget.status()));
+        return 4;
+    }
     return 0;
 }
@@ -130,6 +130,11 @@ resolve_type(DW_AT name, DW_FORM form)
                         return value::type::rangelist;
 
                 default:
+                        // Vendor extensions such as GNU location
+                        // views can't be interpreted, but are
+                        // skipped fine based on their form
+                        if (name >= DW_AT::lo_user)
+                                return value::type::invalid;
                         throw format_error("DW_FORM_sec_offset not expected for attribute " +
                                            to_string(name));
                 }
@@ -165,4 +170,29 @@ abbrev_entry::read(cursor *cur)
         return true;
 }
 
+void
+abbrev_table::read(cursor *cur)
+{
+        // Section 7.5.3
+        abbrev_entry entry;
+        abbrev_code highest = 0;
+        while (entry.read(cur)) {
+                map[entry.code] = entry;
+                if (entry.code > highest)
+                        highest = entry.code;
+        }
+
+        // Typically, abbrev codes are assigned linearly, so it's more
+        // space efficient and time efficient to store the table in a
+        // vector.  Convert to a vector if it's dense enough, by some
+        // rough estimate of "enough".
+        if (highest * 10 < map.size() * 15) {
+                // Move the map into the vector
+                vec.resize(highest + 1);
+                for (auto &entry : map)
+                        vec[entry.first] = move(entry.second);
+                map.clear();
+        }
+}
+
 DWARFPP_END_NAMESPACE
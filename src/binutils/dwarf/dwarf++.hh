@@ -34,6 +34,7 @@ class line_table;
 // Internal type forward-declarations
 struct section;
 struct abbrev_entry;
+struct abbrev_table;
 struct cursor;
 
 // XXX Audit for binary-compatibility
@@ -157,12 +158,33 @@ public:
          */
         const type_unit &get_type_unit(uint64_t type_signature) const;
 
+        /**
+         * Decode the abbrevs and DIE offsets of all compilation
+         * units using up to thread_count threads, or one thread per
+         * hardware thread if thread_count is 0.  Each abbrev table
+         * is decoded once and shared by all units referring to it.
+         * Afterwards, the DIEs of any unit can be read from several
+         * threads concurrently.  The result does not depend on
+         * thread_count.  If decoding fails, throws the error of the
+         * first failing unit.
+         */
+        void scan_units(unsigned thread_count = 0) const;
+
         /**
          * \internal Retrieve the specified section from this file.
-         * If the section does not exist, throws format_error.
+         * If the section does not exist, throws format_error.  This
+         * is safe to call from several threads.
          */
         std::shared_ptr<section> get_section(section_type type) const;
 
+        /**
+         * \internal Retrieve the abbrev table starting at the given
+         * offset of .debug_abbrev.  Tables are read at most once.
+         * This is safe to call from several threads.
+         */
+        std::shared_ptr<const abbrev_table>
+        get_abbrev_table(section_offset offset) const;
+
 private:
         struct impl;
         std::shared_ptr<impl> m;
@@ -234,6 +256,21 @@ public:
          */
         const die &root() const;
 
+        /**
+         * Return the unit-relative offsets of all DIEs in this unit
+         * in the order they appear, which is a pre-order traversal
+         * of the DIE tree.  Sibling list terminators are not
+         * included.  This is computed on first use by a linear scan
+         * that skips attribute values without decoding them.
+         */
+        const std::vector<section_offset> &die_offsets() const;
+
+        /**
+         * Return the DIE at the given unit-relative offset, such as
+         * one returned by die_offsets.
+         */
+        die get_die(section_offset offset) const;
+
         /**
          * \internal Return the data for this unit.
          */
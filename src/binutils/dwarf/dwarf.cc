@@ -1,5 +1,10 @@
 #include "internal.hh"
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 using namespace std;
 
 DWARFPP_BEGIN_NAMESPACE
@@ -24,6 +29,16 @@ struct dwarf::impl
         bool have_type_units;
 
         std::map<section_type, std::shared_ptr<section> > sections;
+
+        // Abbrev tables indexed by their .debug_abbrev offset
+        std::unordered_map<section_offset,
+                           std::shared_ptr<const abbrev_table> > abbrev_tables;
+
+        // Guard lazily loaded state shared between units.  The type
+        // units mutex is held while loading sections, so it is never
+        // acquired while holding the other one.
+        std::mutex mutex;
+        std::mutex type_units_mutex;
 };
 
 dwarf::dwarf(const std::shared_ptr<loader> &l)
@@ -72,6 +87,7 @@ dwarf::compilation_units() const
 const type_unit &
 dwarf::get_type_unit(uint64_t type_signature) const
 {
+        lock_guard<mutex> lock(m->type_units_mutex);
         if (!m->have_type_units) {
                 cursor tucur(get_section(section_type::types));
                 while (!tucur.end()) {
@@ -95,6 +111,7 @@ dwarf::get_section(section_type type) const
         if (type == section_type::abbrev)
                 return m->sec_abbrev;
 
+        lock_guard<mutex> lock(m->mutex);
         auto it = m->sections.find(type);
         if (it != m->sections.end())
                 return it->second;
@@ -108,6 +125,62 @@ dwarf::get_section(section_type type) const
         return m->sections[type];
 }
 
+std::shared_ptr<const abbrev_table>
+dwarf::get_abbrev_table(section_offset offset) const
+{
+        {
+                lock_guard<mutex> lock(m->mutex);
+                auto it = m->abbrev_tables.find(offset);
+                if (it != m->abbrev_tables.end())
+                        return it->second;
+        }
+
+        // Read outside the lock so that units using distinct tables
+        // don't serialize.  If another thread read the same table in
+        // the meantime, its copy wins.
+        auto table = make_shared<abbrev_table>();
+        cursor c(m->sec_abbrev, offset);
+        table->read(&c);
+
+        lock_guard<mutex> lock(m->mutex);
+        return m->abbrev_tables.emplace(offset, move(table)).first->second;
+}
+
+void
+dwarf::scan_units(unsigned thread_count) const
+{
+        if (!m)
+                return;
+        if (thread_count == 0)
+                thread_count = max(1u, thread::hardware_concurrency());
+
+        auto &units = m->compilation_units;
+        vector<exception_ptr> errors(units.size());
+        atomic<size_t> next(0);
+        auto worker = [&]() {
+                for (size_t i = next++; i < units.size(); i = next++) {
+                        try {
+                                units[i].root();
+                                units[i].die_offsets();
+                        } catch (...) {
+                                errors[i] = current_exception();
+                        }
+                }
+        };
+
+        vector<thread> threads;
+        for (unsigned i = 1; i < thread_count && i < units.size(); i++)
+                threads.emplace_back(worker);
+        worker();
+        for (auto &t : threads)
+                t.join();
+
+        // Report errors independent of scheduling
+        for (auto &error : errors)
+                if (error)
+                        rethrow_exception(error);
+}
+
 //////////////////////////////////////////////////////////////////
 // class unit
 //
@@ -133,12 +206,12 @@ struct unit::impl
         // Lazily constructed line table
         line_table lt;
 
-        // Map from abbrev code to abbrev.  If the map is dense, it
-        // will be stored in the vector; otherwise it will be stored
-        // in the map.
-        bool have_abbrevs;
-        std::vector<abbrev_entry> abbrevs_vec;
-        std::unordered_map<abbrev_code, abbrev_entry> abbrevs_map;
+        // Abbrevs of this unit, possibly shared with other units
+        std::shared_ptr<const abbrev_table> abbrevs;
+
+        // Lazily computed offsets of all DIEs
+        bool have_die_offsets;
+        std::vector<section_offset> die_offsets;
 
         impl(const dwarf &file, section_offset offset,
              const std::shared_ptr<section> &subsec,
@@ -147,7 +220,7 @@ struct unit::impl
                 : file(file), offset(offset), subsec(subsec),
                   debug_abbrev_offset(debug_abbrev_offset),
                   root_offset(root_offset), type_signature(type_signature),
-                  type_offset(type_offset), have_abbrevs(false) { }
+                  type_offset(type_offset), have_die_offsets(false) { }
 
         void force_abbrevs();
 };
@@ -179,6 +252,37 @@ unit::root() const
         return m->root;
 }
 
+const std::vector<section_offset> &
+unit::die_offsets() const
+{
+        if (!m->have_die_offsets) {
+                m->force_abbrevs();
+                // DIEs are stored in pre-order, so a linear scan
+                // visits all of them without following the tree.
+                cursor cur(m->subsec, m->root_offset);
+                while (!cur.end()) {
+                        section_offset offset = cur.get_section_offset();
+                        abbrev_code acode = cur.uleb128();
+                        if (acode == 0)
+                                continue;
+                        m->die_offsets.push_back(offset);
+                        for (auto &attr : get_abbrev(acode).attributes)
+                                cur.skip_form(attr.form);
+                }
+                m->have_die_offsets = true;
+        }
+        return m->die_offsets;
+}
+
+die
+unit::get_die(section_offset offset) const
+{
+        m->force_abbrevs();
+        die d(this);
+        d.read(offset);
+        return d;
+}
+
 const std::shared_ptr<section> &
 unit::data() const
 {
@@ -188,59 +292,24 @@ unit::data() const
 const abbrev_entry &
 unit::get_abbrev(abbrev_code acode) const
 {
-        if (!m->have_abbrevs)
+        if (!m->abbrevs)
                 m->force_abbrevs();
 
-        if (!m->abbrevs_vec.empty()) {
-                if (acode >= m->abbrevs_vec.size())
-                        goto unknown;
-                const abbrev_entry &entry = m->abbrevs_vec[acode];
-                if (entry.code == 0)
-                        goto unknown;
-                return entry;
-        } else {
-                auto it = m->abbrevs_map.find(acode);
-                if (it == m->abbrevs_map.end())
-                        goto unknown;
-                return it->second;
-        }
-
-unknown:
-        throw format_error("unknown abbrev code 0x" + to_hex(acode));
+        const abbrev_entry *entry = m->abbrevs->get(acode);
+        if (!entry)
+                throw format_error("unknown abbrev code 0x" + to_hex(acode));
+        return *entry;
 }
 
 void
 unit::impl::force_abbrevs()
 {
-        // XXX Compilation units can share abbrevs.  Parse each table
-        // at most once.
-        if (have_abbrevs)
+        if (abbrevs)
                 return;
 
-        // Section 7.5.3
-        cursor c(file.get_section(section_type::abbrev),
-                 debug_abbrev_offset);
-        abbrev_entry entry;
-        abbrev_code highest = 0;
-        while (entry.read(&c)) {
-                abbrevs_map[entry.code] = entry;
-                if (entry.code > highest)
-                        highest = entry.code;
-        }
-
-        // Typically, abbrev codes are assigned linearly, so it's more
-        // space efficient and time efficient to store the table in a
-        // vector.  Convert to a vector if it's dense enough, by some
-        // rough estimate of "enough".
-        if (highest * 10 < abbrevs_map.size() * 15) {
-                // Move the map into the vector
-                abbrevs_vec.resize(highest + 1);
-                for (auto &entry : abbrevs_map)
-                        abbrevs_vec[entry.first] = move(entry.second);
-                abbrevs_map.clear();
-        }
-
-        have_abbrevs = true;
+        // Compilation units can share abbrevs, the file reads each
+        // table at most once.
+        abbrevs = file.get_abbrev_table(debug_abbrev_offset);
 }
 
 //////////////////////////////////////////////////////////////////
@@ -213,6 +213,37 @@ struct abbrev_entry
         bool read(cursor *cur);
 };
 
+/**
+ * The abbrevs of one table in .debug_abbrev.  Tables are immutable
+ * once read, so units using the same table share it.
+ */
+struct abbrev_table
+{
+        // If the abbrev codes are dense, abbrevs are stored in the
+        // vector indexed by code; otherwise they are stored in the
+        // map.
+        std::vector<abbrev_entry> vec;
+        std::unordered_map<abbrev_code, abbrev_entry> map;
+
+        void read(cursor *cur);
+
+        /**
+         * Return the abbrev for acode or nullptr if there is none.
+         */
+        const abbrev_entry *get(abbrev_code acode) const
+        {
+                if (!vec.empty()) {
+                        if (acode >= vec.size() || vec[acode].code == 0)
+                                return nullptr;
+                        return &vec[acode];
+                }
+                auto it = map.find(acode);
+                if (it == map.end())
+                        return nullptr;
+                return &it->second;
+        }
+};
+
 /**
  * A section header in .debug_pubnames or .debug_pubtypes.
  */
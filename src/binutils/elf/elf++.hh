@@ -7,6 +7,7 @@
 #include <cstddef>
 #include <memory>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 ELFPP_BEGIN_NAMESPACE
@@ -21,6 +22,20 @@ class segment;
 
 // XXX Segments, other section types
 
+/**
+ * Expected access pattern of a range of an ELF file.
+ */
+enum class access_pattern
+{
+        normal,
+        // read once from start to end, e.g., a linear sweep over code
+        sequential,
+        // small reads at scattered offsets, e.g., symbol lookups
+        random,
+        // the range will be read soon and should be prefetched
+        will_need,
+};
+
 /**
  * An exception indicating malformed ELF data.
  */
@@ -82,6 +97,13 @@ public:
          */
         std::shared_ptr<loader> get_loader() const;
 
+        /**
+         * Pass access hints of sections to the loader.  Code is read
+         * sequentially while symbol, string, and relocation tables are
+         * read at random.
+         */
+        void advise_access() const;
+
         /**
          * Return the segments in this file.
          */
@@ -108,6 +130,17 @@ public:
          * is found, return an invalid section.
          */
         const section &get_section(unsigned index) const;
+
+        /**
+         * Return the allocated executable sections in this file.
+         */
+        const std::vector<section> &executable_sections() const;
+
+        /**
+         * Return the address range [start, end) spanned by executable
+         * sections.  Start is UINT64_MAX and end is 0 if there is none.
+         */
+        std::pair<Elf64::Addr, Elf64::Addr> executable_range() const;
 private:
         struct impl;
         std::shared_ptr<impl> m;
@@ -129,6 +162,27 @@ public:
          * (including a premature EOF), it must throw an exception.
          */
         virtual const void *load(off_t offset, size_t size) = 0;
+
+        /**
+         * Hint the expected access pattern of the given file range.
+         * Loaders that can't make use of hints ignore them.
+         */
+        virtual void advise(off_t offset, size_t size, access_pattern pattern)
+        {
+        }
+};
+
+/**
+ * Options of the mmap-based loader.
+ */
+struct mmap_loader_options
+{
+        // Pre-fault all pages of the file when mapping it (MAP_POPULATE).
+        bool populate = false;
+        // Files of at least this size are mapped at a huge page
+        // boundary and advised to use transparent huge pages.  Zero
+        // disables huge pages.
+        size_t hugepage_threshold = 0;
 };
 
 /**
@@ -137,6 +191,39 @@ public:
  * descriptor if it intends to continue using it.
  */
 std::shared_ptr<loader> create_mmap_loader(int fd);
+std::shared_ptr<loader> create_mmap_loader(int fd,
+                                           const mmap_loader_options &opts);
+
+/**
+ * A loader that serves data directly from a caller-owned memory
+ * buffer without copying.  The buffer must remain valid and unchanged
+ * as long as the loader is live.
+ */
+std::shared_ptr<loader> create_memory_loader(const void *data, size_t size);
+
+/**
+ * A loader that reads from a non-seekable file descriptor such as a
+ * pipe.  Data is read on demand up to the end of the furthest range
+ * requested so far and kept in memory, hence, data beyond the last
+ * needed section is never read.  Note that section headers usually
+ * sit at the end of a file, so in practice the whole stream is read
+ * and buffered when the elf is opened.  A request spanning several
+ * reads is served from a joined copy that is kept until the loader is
+ * destroyed.  This will close fd when done.
+ */
+std::shared_ptr<loader> create_stream_loader(int fd);
+
+/**
+ * Page faults incurred by this process so far.  Useful to measure
+ * cold-cache performance of loaders.
+ */
+struct page_fault_count
+{
+        long minor;
+        long major;
+};
+
+page_fault_count get_page_fault_count();
 
 /**
  * An exception indicating that a section is not of the requested type.
@@ -1,5 +1,8 @@
 #include "elf++.hh"
 
+#include <cstdint>
+#include <unordered_map>
+
 using namespace std;
 
 ELFPP_BEGIN_NAMESPACE
@@ -45,6 +48,11 @@ struct elf::impl
         vector<section> sections;
         vector<segment> segments;
 
+        // Built once at load time for allocation-free lookups
+        unordered_map<string, unsigned> section_indices;
+        vector<section> executable_sections;
+        pair<Elf64::Addr, Elf64::Addr> executable_range;
+
         section invalid_section;
 };
 
@@ -103,6 +111,22 @@ elf::elf(const std::shared_ptr<loader> &l)
                 // isn't super-cheap.
                 m->sections.push_back(section(*this, sec));
         }
+
+        // Index sections by name and cache executable ones
+        m->executable_range = make_pair(UINT64_MAX, (Elf64::Addr)0);
+        for (unsigned i = 0; i < m->sections.size(); i++) {
+                auto &sec = m->sections[i];
+                // The first section of a given name wins
+                m->section_indices.emplace(sec.get_name(nullptr), i);
+                if (!sec.is_alloc() || !sec.is_exec())
+                        continue;
+                m->executable_sections.push_back(sec);
+                auto &hdr = sec.get_hdr();
+                if (hdr.addr < m->executable_range.first)
+                        m->executable_range.first = hdr.addr;
+                if (m->executable_range.second < hdr.addr + hdr.size)
+                        m->executable_range.second = hdr.addr + hdr.size;
+        }
 }
 
 const Ehdr<> &
@@ -117,6 +141,36 @@ elf::get_loader() const
         return m->l;
 }
 
+void
+elf::advise_access() const
+{
+        for (auto &sec : m->sections) {
+                auto &hdr = sec.get_hdr();
+                if (hdr.type == sht::nobits || hdr.size == 0)
+                        continue;
+                if (sec.is_exec()) {
+                        m->l->advise(hdr.offset, hdr.size,
+                                     access_pattern::will_need);
+                        m->l->advise(hdr.offset, hdr.size,
+                                     access_pattern::sequential);
+                        continue;
+                }
+                switch (hdr.type) {
+                case sht::symtab:
+                case sht::dynsym:
+                case sht::strtab:
+                case sht::rel:
+                case sht::rela:
+                case sht::hash:
+                        m->l->advise(hdr.offset, hdr.size,
+                                     access_pattern::random);
+                        break;
+                default:
+                        break;
+                }
+        }
+}
+
 const std::vector<section> &
 elf::sections() const
 {
@@ -133,10 +187,22 @@ elf::segments() const
 const section &
 elf::get_section(const std::string &name) const
 {
-        for (auto &sec : sections())
-                if (name == sec.get_name(nullptr))
-                        return sec;
-        return m->invalid_section;
+        auto it = m->section_indices.find(name);
+        if (it == m->section_indices.end())
+                return m->invalid_section;
+        return m->sections[it->second];
+}
+
+const std::vector<section> &
+elf::executable_sections() const
+{
+        return m->executable_sections;
+}
+
+std::pair<Elf64::Addr, Elf64::Addr>
+elf::executable_range() const
+{
+        return m->executable_range;
 }
 
 const section &
@@ -161,7 +227,7 @@ elf::get_segment(unsigned index) const
 
 struct segment::impl {
   impl(const elf &f)
-      : f(f) { }
+      : f(f), data(nullptr) { }
 
   const elf f;
   Phdr<> hdr;
@@ -218,7 +284,7 @@ enums::to_string(shn v)
 struct section::impl
 {
         impl(const elf &f)
-                : f(f) { }
+                : f(f), name(nullptr), name_len(0), data(nullptr) { }
 
         const elf f;
         Shdr<> hdr;
@@ -0,0 +1,32 @@
+#include "elf++.hh"
+
+#include <stdexcept>
+
+using namespace std;
+
+ELFPP_BEGIN_NAMESPACE
+
+class memory_loader : public loader
+{
+        const char *base;
+        size_t lim;
+
+public:
+        memory_loader(const void *data, size_t size)
+                : base((const char*)data), lim(size) { }
+
+        const void *load(off_t offset, size_t size)
+        {
+                if (offset + size > lim)
+                        throw range_error("offset exceeds buffer size");
+                return base + offset;
+        }
+};
+
+std::shared_ptr<loader>
+create_memory_loader(const void *data, size_t size)
+{
+        return make_shared<memory_loader>(data, size);
+}
+
+ELFPP_END_NAMESPACE
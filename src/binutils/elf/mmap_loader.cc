@@ -5,20 +5,56 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <fcntl.h>
+#include <stdint.h>
 #include <unistd.h>
 
 using namespace std;
 
 ELFPP_BEGIN_NAMESPACE
 
+// Size of a transparent huge page on common architectures
+static const size_t hugepage_size = 2 * 1024 * 1024;
+
 class mmap_loader : public loader
 {
         void *base;
         size_t lim;
 
+        // Reserve an address range aligned to a huge page and map the
+        // file at its start.  Returns MAP_FAILED on failure.
+        void *map_hugepage_aligned(int fd, int flags)
+        {
+                size_t reserved = lim + hugepage_size;
+                void *area = mmap(nullptr, reserved, PROT_NONE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (area == MAP_FAILED)
+                        return MAP_FAILED;
+                uintptr_t start = (uintptr_t)area;
+                uintptr_t aligned = (start + hugepage_size - 1)
+                        & ~(uintptr_t)(hugepage_size - 1);
+                void *result = mmap((void*)aligned, lim, PROT_READ,
+                                    flags | MAP_FIXED, fd, 0);
+                if (result == MAP_FAILED) {
+                        munmap(area, reserved);
+                        return MAP_FAILED;
+                }
+                // Release the unused parts of the reservation
+                if (aligned > start)
+                        munmap(area, aligned - start);
+                uintptr_t end = aligned + lim;
+                uintptr_t reserved_end = start + reserved;
+                if (reserved_end > end)
+                        munmap((void*)end, reserved_end - end);
+#ifdef MADV_HUGEPAGE
+                madvise(result, lim, MADV_HUGEPAGE);
+#endif
+                return result;
+        }
+
 public:
-        mmap_loader(int fd)
+        mmap_loader(int fd, const mmap_loader_options &opts)
         {
                 off_t end = lseek(fd, 0, SEEK_END);
                 if (end == (off_t)-1)
@@ -26,7 +62,18 @@ public:
                                            "finding file length");
                 lim = end;
 
-                base = mmap(nullptr, lim, PROT_READ, MAP_SHARED, fd, 0);
+                int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+                if (opts.populate)
+                        flags |= MAP_POPULATE;
+#endif
+                base = MAP_FAILED;
+                if (opts.hugepage_threshold != 0
+                    && lim >= opts.hugepage_threshold)
+                        base = map_hugepage_aligned(fd, flags);
+                // Fall back to a plain mapping
+                if (base == MAP_FAILED)
+                        base = mmap(nullptr, lim, PROT_READ, flags, fd, 0);
                 if (base == MAP_FAILED)
                         throw system_error(errno, system_category(),
                                            "mmap'ing file");
@@ -44,12 +91,59 @@ public:
                         throw range_error("offset exceeds file size");
                 return (const char*)base + offset;
         }
+
+        void advise(off_t offset, size_t size, access_pattern pattern)
+        {
+                if ((size_t)offset >= lim || size == 0)
+                        return;
+                if (offset + size > lim)
+                        size = lim - offset;
+                int advice;
+                switch (pattern) {
+                case access_pattern::sequential:
+                        advice = MADV_SEQUENTIAL;
+                        break;
+                case access_pattern::random:
+                        advice = MADV_RANDOM;
+                        break;
+                case access_pattern::will_need:
+                        advice = MADV_WILLNEED;
+                        break;
+                default:
+                        advice = MADV_NORMAL;
+                        break;
+                }
+                // madvise requires a page aligned start address
+                size_t page_size = sysconf(_SC_PAGESIZE);
+                size_t page_offset = offset % page_size;
+                // Hints are best effort, failures are ignored
+                madvise((char*)base + offset - page_offset,
+                        size + page_offset, advice);
+        }
 };
 
 std::shared_ptr<loader>
 create_mmap_loader(int fd)
 {
-        return make_shared<mmap_loader>(fd);
+        return make_shared<mmap_loader>(fd, mmap_loader_options());
+}
+
+std::shared_ptr<loader>
+create_mmap_loader(int fd, const mmap_loader_options &opts)
+{
+        return make_shared<mmap_loader>(fd, opts);
+}
+
+page_fault_count
+get_page_fault_count()
+{
+        struct rusage usage;
+        page_fault_count result = {0, 0};
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+                result.minor = usage.ru_minflt;
+                result.major = usage.ru_majflt;
+        }
+        return result;
 }
 
 ELFPP_END_NAMESPACE
@@ -0,0 +1,93 @@
+#include "elf++.hh"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+#include <errno.h>
+#include <unistd.h>
+
+using namespace std;
+
+ELFPP_BEGIN_NAMESPACE
+
+class stream_loader : public loader
+{
+        int fd;
+        // Bytes read so far.  Each chunk holds one forward read and is
+        // keyed by its file offset.  Chunks never move, so pointers
+        // handed out by load remain valid.
+        map<off_t, vector<char>> chunks;
+        off_t pos;
+        // Copies of requests spanning several chunks
+        vector<unique_ptr<char[]>> joined;
+        // Served for empty requests
+        char empty = 0;
+
+        void read_up_to(off_t end)
+        {
+                vector<char> chunk(end - pos);
+                size_t done = 0;
+                while (done < chunk.size()) {
+                        ssize_t n = read(fd, chunk.data() + done,
+                                         chunk.size() - done);
+                        if (n < 0 && errno == EINTR)
+                                continue;
+                        if (n < 0)
+                                throw system_error(errno, system_category(),
+                                                   "reading stream");
+                        if (n == 0)
+                                throw range_error("offset exceeds stream size");
+                        done += n;
+                }
+                chunks.emplace(pos, move(chunk));
+                pos = end;
+        }
+
+public:
+        stream_loader(int fd) : fd(fd), pos(0) { }
+
+        ~stream_loader()
+        {
+                close(fd);
+        }
+
+        const void *load(off_t offset, size_t size)
+        {
+                off_t end = offset + size;
+                if (end > pos)
+                        read_up_to(end);
+                // Nothing may have been read for an empty request
+                if (size == 0 || chunks.empty())
+                        return &empty;
+                // Find the chunk containing offset
+                auto it = chunks.upper_bound(offset);
+                --it;
+                off_t chunk_offset = offset - it->first;
+                if (chunk_offset + size <= it->second.size())
+                        return it->second.data() + chunk_offset;
+                // The request spans chunks, join them into a copy
+                unique_ptr<char[]> copy(new char[size]);
+                size_t done = 0;
+                for (; done < size; ++it) {
+                        size_t n = min(size - done,
+                                       it->second.size() - chunk_offset);
+                        memcpy(copy.get() + done,
+                               it->second.data() + chunk_offset, n);
+                        done += n;
+                        chunk_offset = 0;
+                }
+                joined.push_back(move(copy));
+                return joined.back().get();
+        }
+};
+
+std::shared_ptr<loader>
+create_stream_loader(int fd)
+{
+        return make_shared<stream_loader>(fd);
+}
+
+ELFPP_END_NAMESPACE
@@ -0,0 +1,181 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "AnalysisBudget.h"
+#include "MemoryStats.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace disasm {
+
+static const char *kStatusNames[] = {
+    "complete",
+    "cancelled",
+    "time_budget_exceeded",
+    "memory_budget_exceeded",
+    "node_budget_exceeded"
+};
+
+namespace {
+
+thread_local AnalysisBudget *t_budget = nullptr;
+thread_local unsigned t_polls = 0;
+
+/*
+ * Heap in use if MemoryStats is available. Otherwise, resident pages that
+ * are not shared, i.e., not backed by a file like the mapped input.
+ */
+uint64_t memoryInUse() noexcept {
+    if (MemoryStats::isAvailable()) {
+        auto stats = MemoryStats::collect();
+        uint64_t result = 0;
+        for (unsigned i = 0; i < MemoryStats::kOwnerCount; ++i) {
+            result += stats.liveBytes(static_cast<MemoryOwner>(i));
+        }
+        return result;
+    }
+    int fd = open("/proc/self/statm", O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    char buffer[128];
+    auto count = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (count <= 0) {
+        return 0;
+    }
+    buffer[count] = '\0';
+    unsigned long long size, resident, shared;
+    if (sscanf(buffer, "%llu %llu %llu", &size, &resident, &shared) != 3
+        || resident < shared) {
+        return 0;
+    }
+    return (resident - shared) * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+}
+
+AnalysisBudget::AnalysisBudget() noexcept :
+    m_start{std::chrono::steady_clock::now()},
+    m_time_limit{0},
+    m_memory_limit{0},
+    m_memory_at_start{memoryInUse()},
+    m_node_limit{0},
+    m_nodes{0},
+    m_status{static_cast<unsigned char>(AnalysisStatus::kComplete)} {
+}
+
+void AnalysisBudget::setTimeLimit(std::chrono::milliseconds limit) noexcept {
+    m_time_limit = limit;
+}
+
+void AnalysisBudget::setMemoryLimit(uint64_t bytes) noexcept {
+    m_memory_limit = bytes;
+}
+
+void AnalysisBudget::setNodeLimit(uint64_t count) noexcept {
+    m_node_limit = count;
+}
+
+void AnalysisBudget::restart() noexcept {
+    m_start = std::chrono::steady_clock::now();
+    m_memory_at_start = memoryInUse();
+    m_nodes.store(0, std::memory_order_relaxed);
+    m_status.store(static_cast<unsigned char>(AnalysisStatus::kComplete),
+                   std::memory_order_relaxed);
+}
+
+void AnalysisBudget::cancel() noexcept {
+    stop(AnalysisStatus::kCancelled);
+}
+
+void AnalysisBudget::addNodes(uint64_t count) noexcept {
+    m_nodes.fetch_add(count, std::memory_order_relaxed);
+}
+
+bool AnalysisBudget::check() noexcept {
+    if (isExhausted()) {
+        return true;
+    }
+    if (m_node_limit != 0
+        && m_nodes.load(std::memory_order_relaxed) > m_node_limit) {
+        stop(AnalysisStatus::kNodeBudgetExceeded);
+    } else if (m_time_limit.count() != 0
+        && std::chrono::steady_clock::now() - m_start > m_time_limit) {
+        stop(AnalysisStatus::kTimeBudgetExceeded);
+    } else if (m_memory_limit != 0) {
+        auto in_use = memoryInUse();
+        if (in_use > m_memory_at_start
+            && in_use - m_memory_at_start > m_memory_limit) {
+            stop(AnalysisStatus::kMemoryBudgetExceeded);
+        }
+    }
+    return isExhausted();
+}
+
+bool AnalysisBudget::isExhausted() const noexcept {
+    return status() != AnalysisStatus::kComplete;
+}
+
+AnalysisStatus AnalysisBudget::status() const noexcept {
+    return static_cast<AnalysisStatus>
+        (m_status.load(std::memory_order_relaxed));
+}
+
+void AnalysisBudget::stop(AnalysisStatus status) noexcept {
+    auto expected = static_cast<unsigned char>(AnalysisStatus::kComplete);
+    m_status.compare_exchange_strong(expected,
+                                     static_cast<unsigned char>(status),
+                                     std::memory_order_relaxed);
+}
+
+AnalysisBudget *AnalysisBudget::current() noexcept {
+    return t_budget;
+}
+
+bool AnalysisBudget::shouldStop() noexcept {
+    auto budget = t_budget;
+    if (budget == nullptr) {
+        return false;
+    }
+    if (budget->isExhausted()) {
+        return true;
+    }
+    if (budget->m_node_limit != 0
+        && budget->m_nodes.load(std::memory_order_relaxed)
+            > budget->m_node_limit) {
+        budget->stop(AnalysisStatus::kNodeBudgetExceeded);
+        return true;
+    }
+    if (++t_polls % kCheckInterval != 0) {
+        return false;
+    }
+    return budget->check();
+}
+
+void AnalysisBudget::countNodes(uint64_t count) noexcept {
+    if (t_budget != nullptr) {
+        t_budget->addNodes(count);
+    }
+}
+
+const char *AnalysisBudget::nameOf(AnalysisStatus status) noexcept {
+    return kStatusNames[static_cast<unsigned>(status)];
+}
+
+ScopedAnalysisBudget::ScopedAnalysisBudget(AnalysisBudget *budget) noexcept :
+    m_previous{t_budget} {
+    if (budget != nullptr) {
+        t_budget = budget;
+    }
+}
+
+ScopedAnalysisBudget::~ScopedAnalysisBudget() {
+    t_budget = m_previous;
+}
+}
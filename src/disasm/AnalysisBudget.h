@@ -0,0 +1,112 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace disasm {
+
+enum class AnalysisStatus : unsigned char {
+    kComplete,
+    kCancelled,
+    kTimeBudgetExceeded,
+    kMemoryBudgetExceeded,
+    kNodeBudgetExceeded
+};
+
+/**
+ * AnalysisBudget
+ * Limits time, memory, and maximal blocks spent on a file and allows
+ * cancelling it from another thread or a signal handler. Decode and
+ * analysis loops poll the budget of their thread through shouldStop and
+ * stop early once it is exhausted, leaving a partial but consistent
+ * result behind. The first reason to stop is kept as status.
+ *
+ * Limits of zero are unlimited. Memory is limited in its growth since
+ * the budget was constructed or restarted, so restart it before each
+ * file. Usage is the heap in use if MemoryStats is available, resident
+ * memory not backed by files otherwise.
+ */
+class AnalysisBudget {
+public:
+    AnalysisBudget() noexcept;
+    virtual ~AnalysisBudget() = default;
+    AnalysisBudget(const AnalysisBudget &src) = delete;
+    AnalysisBudget &operator=(const AnalysisBudget &src) = delete;
+
+    void setTimeLimit(std::chrono::milliseconds limit) noexcept;
+    void setMemoryLimit(uint64_t bytes) noexcept;
+    void setNodeLimit(uint64_t count) noexcept;
+    /*
+     * restarts the clock, takes current memory usage as the new base, and
+     * clears nodes counted and status.
+     */
+    void restart() noexcept;
+    /*
+     * async-signal-safe.
+     */
+    void cancel() noexcept;
+    void addNodes(uint64_t count) noexcept;
+    /*
+     * checks all limits, returns true if exhausted.
+     */
+    bool check() noexcept;
+    bool isExhausted() const noexcept;
+    AnalysisStatus status() const noexcept;
+
+    /*
+     * budget of the calling thread, nullptr if unlimited.
+     */
+    static AnalysisBudget *current() noexcept;
+    /*
+     * Cheap poll of the budget of the calling thread. Node count and
+     * cancellation are checked on every call, time and memory only on
+     * every kCheckInterval-th.
+     */
+    static bool shouldStop() noexcept;
+    static void countNodes(uint64_t count) noexcept;
+    static const char *nameOf(AnalysisStatus status) noexcept;
+
+    static constexpr unsigned kCheckInterval = 1024;
+
+private:
+    friend class ScopedAnalysisBudget;
+
+    void stop(AnalysisStatus status) noexcept;
+
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::duration m_time_limit;
+    uint64_t m_memory_limit;
+    uint64_t m_memory_at_start;
+    uint64_t m_node_limit;
+    std::atomic<uint64_t> m_nodes;
+    std::atomic<unsigned char> m_status;
+};
+
+/**
+ * ScopedAnalysisBudget
+ * Makes a budget the one polled by the current thread in its scope. A
+ * nullptr budget keeps the enclosing one, e.g., the one of the decoder
+ * handing out windows for analysis.
+ */
+class ScopedAnalysisBudget {
+public:
+    explicit ScopedAnalysisBudget(AnalysisBudget *budget) noexcept;
+    ~ScopedAnalysisBudget();
+
+    ScopedAnalysisBudget(const ScopedAnalysisBudget &src) = delete;
+    ScopedAnalysisBudget &operator=(const ScopedAnalysisBudget &src) = delete;
+
+private:
+    AnalysisBudget *m_previous;
+};
+}
@@ -31,6 +31,7 @@ public:
     BasicBlock(const BasicBlock &src) = default;
     BasicBlock &operator=(const BasicBlock &src) = default;
     BasicBlock(BasicBlock &&src) = default;
+    BasicBlock &operator=(BasicBlock &&src) = default;
     addr_t addressAt(unsigned index) const;
 
     friend class MaximalBlock;
@@ -0,0 +1,70 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "BasicBlockSet.h"
+#include <algorithm>
+
+namespace disasm {
+
+void BasicBlockSet::insert(unsigned position) {
+    if (position < kWordBits) {
+        m_inline |= (uint64_t) 1 << position;
+        return;
+    }
+    unsigned word_idx = position / kWordBits - 1;
+    if (m_spill.size() <= word_idx) {
+        m_spill.resize(word_idx + 1, 0);
+    }
+    m_spill[word_idx] |= (uint64_t) 1 << (position % kWordBits);
+}
+
+bool BasicBlockSet::contains(unsigned position) const noexcept {
+    if (position < kWordBits) {
+        return (m_inline & ((uint64_t) 1 << position)) != 0;
+    }
+    unsigned word_idx = position / kWordBits - 1;
+    return word_idx < m_spill.size()
+        && (m_spill[word_idx] & ((uint64_t) 1 << (position % kWordBits))) != 0;
+}
+
+bool BasicBlockSet::empty() const noexcept {
+    return m_inline == 0
+        && std::all_of(m_spill.cbegin(),
+                       m_spill.cend(),
+                       [](uint64_t word) { return word == 0; });
+}
+
+bool BasicBlockSet::intersects(const BasicBlockSet &other) const noexcept {
+    if ((m_inline & other.m_inline) != 0) {
+        return true;
+    }
+    auto count = std::min(m_spill.size(), other.m_spill.size());
+    for (unsigned i = 0; i < count; ++i) {
+        if ((m_spill[i] & other.m_spill[i]) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+BasicBlockSet &BasicBlockSet::operator|=(const BasicBlockSet &other) {
+    m_inline |= other.m_inline;
+    if (m_spill.size() < other.m_spill.size()) {
+        m_spill.resize(other.m_spill.size(), 0);
+    }
+    for (unsigned i = 0; i < other.m_spill.size(); ++i) {
+        m_spill[i] |= other.m_spill[i];
+    }
+    return *this;
+}
+
+void BasicBlockSet::clear() noexcept {
+    m_inline = 0;
+    m_spill.clear();
+}
+}
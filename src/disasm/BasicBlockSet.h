@@ -0,0 +1,63 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace disasm {
+
+/**
+ * BasicBlockSet
+ * A set of basic blocks identified by their position in MaximalBlockBuilder.
+ * The first 64 positions are kept inline, larger positions spill to heap
+ * which is rare in practice.
+ */
+class BasicBlockSet {
+public:
+    BasicBlockSet() : m_inline{0} { }
+    virtual ~BasicBlockSet() = default;
+    BasicBlockSet(const BasicBlockSet &src) = default;
+    BasicBlockSet &operator=(const BasicBlockSet &src) = default;
+    BasicBlockSet(BasicBlockSet &&src) = default;
+    BasicBlockSet &operator=(BasicBlockSet &&src) = default;
+
+    void insert(unsigned position);
+    bool contains(unsigned position) const noexcept;
+    bool empty() const noexcept;
+    bool intersects(const BasicBlockSet &other) const noexcept;
+    BasicBlockSet &operator|=(const BasicBlockSet &other);
+    void clear() noexcept;
+
+    /*
+     * calls func with every position in the set in increasing order.
+     */
+    template<typename Func>
+    void forEach(Func func) const {
+        forEachIn(m_inline, 0, func);
+        for (unsigned i = 0; i < m_spill.size(); ++i) {
+            forEachIn(m_spill[i], (i + 1) * kWordBits, func);
+        }
+    }
+
+private:
+    template<typename Func>
+    static void forEachIn(uint64_t word, unsigned base, Func &func) {
+        while (word != 0) {
+            func(base + static_cast<unsigned>(__builtin_ctzll(word)));
+            word &= word - 1;
+        }
+    }
+
+private:
+    static constexpr unsigned kWordBits = 64;
+    uint64_t m_inline;
+    std::vector<uint64_t> m_spill;
+};
+}
@@ -0,0 +1,253 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "DecisionTrace.h"
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+namespace disasm {
+
+static const char kTraceMagic[8] = {'S', 'P', 'E', 'D', 'I', 'T', 'R', '1'};
+static const size_t kBufferedRecords = 1 << 16;
+
+static const char *kEventNames[] = {
+    "node_to_data",
+    "candidate_start",
+    "overlap",
+    "switch_table",
+    "procedure_exit"
+};
+
+static const char *kDataReasonNames[] = {
+    "branch_outside_code",
+    "branch_to_no_node",
+    "overlap_lighter",
+    "overlap_nested",
+    "overlap_single_inst",
+    "conflicting_predecessor",
+    "conditional_without_successor",
+    "pc_relative_load",
+    "switch_table_clean_up",
+    "invalid_successor"
+};
+
+static const char *kOverlapOutcomeNames[] = {
+    "kept",
+    "shrink_overlap",
+    "node_to_data",
+    "overlap_to_data"
+};
+
+// follows ICFGExitNodeType
+static const char *kExitTypeNames[] = {
+    "tail_call",
+    "overlap",
+    "invalid_lr",
+    "tail_call_or_overlap",
+    "return",
+    "indirect"
+};
+
+static_assert(sizeof(kEventNames) / sizeof(kEventNames[0])
+                  == static_cast<unsigned>(TraceEvent::kCount),
+              "event names out of sync");
+static_assert(sizeof(kDataReasonNames) / sizeof(kDataReasonNames[0])
+                  == static_cast<unsigned>(TraceDataReason::kCount),
+              "data reason names out of sync");
+static_assert(sizeof(kOverlapOutcomeNames) / sizeof(kOverlapOutcomeNames[0])
+                  == static_cast<unsigned>(TraceOverlapOutcome::kCount),
+              "overlap outcome names out of sync");
+
+namespace {
+
+struct TraceHeader {
+    char m_magic[8];
+    uint32_t m_record_size;
+    uint32_t m_reserved;
+};
+
+struct TraceFile {
+    ~TraceFile() {
+        flush();
+        if (m_file != nullptr) {
+            std::fclose(m_file);
+        }
+    }
+
+    bool flush() noexcept {
+        if (m_file == nullptr || m_buffer.empty()) {
+            return m_valid;
+        }
+        if (std::fwrite(m_buffer.data(), sizeof(TraceRecord),
+                        m_buffer.size(), m_file) != m_buffer.size()) {
+            m_valid = false;
+        }
+        m_buffer.clear();
+        return m_valid;
+    }
+
+    std::FILE *m_file = nullptr;
+    bool m_valid = true;
+    std::vector<TraceRecord> m_buffer;
+};
+
+TraceFile &traceFile() {
+    static TraceFile instance;
+    return instance;
+}
+
+const char *nameOrUnknown(const char *const *names,
+                          size_t count,
+                          unsigned index) noexcept {
+    return index < count ? names[index] : "unknown";
+}
+}
+
+bool TraceRecord::operator==(const TraceRecord &other) const noexcept {
+    return m_event == other.m_event
+        && m_detail == other.m_detail
+        && m_node == other.m_node
+        && m_addr == other.m_addr
+        && m_value == other.m_value;
+}
+
+bool TraceRecord::operator!=(const TraceRecord &other) const noexcept {
+    return !(*this == other);
+}
+
+bool DecisionTrace::open(const std::string &path) {
+    close();
+    auto &trace = traceFile();
+    trace.m_file = std::fopen(path.c_str(), "wb");
+    if (trace.m_file == nullptr) {
+        return false;
+    }
+    TraceHeader header;
+    std::memcpy(header.m_magic, kTraceMagic, sizeof(kTraceMagic));
+    header.m_record_size = sizeof(TraceRecord);
+    header.m_reserved = 0;
+    trace.m_valid =
+        std::fwrite(&header, sizeof(header), 1, trace.m_file) == 1;
+    trace.m_buffer.reserve(kBufferedRecords);
+    return trace.m_valid;
+}
+
+bool DecisionTrace::close() {
+    auto &trace = traceFile();
+    if (trace.m_file == nullptr) {
+        return true;
+    }
+    bool result = trace.flush();
+    result = std::fclose(trace.m_file) == 0 && result;
+    trace.m_file = nullptr;
+    trace.m_valid = true;
+    return result;
+}
+
+bool DecisionTrace::isEnabled() noexcept {
+    return traceFile().m_file != nullptr;
+}
+
+void DecisionTrace::record(TraceEvent event,
+                           uint8_t detail,
+                           uint64_t node,
+                           uint64_t addr,
+                           uint64_t value) noexcept {
+    auto &trace = traceFile();
+    if (trace.m_file == nullptr) {
+        return;
+    }
+    trace.m_buffer.push_back(TraceRecord{static_cast<uint8_t>(event),
+                                         detail,
+                                         0,
+                                         static_cast<uint32_t>(node),
+                                         addr,
+                                         value});
+    if (trace.m_buffer.size() == kBufferedRecords) {
+        trace.flush();
+    }
+}
+
+bool DecisionTrace::read(const std::string &path,
+                         std::vector<TraceRecord> &records) {
+    auto file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    TraceHeader header;
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1
+        && std::memcmp(header.m_magic, kTraceMagic, sizeof(kTraceMagic)) == 0
+        && header.m_record_size == sizeof(TraceRecord);
+    TraceRecord record;
+    while (valid && std::fread(&record, sizeof(record), 1, file) == 1) {
+        records.push_back(record);
+    }
+    valid = valid && !std::ferror(file);
+    std::fclose(file);
+    return valid;
+}
+
+std::string DecisionTrace::describe(const TraceRecord &record) {
+    std::ostringstream out;
+    out << nameOrUnknown(kEventNames,
+                         static_cast<size_t>(TraceEvent::kCount),
+                         record.m_event)
+        << " node " << record.m_node << std::hex;
+    switch (static_cast<TraceEvent>(record.m_event)) {
+        case TraceEvent::kNodeToData:
+            out << " at 0x" << record.m_addr << " reason "
+                << nameOrUnknown(kDataReasonNames,
+                                 static_cast<size_t>(TraceDataReason::kCount),
+                                 record.m_detail);
+            break;
+        case TraceEvent::kCandidateStart:
+            out << " from 0x" << record.m_value << " to 0x" << record.m_addr;
+            break;
+        case TraceEvent::kOverlap:
+            out << " at 0x" << record.m_addr << std::dec
+                << " with node " << record.m_value << " outcome "
+                << nameOrUnknown(kOverlapOutcomeNames,
+                                 static_cast<size_t>
+                                 (TraceOverlapOutcome::kCount),
+                                 record.m_detail);
+            break;
+        case TraceEvent::kSwitchTable:
+            out << " at 0x" << record.m_addr << " table end 0x"
+                << record.m_value << std::dec << " entry size "
+                << static_cast<unsigned>(record.m_detail);
+            break;
+        case TraceEvent::kProcedureExit:
+            out << " of procedure 0x" << record.m_addr << " ends at 0x"
+                << record.m_value << " type "
+                << nameOrUnknown(kExitTypeNames,
+                                 sizeof(kExitTypeNames)
+                                     / sizeof(kExitTypeNames[0]),
+                                 record.m_detail);
+            break;
+        default:
+            out << " addr 0x" << record.m_addr << " value 0x"
+                << record.m_value << std::dec << " detail "
+                << static_cast<unsigned>(record.m_detail);
+            break;
+    }
+    return out.str();
+}
+
+const char *DecisionTrace::nameOf(TraceEvent event) noexcept {
+    return kEventNames[static_cast<unsigned>(event)];
+}
+
+const char *DecisionTrace::nameOf(TraceDataReason reason) noexcept {
+    return kDataReasonNames[static_cast<unsigned>(reason)];
+}
+
+const char *DecisionTrace::nameOf(TraceOverlapOutcome outcome) noexcept {
+    return kOverlapOutcomeNames[static_cast<unsigned>(outcome)];
+}
+}
@@ -0,0 +1,128 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace disasm {
+
+enum class TraceEvent : uint8_t {
+    kNodeToData,
+    kCandidateStart,
+    kOverlap,
+    kSwitchTable,
+    kProcedureExit,
+    kCount
+};
+
+/*
+ * Why a node was set to data, details a kNodeToData record.
+ */
+enum class TraceDataReason : uint8_t {
+    kBranchOutsideCode,
+    kBranchToNoNode,
+    kOverlapLighter,
+    kOverlapNested,
+    kOverlapSingleInst,
+    kConflictingPredecessor,
+    kConditionalWithoutSuccessor,
+    kPCRelativeLoad,
+    kSwitchTableCleanUp,
+    kInvalidSuccessor,
+    kCount
+};
+
+/*
+ * How an overlap was resolved, details a kOverlap record.
+ */
+enum class TraceOverlapOutcome : uint8_t {
+    kKept,
+    kShrinkOverlap,
+    kNodeToData,
+    kOverlapToData,
+    kCount
+};
+
+/*
+ * Fixed size record, fields are interpreted depending on event:
+ *  node to data:    addr of first inst,  value unused
+ *  candidate start: new candidate start, value previous one
+ *  overlap:         addr of first inst,  value id of overlapping node
+ *  switch table:    addr of first inst,  value end of table,
+ *                   detail entry size
+ *  procedure exit:  procedure entry,     value end addr of exit node,
+ *                   detail ICFGExitNodeType
+ */
+struct TraceRecord {
+    uint8_t m_event;
+    uint8_t m_detail;
+    uint16_t m_reserved;
+    uint32_t m_node;
+    uint64_t m_addr;
+    uint64_t m_value;
+
+    bool operator==(const TraceRecord &other) const noexcept;
+    bool operator!=(const TraceRecord &other) const noexcept;
+};
+
+static_assert(sizeof(TraceRecord) == 24, "trace record must stay compact");
+
+/**
+ * DecisionTrace
+ * Binary trace of analyzer decisions meant to verify that a change to the
+ * analysis preserves its decisions. Records are buffered and appended to
+ * the trace file in host byte order after a short header. Recording is a
+ * no-op until a trace file is opened. Unless SPEDI_TRACE is defined, the
+ * SPEDI_DECISION macro only evaluates its detail, which callers may
+ * compute for tracing alone.
+ *
+ * The analyzer runs in a single thread and so does recording, there is
+ * no locking.
+ */
+class DecisionTrace {
+public:
+    DecisionTrace() = delete;
+
+    /*
+     * returns false if the trace file can not be created.
+     */
+    static bool open(const std::string &path);
+    /*
+     * flushes buffered records, returns false if writing failed.
+     */
+    static bool close();
+    static bool isEnabled() noexcept;
+    static void record(TraceEvent event,
+                       uint8_t detail,
+                       uint64_t node,
+                       uint64_t addr,
+                       uint64_t value) noexcept;
+
+    /*
+     * reads all records of a trace file, returns false if it is not one.
+     */
+    static bool read(const std::string &path,
+                     std::vector<TraceRecord> &records);
+    static std::string describe(const TraceRecord &record);
+    static const char *nameOf(TraceEvent event) noexcept;
+    static const char *nameOf(TraceDataReason reason) noexcept;
+    static const char *nameOf(TraceOverlapOutcome outcome) noexcept;
+};
+}
+
+#ifdef SPEDI_TRACE
+#define SPEDI_DECISION(event, detail, node, addr, value) \
+    disasm::DecisionTrace::record(disasm::TraceEvent::event, \
+                                  static_cast<uint8_t>(detail), \
+                                  node, addr, value)
+#else
+#define SPEDI_DECISION(event, detail, node, addr, value) ((void) (detail))
+#endif
@@ -0,0 +1,354 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "DwarfIndex.h"
+#include <binutils/elf/elf++.hh>
+#include <binutils/dwarf/dwarf++.hh>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
+namespace disasm {
+
+/*
+ * Calls work for every index in [0, count) using up to thread_count threads.
+ * Indexes are handed out dynamically since compilation units vary a lot
+ * in size.
+ */
+static void parallelFor
+    (size_t count,
+     unsigned thread_count,
+     const std::function<void(size_t)> &work) {
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            work(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < thread_count && i < count; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+/*
+ * returns the name of a subprogram or an empty string. Out-of-line and
+ * concrete instances refer to the DIE carrying the name.
+ */
+static std::string nameOf(const dwarf::die &die) {
+    for (auto iter = die; iter.valid();) {
+        if (iter.has(dwarf::DW_AT::name)) {
+            return dwarf::at_name(iter);
+        }
+        if (iter.has(dwarf::DW_AT::specification)) {
+            iter = dwarf::at_specification(iter);
+        } else if (iter.has(dwarf::DW_AT::abstract_origin)) {
+            iter = dwarf::at_abstract_origin(iter);
+        } else {
+            break;
+        }
+    }
+    return std::string();
+}
+
+/*
+ * Collects subprograms of unit. DIE offsets decoded by scan_units are
+ * visited in order instead of walking the tree, hence subprograms nested
+ * in another one, e.g., GNU C nested functions, are collected as well.
+ */
+static void collectFunctions
+    (const dwarf::compilation_unit &unit,
+     std::vector<DwarfIndex::FunctionRange> &result) {
+    for (auto offset : unit.die_offsets()) {
+        auto die = unit.get_die(offset);
+        if (die.tag != dwarf::DW_TAG::subprogram) {
+            continue;
+        }
+        // declarations and inlined-only functions do not have code
+        if (!die.has(dwarf::DW_AT::low_pc)
+            && !die.has(dwarf::DW_AT::ranges)) {
+            continue;
+        }
+        auto name = nameOf(die);
+        for (auto &range : dwarf::die_pc_range(die)) {
+            // Thumb functions might have their first bit set.
+            result.push_back({range.low & ~1ULL, range.high, name});
+        }
+    }
+}
+
+DwarfIndex::DwarfIndex(const elf::elf *elf_file, unsigned thread_count) :
+    m_elf_file{elf_file},
+    m_thread_count{thread_count} {
+    if (m_thread_count == 0) {
+        m_thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+}
+
+DwarfIndex::~DwarfIndex() {
+}
+
+bool DwarfIndex::isAvailable() const noexcept {
+    return m_elf_file->get_section(".debug_info").valid();
+}
+
+void DwarfIndex::loadDwarf() const {
+    std::call_once(m_dwarf_once, [this]() {
+        if (!isAvailable()) {
+            return;
+        }
+        try {
+            m_dwarf.reset
+                (new dwarf::dwarf(dwarf::elf::create_loader(*m_elf_file)));
+        } catch (std::exception &e) {
+            // malformed debug info is treated like missing debug info.
+            m_dwarf.reset();
+            return;
+        }
+        // DIEs of a unit are read lazily on first access. A DIE can refer
+        // to a DIE of another unit, e.g., by DW_FORM_ref_addr, hence all
+        // units are decoded before any unit is walked in parallel.
+        try {
+            m_dwarf->scan_units(m_thread_count);
+        } catch (std::exception &e) {
+            // malformed units fail again when walked and are skipped.
+        }
+    });
+}
+
+size_t DwarfIndex::unitCount() const {
+    loadDwarf();
+    if (m_dwarf == nullptr) {
+        return 0;
+    }
+    return m_dwarf->compilation_units().size();
+}
+
+void DwarfIndex::buildFunctions() const {
+    std::call_once(m_functions_once, [this]() {
+        auto unit_count = unitCount();
+        if (unit_count == 0) {
+            return;
+        }
+        auto &units = m_dwarf->compilation_units();
+        std::vector<std::vector<FunctionRange>> unit_functions(unit_count);
+        parallelFor(unit_count, m_thread_count, [&](size_t i) {
+            try {
+                collectFunctions(units[i], unit_functions[i]);
+            } catch (std::exception &e) {
+                // skip malformed unit.
+                unit_functions[i].clear();
+            }
+        });
+        // merging in unit order keeps the result deterministic.
+        size_t function_count = 0;
+        for (auto &functions : unit_functions) {
+            function_count += functions.size();
+        }
+        m_functions.reserve(function_count);
+        // functions discarded by the linker keep a zero start address.
+        auto exec_range = m_elf_file->executable_range();
+        for (auto &functions : unit_functions) {
+            for (auto &function : functions) {
+                if (exec_range.first <= function.m_start_addr
+                    && function.m_start_addr < exec_range.second) {
+                    m_functions.emplace_back(std::move(function));
+                }
+            }
+        }
+        std::stable_sort(m_functions.begin(), m_functions.end(),
+                         [](const FunctionRange &a, const FunctionRange &b) {
+                             return a.m_start_addr < b.m_start_addr;
+                         });
+        // inline functions are described by every unit using them.
+        auto last = std::unique
+            (m_functions.begin(), m_functions.end(),
+             [](const FunctionRange &a, const FunctionRange &b) {
+                 return a.m_start_addr == b.m_start_addr
+                     && a.m_end_addr == b.m_end_addr;
+             });
+        m_functions.erase(last, m_functions.end());
+    });
+}
+
+void DwarfIndex::buildLines() const {
+    std::call_once(m_lines_once, [this]() {
+        if (!isAvailable()) {
+            return;
+        }
+        auto key = sourceKey();
+        if (!m_line_table_cache.empty()) {
+            m_line_table = LineTableIndex::load(m_line_table_cache, key);
+            if (m_line_table.valid()) {
+                return;
+            }
+        }
+        auto unit_count = unitCount();
+        if (m_dwarf == nullptr) {
+            // e.g., DWARF 5 which is not supported.
+            return;
+        }
+        auto &units = m_dwarf->compilation_units();
+        using Row = LineTableIndex::Row;
+        std::vector<std::vector<Row>> unit_rows(unit_count);
+        std::vector<std::vector<std::string>> unit_files(unit_count);
+        auto exec_range = m_elf_file->executable_range();
+        parallelFor(unit_count, m_thread_count, [&](size_t i) {
+            auto &rows = unit_rows[i];
+            auto &files = unit_files[i];
+            try {
+                auto &table = units[i].get_line_table();
+                // maps file index of line table to index in files.
+                std::unordered_map<unsigned, unsigned> file_slots;
+                size_t sequence_start = 0;
+                for (auto &entry : table) {
+                    uint8_t flags = 0;
+                    flags |= entry.is_stmt ? LineTableIndex::kIsStmt : 0;
+                    flags |= entry.basic_block ? LineTableIndex::kBasicBlock : 0;
+                    flags |=
+                        entry.end_sequence ? LineTableIndex::kEndSequence : 0;
+                    flags |=
+                        entry.prologue_end ? LineTableIndex::kPrologueEnd : 0;
+                    flags |= entry.epilogue_begin
+                             ? LineTableIndex::kEpilogueBegin : 0;
+                    if (entry.end_sequence) {
+                        rows.push_back({entry.address, 0, 0, flags});
+                        // sequences of code discarded by the linker
+                        // start at zero and would shadow real code.
+                        auto start_addr = rows[sequence_start].m_addr;
+                        if (start_addr < exec_range.first
+                            || exec_range.second <= start_addr) {
+                            rows.resize(sequence_start);
+                        }
+                        sequence_start = rows.size();
+                        continue;
+                    }
+                    auto result = file_slots.insert
+                        ({entry.file_index,
+                          static_cast<unsigned>(file_slots.size())});
+                    rows.push_back({entry.address,
+                                    result.first->second,
+                                    entry.line,
+                                    flags});
+                }
+                files.resize(file_slots.size());
+                for (auto &slot : file_slots) {
+                    files[slot.second] = table.get_file(slot.first)->path;
+                }
+            } catch (std::exception &e) {
+                // skip malformed unit.
+                rows.clear();
+                files.clear();
+            }
+        });
+        // merging in unit order keeps file indexes deterministic.
+        size_t row_count = 0;
+        for (auto &rows : unit_rows) {
+            row_count += rows.size();
+        }
+        std::vector<Row> rows;
+        std::vector<std::string> files;
+        rows.reserve(row_count);
+        for (size_t i = 0; i < unit_count; ++i) {
+            unsigned file_base = static_cast<unsigned>(files.size());
+            for (auto &row : unit_rows[i]) {
+                if (!row.isEndOfSequence()) {
+                    row.m_file += file_base;
+                }
+                rows.push_back(row);
+            }
+            std::move(unit_files[i].begin(), unit_files[i].end(),
+                      std::back_inserter(files));
+        }
+        m_line_table = LineTableIndex::build(std::move(rows), files, key);
+        if (!m_line_table_cache.empty()) {
+            // a failure to cache is not fatal.
+            m_line_table.save(m_line_table_cache);
+        }
+    });
+}
+
+/*
+ * Identifies the debug info a line table was built from without parsing
+ * it. FNV-1a of .debug_line combined with sizes of related sections.
+ */
+uint64_t DwarfIndex::sourceKey() const {
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](uint64_t value) {
+        hash ^= value;
+        hash *= 1099511628211ULL;
+    };
+    auto &line_sec = m_elf_file->get_section(".debug_line");
+    if (line_sec.valid() && line_sec.data() != nullptr) {
+        auto data = static_cast<const uint8_t *>(line_sec.data());
+        for (size_t i = 0; i < line_sec.size(); ++i) {
+            mix(data[i]);
+        }
+    }
+    for (auto name : {".debug_line", ".debug_info", ".debug_str"}) {
+        auto &sec = m_elf_file->get_section(name);
+        mix(sec.valid() ? sec.size() : 0);
+    }
+    return hash;
+}
+
+const std::vector<DwarfIndex::FunctionRange> &DwarfIndex::functions() const {
+    buildFunctions();
+    return m_functions;
+}
+
+std::vector<addr_t> DwarfIndex::functionStartsWithin
+    (addr_t start_addr, addr_t end_addr) const {
+    auto &funcs = functions();
+    std::vector<addr_t> result;
+    auto iter = std::lower_bound
+        (funcs.cbegin(), funcs.cend(), start_addr,
+         [](const FunctionRange &func, addr_t addr) {
+             return func.m_start_addr < addr;
+         });
+    for (; iter < funcs.cend() && (*iter).m_start_addr < end_addr; ++iter) {
+        // a function might be split into several ranges.
+        if (result.empty() || result.back() != (*iter).m_start_addr) {
+            result.push_back((*iter).m_start_addr);
+        }
+    }
+    return result;
+}
+
+const DwarfIndex::FunctionRange *DwarfIndex::findFunction(addr_t addr) const {
+    auto &funcs = functions();
+    auto iter = std::upper_bound
+        (funcs.cbegin(), funcs.cend(), addr,
+         [](addr_t addr, const FunctionRange &func) {
+             return addr < func.m_start_addr;
+         });
+    if (iter == funcs.cbegin()) {
+        return nullptr;
+    }
+    --iter;
+    if (addr < (*iter).m_end_addr) {
+        return &(*iter);
+    }
+    return nullptr;
+}
+
+void DwarfIndex::setLineTableCache(const std::string &path) {
+    m_line_table_cache = path;
+}
+
+const LineTableIndex &DwarfIndex::lineTable() const {
+    buildLines();
+    return m_line_table;
+}
+}
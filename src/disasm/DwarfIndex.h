@@ -0,0 +1,106 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include "common.h"
+#include "LineTableIndex.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace elf {
+class elf;
+}
+
+namespace dwarf {
+class dwarf;
+}
+
+namespace disasm {
+
+/**
+ * DwarfIndex
+ * Function boundaries and line information recovered from DWARF debug info.
+ * Nothing is parsed on construction. Each part of the index is built on
+ * first query by scanning compilation units in parallel and is cached
+ * afterwards. Queries are safe to issue from multiple threads.
+ */
+class DwarfIndex {
+public:
+    /*
+     * Code range of a DW_TAG_subprogram.
+     */
+    struct FunctionRange {
+        addr_t m_start_addr;
+        addr_t m_end_addr;
+        std::string m_name;
+    };
+
+    /**
+     * Index debug info of elf_file. thread_count of zero uses all
+     * available hardware threads.
+     * precondition: elf_file outlives this index.
+     */
+    explicit DwarfIndex(const elf::elf *elf_file, unsigned thread_count = 0);
+    virtual ~DwarfIndex();
+    DwarfIndex(const DwarfIndex &src) = delete;
+    DwarfIndex &operator=(const DwarfIndex &src) = delete;
+
+    /*
+     * returns true if the file has a .debug_info section. Does not
+     * parse anything.
+     */
+    bool isAvailable() const noexcept;
+    size_t unitCount() const;
+
+    /*
+     * returns functions sorted by start address.
+     */
+    const std::vector<FunctionRange> &functions() const;
+    /*
+     * returns start addresses of functions in the range [start_addr, end_addr)
+     */
+    std::vector<addr_t> functionStartsWithin
+        (addr_t start_addr, addr_t end_addr) const;
+    /*
+     * returns the function whose code covers addr or nullptr.
+     */
+    const FunctionRange *findFunction(addr_t addr) const;
+
+    /*
+     * Line table is cached in given sidecar file. It is mapped from there
+     * if it was built from the same debug info, otherwise it is built and
+     * written there. Has to be set before the first query.
+     */
+    void setLineTableCache(const std::string &path);
+    /*
+     * returns address to line mapping of all units. An invalid table is
+     * returned if debug info is not available.
+     */
+    const LineTableIndex &lineTable() const;
+
+private:
+    void loadDwarf() const;
+    void buildFunctions() const;
+    void buildLines() const;
+    uint64_t sourceKey() const;
+
+private:
+    const elf::elf *m_elf_file;
+    unsigned m_thread_count;
+    mutable std::once_flag m_dwarf_once;
+    mutable std::once_flag m_functions_once;
+    mutable std::once_flag m_lines_once;
+    mutable std::unique_ptr<dwarf::dwarf> m_dwarf;
+    mutable std::vector<FunctionRange> m_functions;
+    std::string m_line_table_cache;
+    mutable LineTableIndex m_line_table;
+};
+}
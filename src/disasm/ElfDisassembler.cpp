@@ -9,16 +9,29 @@
 #include "./analysis/DisassemblyCFG.h"
 #include "ElfDisassembler.h"
 #include "RawInstWrapper.h"
+#include "ITBlockTracker.h"
+#include "Progress.h"
+#include "Stats.h"
 #include <inttypes.h>
 #include <algorithm>
+#include <cassert>
+#include <limits>
+#include <thread>
+#include <exception>
 
 namespace disasm {
 
-ElfDisassembler::ElfDisassembler() : m_valid{false} { }
+ElfDisassembler::ElfDisassembler() :
+    m_valid{false},
+    m_line_table{nullptr},
+    m_budget{nullptr} { }
 
 ElfDisassembler::ElfDisassembler(const elf::elf &elf_file) :
     m_valid{true},
-    m_elf_file{&elf_file} {
+    m_elf_file{&elf_file},
+    m_mapping_symbols{new LazyMappingSymbols},
+    m_line_table{nullptr},
+    m_budget{nullptr} {
     m_analyzer.setISA(getElfMachineArch());
 
 }
@@ -36,241 +49,334 @@ printHex(unsigned char *str, size_t len) {
 
 SectionDisassemblyARM ElfDisassembler::disassembleSectionUsingSymbols
     (const elf::section &sec) const {
+    return disassembleSectionUsingSymbols(sec, 1);
+}
 
-    // a type_mismatch exception would thrown in case symbol table was not found.
-    // We assume that symbols are ordered by their address.
-    auto symbols = getCodeSymbolsOfSection(sec);
+SectionDisassemblyARM ElfDisassembler::disassembleSectionUsingSymbols
+    (const elf::section &sec, unsigned thread_count) const {
+    SPEDI_PHASE(kSymbolDecode);
+    SPEDI_MEMORY_OWNER(kSectionDisassembly);
+    ScopedAnalysisBudget budget_scope{m_budget};
+    ScopedProgressPhase progress{StatsPhase::kSymbolDecode, 0};
+    Progress::addBytesTotal(sec.size());
+    printf("Section Name: %s\n", sec.get_name().c_str());
+    auto ranges = getCodeRangesOfSection(sec);
+    SectionDisassemblyARM result{&sec};
+    result.reserve(sec.size() / 10);
+    size_t total_size = 0;
+    for (auto &range : ranges) {
+        total_size += range.m_size;
+    }
+    // data between code ranges is skipped at once
+    Progress::advance(sec.size() - total_size, 0);
+    if (thread_count <= 1 || ranges.size() <= 1) {
+        disassembleCodeRanges(sec, ranges.cbegin(), ranges.cend(), result);
+        return result;
+    }
+    // Split ranges to chunks of about equal size. A chunk starts only where
+    // a range is not contiguous to the previous one so that no maximal
+    // block crosses chunks.
+    const size_t chunk_size = total_size / thread_count + 1;
+    std::vector<std::vector<CodeRange>::const_iterator> chunk_starts;
+    chunk_starts.push_back(ranges.cbegin());
+    size_t current_size = 0;
+    for (auto range_iter = ranges.cbegin(); range_iter < ranges.cend();
+         ++range_iter) {
+        if (current_size >= chunk_size
+            && (range_iter - 1)->m_start_addr + (range_iter - 1)->m_size
+                != range_iter->m_start_addr) {
+            chunk_starts.push_back(range_iter);
+            current_size = 0;
+        }
+        current_size += range_iter->m_size;
+    }
+    chunk_starts.push_back(ranges.cend());
 
-//    printf("Symbols size is %lu \n", symbols.size());
-//
-//    for (auto& symbol : symbols) {
-//        printf("Type %d, Addrd, 0x%#x \n", symbol.second, symbol.first);
-//    }
+    const size_t chunk_count = chunk_starts.size() - 1;
+    std::vector<SectionDisassemblyARM> chunk_results;
+    std::vector<std::exception_ptr> chunk_errors(chunk_count);
+    for (size_t i = 0; i < chunk_count; ++i) {
+        chunk_results.emplace_back(SectionDisassemblyARM{&sec});
+    }
+    std::vector<std::thread> workers;
+    auto budget = AnalysisBudget::current();
+    for (size_t i = 0; i < chunk_count; ++i) {
+        workers.emplace_back([&, i]() {
+            SPEDI_MEMORY_OWNER(kSectionDisassembly);
+            ScopedAnalysisBudget worker_budget_scope{budget};
+            try {
+                disassembleCodeRanges(sec,
+                                      chunk_starts[i],
+                                      chunk_starts[i + 1],
+                                      chunk_results[i]);
+            } catch (...) {
+                chunk_errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    for (auto &error : chunk_errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    // chunks are in address order, ids are renumbered on add.
+    for (auto &chunk_result : chunk_results) {
+        for (auto &max_block : chunk_result.getMaximalBlocks()) {
+            result.add(std::move(max_block));
+        }
+    }
+    return result;
+}
+
+std::vector<ElfDisassembler::CodeRange>
+ElfDisassembler::getCodeRangesOfSection(const elf::section &sec) const {
+    // a type_mismatch exception would thrown in case symbol table was not found.
+    const auto &symbols = getCodeSymbolsOfSection(sec);
+    size_t last_addr = sec.get_hdr().addr + sec.get_hdr().size;
+    std::vector<CodeRange> result;
+    result.reserve(symbols.size());
+    for (size_t index = 0; index < symbols.size(); ++index) {
+        if (symbols[index].second == ARMCodeSymbolType::kData) {
+            continue;
+        }
+        CodeRange range;
+        range.m_start_addr = symbols[index].first;
+        if (index + 1 < symbols.size())
+            range.m_size = symbols[index + 1].first - symbols[index].first;
+        else
+            range.m_size = last_addr - symbols[index].first;
+        range.m_type = symbols[index].second;
+        result.push_back(range);
+    }
+    return result;
+}
 
+void ElfDisassembler::disassembleCodeRanges
+    (const elf::section &sec,
+     std::vector<CodeRange>::const_iterator first,
+     std::vector<CodeRange>::const_iterator last,
+     SectionDisassemblyARM &result) const {
     size_t start_addr = sec.get_hdr().addr;
     size_t last_addr = start_addr + sec.get_hdr().size;
 
     MCParser parser{};
     parser.initialize(CS_ARCH_ARM, CS_MODE_THUMB, last_addr);
 
-    const uint8_t *code_ptr = (const uint8_t *) sec.data();
-
-    RawInstWrapper inst;
+    auto inst = RawInstWrapper::fromThreadRing();
     cs_insn *inst_ptr = inst.rawPtr();
 
-    printf("Section Name: %s\n", sec.get_name().c_str());
-
-    size_t index = 0;
-    size_t address = 0;
-    size_t size = 0;
     MaximalBlockBuilder max_block_builder;
-    SectionDisassemblyARM result{&sec};
-    result.reserve(sec.size() / 10);
-
-    for (auto &symbol : symbols) {
-        index++;
-        if (symbol.second == ARMCodeSymbolType::kData) {
-            if (index < symbols.size())
-                // adjust code_ptr to start of next symbol.
-                code_ptr += (symbols[index].first - symbol.first);
-            continue;
+    addr_t prev_end_addr = 0;
+    for (auto range_iter = first; range_iter < last; ++range_iter) {
+        if (AnalysisBudget::shouldStop()) {
+            return;
         }
-        address = symbol.first;
-        if (index < symbols.size())
-            size = symbols[index].first - symbol.first;
-        else
-            size = last_addr - symbol.first;
+        size_t address = range_iter->m_start_addr;
+        size_t size = range_iter->m_size;
+        const uint8_t *code_ptr =
+            (const uint8_t *) sec.data() + (address - start_addr);
+        if (address != prev_end_addr) {
+            // blocks pending from a previous range can't be continued
+            // after a gap.
+            max_block_builder.reset();
+        }
+        prev_end_addr = address + size;
 
-        if (symbol.second == ARMCodeSymbolType::kARM) {
+        if (range_iter->m_type == ARMCodeSymbolType::kARM) {
             parser.changeModeTo(CS_MODE_ARM);
         } else {
             // We assume that the value of code symbol type is strictly
             // either Data, ARM, or Thumb.
             parser.changeModeTo(CS_MODE_THUMB);
         }
+        size_t inst_count = 0;
         while (parser.disasm2(&code_ptr, &size, &address, inst_ptr)) {
+            ++inst_count;
             if (m_analyzer.isBranch(inst_ptr)) {
                 max_block_builder.appendBranch(inst_ptr);
                 result.add(max_block_builder.build());
+                AnalysisBudget::countNodes(1);
             } else {
                 max_block_builder.append(inst_ptr);
             }
         }
+        Progress::advance(range_iter->m_size, inst_count);
     }
-    return result;
 }
 
 SectionDisassemblyARM ElfDisassembler::disassembleSectionbyName
-    (std::string sec_name) const {
-    for (auto &sec : m_elf_file->sections()) {
-        if (sec.get_name() == sec_name) {
-            return disassembleSectionUsingSymbols(sec);
-        }
+    (std::string sec_name, unsigned thread_count) const {
+    auto &sec = m_elf_file->get_section(sec_name);
+    if (sec.valid()) {
+        return disassembleSectionUsingSymbols(sec, thread_count);
     }
     return SectionDisassemblyARM();
 }
 
 SectionDisassemblyARM ElfDisassembler::disassembleSectionbyNameSpeculative
     (std::string sec_name) const {
-    for (auto &sec : m_elf_file->sections()) {
-        if (sec.get_name() == sec_name) {
-            return disassembleSectionSpeculative(sec);
-        }
+    auto &sec = m_elf_file->get_section(sec_name);
+    if (sec.valid()) {
+        return disassembleSectionSpeculative(sec);
     }
     return SectionDisassemblyARM();
 }
 
 void ElfDisassembler::disassembleCodeUsingSymbols() const {
-    for (auto &sec : m_elf_file->sections()) {
-        if (sec.is_alloc() && sec.is_exec()) {
-            disassembleSectionUsingSymbols(sec);
-        }
+    for (auto &sec : m_elf_file->executable_sections()) {
+        disassembleSectionUsingSymbols(sec);
     }
 }
 
 SectionDisassemblyARM ElfDisassembler::disassembleSectionSpeculative
     (const elf::section &sec) const {
+    return disassembleRangeSpeculative
+        (sec, sec.get_hdr().addr, sec.get_hdr().addr + sec.get_hdr().size);
+}
+
+SectionDisassemblyARM ElfDisassembler::disassembleRangeSpeculative
+    (const elf::section &sec, addr_t start_addr, addr_t end_addr) const {
+    SectionDisassemblyARM result;
+    // a single window covering the whole range
+    disassembleRangeSpeculative
+        (sec, start_addr, end_addr, std::numeric_limits<size_t>::max(),
+         [&result](SectionDisassemblyARM &window) {
+             result = std::move(window);
+         });
+    return result;
+}
+
+void ElfDisassembler::disassembleSectionSpeculative
+    (const elf::section &sec,
+     size_t window_size,
+     const SectionDisassemblyConsumer &consumer) const {
+    disassembleRangeSpeculative
+        (sec,
+         sec.get_hdr().addr,
+         sec.get_hdr().addr + sec.get_hdr().size,
+         window_size,
+         consumer);
+}
+
+void ElfDisassembler::disassembleRangeSpeculative
+    (const elf::section &sec,
+     addr_t start_addr,
+     addr_t end_addr,
+     size_t window_size,
+     const SectionDisassemblyConsumer &consumer) const {
+    // windows are analyzed by consumer outside of this phase
+    SPEDI_PHASE_TIMER(decode_timer, kSpeculativeDecode);
+    SPEDI_MEMORY_OWNER(kSectionDisassembly);
+    ScopedAnalysisBudget budget_scope{m_budget};
+    ScopedProgressPhase progress{StatsPhase::kSpeculativeDecode, 0};
+    Progress::addBytesTotal(end_addr - start_addr);
     printf("Section Name: %s\n", sec.get_name().c_str());
-    size_t current_addr = sec.get_hdr().addr;
-    size_t last_addr = sec.get_hdr().addr + sec.get_hdr().size;
-    const uint8_t *code_ptr = (const uint8_t *) sec.data();
+    assert(sec.get_hdr().addr <= start_addr
+               && end_addr <= sec.get_hdr().addr + sec.get_hdr().size
+               && "Invalid range of section!!");
+    assert(window_size > 0 && "Invalid window size!!");
+    size_t current_addr = start_addr;
+    size_t last_addr = end_addr;
+    size_t reported_addr = start_addr;
+    const uint8_t *code_ptr = (const uint8_t *) sec.data()
+        + (start_addr - sec.get_hdr().addr);
 
     MCParser parser;
     parser.initialize(CS_ARCH_ARM, CS_MODE_THUMB, last_addr);
 
-    RawInstWrapper inst;
+    auto inst = RawInstWrapper::fromThreadRing();
     cs_insn *inst_ptr = inst.rawPtr();
 
     MaximalBlockBuilder mb_builder;
-    SectionDisassemblyARM result{&sec};
     // Empirical data suggests that average size of a maximal block is 14 bytes.
     // we try to pre-allocate more MBs to avoid reallocating the vector.
-    result.reserve(sec.size() / 10);
-    std::vector<RawInstWrapper> it_block_insts;
-    it_block_insts.resize(4);
+    const size_t reserved_mb_count =
+        std::min(window_size, end_addr - start_addr) / 10;
+    addr_t window_start_addr = start_addr;
+    SectionDisassemblyARM window{&sec};
+    window.reserve(reserved_mb_count);
+    // IT state can't be controlled inside Capstone while decoding at every
+    // half-word. Conditions of IT blocks are tracked here instead.
+    ITBlockTracker it_tracker;
+    it_tracker.seed(code_ptr, current_addr, (const uint8_t *) sec.data());
     while (current_addr < last_addr) {
         if (parser.disasm(code_ptr, 4, current_addr, inst_ptr)) {
-            // Fix IT condition code due to speculative disassembly
-            if (inst_ptr->id == ARM_INS_IT) {
-                mb_builder.append(inst_ptr);
-                current_addr += 2;
-                code_ptr += 2;
-                auto it_block_size = strlen(inst_ptr->mnemonic) - 1;
-                auto it_current_addr = current_addr;
-                auto it_code_ptr = code_ptr;
-                for (int i = 0; i < it_block_size; ++i) {
-                    auto it_inst_ptr = it_block_insts[i].rawPtr();
-                    size_t buf = 4;
-                    parser.disasm2(&it_code_ptr,
-                                   &buf,
-                                   &it_current_addr,
-                                   it_inst_ptr);
-                    // XXX branch instructions can only appear last in
-                    // an IT block. Instructions setting condition codes
-                    // can appear in IT block.
-                    // Branch instructions that writes to PC can appear.
-                    // XXX We can't do much here since we can't control the
-                    // IT state inside Capstone.
-                }
-                for (int i = 0; i < it_block_size; ++i) {
-                    auto it_inst_ptr = it_block_insts[i].rawPtr();
-                    if (m_analyzer.isBranch(it_inst_ptr)) {
-                        mb_builder.appendBranch(it_inst_ptr);
-                        result.add(mb_builder.build());
-                    } else {
-                        mb_builder.append(it_inst_ptr);
+            auto it_condition = it_tracker.track(inst_ptr);
+            if (m_analyzer.isValid(inst_ptr)) {
+                if (m_analyzer.isBranch(inst_ptr)) {
+                    mb_builder.appendBranch(inst_ptr, it_condition);
+                    MaximalBlock max_block;
+                    {
+                        SPEDI_PHASE(kMaximalBlockBuild);
+                        max_block = mb_builder.build();
                     }
-                    if (it_inst_ptr->size == 4) {
-                        current_addr += 2;
-                        code_ptr += 2;
-                        if (parser.disasm
-                            (code_ptr, 4, current_addr, it_inst_ptr)
-                            && m_analyzer.isValid(it_inst_ptr)) {
-                            if (m_analyzer.isBranch(it_inst_ptr)) {
-                                mb_builder.appendBranch(it_inst_ptr);
-                                result.add(mb_builder.build());
-                            } else {
-                                mb_builder.append(it_inst_ptr);
-                            }
-                        }
+                    Progress::advance(current_addr - reported_addr,
+                                      max_block.instructionsCount());
+                    reported_addr = current_addr;
+                    addr_t block_start_addr = max_block.addrOfFirstInst();
+                    if (window.maximalBlockCount() > 0
+                        && block_start_addr - window_start_addr >= window_size
+                        && window.back().endAddr() <= block_start_addr) {
+                        // no overlap crosses this boundary, hand out window
+                        window.setWindow(window_start_addr, block_start_addr);
+                        SPEDI_PHASE_SUSPEND(decode_timer);
+                        consumer(window);
+                        SPEDI_PHASE_RESUME(decode_timer);
+                        window = SectionDisassemblyARM{&sec};
+                        window.reserve(reserved_mb_count);
+                        window_start_addr = block_start_addr;
                     }
-                    current_addr += 2;
-                    code_ptr += 2;
-                }
-                continue;
-            } else {
-                if (m_analyzer.isValid(inst_ptr)) {
-                    if (m_analyzer.isBranch(inst_ptr)) {
-                        mb_builder.appendBranch(inst_ptr);
-                        result.add(mb_builder.build());
-//                        printf("MB id: %lu at: %lx \n", result.back().id(), result.back().addrOfFirstInst());
-                    } else {
-                        mb_builder.append(inst_ptr);
+                    window.add(std::move(max_block));
+//                    printf("MB id: %lu at: %lx \n", window.back().id(), window.back().addrOfFirstInst());
+                    AnalysisBudget::countNodes(1);
+                    if (AnalysisBudget::shouldStop()) {
+                        // the last window ends with its last block
+                        last_addr = window.back().endAddr();
+                        break;
                     }
+                } else {
+                    mb_builder.append(inst_ptr, it_condition);
                 }
+            } else {
+                SPEDI_COUNT(kInvalidDecodes, 1);
             }
+        } else {
+            it_tracker.trackFailure(current_addr);
+            SPEDI_COUNT(kInvalidDecodes, 1);
         }
         current_addr += 2;
         code_ptr += 2;
     }
-    return result;
+    Progress::advance(last_addr - reported_addr, 0);
+    window.setWindow(window_start_addr, last_addr);
+    SPEDI_PHASE_SUSPEND(decode_timer);
+    consumer(window);
 }
 
 std::vector<SectionDisassemblyARM>
 ElfDisassembler::disassembleCodeSpeculative() const {
     std::vector<SectionDisassemblyARM> result;
-    for (auto &sec : m_elf_file->sections()) {
-        if (sec.is_alloc() && sec.is_exec()) {
-            result.emplace_back(disassembleSectionSpeculative(sec));
-        }
+    for (auto &sec : m_elf_file->executable_sections()) {
+        result.emplace_back(disassembleSectionSpeculative(sec));
     }
     return result;
 }
 
-std::vector<std::pair<size_t, ARMCodeSymbolType>>
+const MappingSymbolIndex::MappingSymbolVec &
 ElfDisassembler::getCodeSymbolsOfSection(const elf::section &sec) const {
-
-    std::vector<std::pair<size_t, ARMCodeSymbolType>> result;
-    // Check for symbol table, if none was found then
-    // the instance is invalid.
-    elf::section sym_sec = m_elf_file->get_section(".symtab");
-    // Returning a valid section means that there was no symbol table
-    //  provided in ELF file.
-    if (!sym_sec.valid())
-        return result;
-
-    size_t start_addr = sec.get_hdr().addr;
-    size_t end_addr = start_addr + sec.get_hdr().size;
-
-    // The following can throw a type_mismatch exception in case
-    // of corrupted symbol table in ELF.
-
-    for (auto symbol: sym_sec.as_symtab()) {
-        size_t value = symbol.get_data().value;
-        // we assume that the start addr of each section is available in
-        // code symbols.
-        if ((start_addr <= value) && (value < end_addr)) {
-            if (symbol.get_name() == ARMCodeSymbolVal::kThumb()) {
-                result.emplace_back
-                    (std::make_pair(value, ARMCodeSymbolType::kThumb));
-            } else if (symbol.get_name() == ARMCodeSymbolVal::kARM()) {
-                result.emplace_back
-                    (std::make_pair(value, ARMCodeSymbolType::kARM));
-            } else if (symbol.get_name() == ARMCodeSymbolVal::kData()) {
-                result.emplace_back
-                    (std::make_pair(value, ARMCodeSymbolType::kData));
-            }
-        }
-    }
-    // Symbols are not necessary sorted, this step is required to
-    // avoid potential SEGEV.
-    std::sort(result.begin(), result.end());
-    return result;
+    // a corrupted symbol table throws here and is retried on next call
+    std::call_once(m_mapping_symbols->m_once, [this]() {
+        m_mapping_symbols->m_index = MappingSymbolIndex{*m_elf_file};
+    });
+    return m_mapping_symbols->m_index.symbolsOf(sec);
 }
 
 bool
 ElfDisassembler::isSymbolTableAvailable() {
-    elf::section sym_sec = m_elf_file->get_section(".symtab");
+    auto &sym_sec = m_elf_file->get_section(".symtab");
     // Returning a invalid section means that there was no symbol table
     //  provided in ELF file.
 
@@ -284,19 +390,7 @@ ISAType ElfDisassembler::getInitialMode() const {
 
 const std::pair<addr_t, addr_t>
 ElfDisassembler::getExecutableRegion() {
-    addr_t start_addr = UINT64_MAX;
-    addr_t end_addr = 0;
-    for (auto &sec : m_elf_file->sections()) {
-        if (sec.is_alloc() && sec.is_exec()) {
-            if (sec.get_hdr().addr < start_addr) {
-                start_addr = sec.get_hdr().addr;
-            }
-            if (end_addr < sec.get_hdr().addr + sec.get_hdr().size) {
-                end_addr = sec.get_hdr().addr + sec.get_hdr().size;
-            }
-        }
-    }
-    return std::pair<disasm::addr_t, disasm::addr_t>(start_addr, end_addr);
+    return m_elf_file->executable_range();
 }
 
 ISAType
@@ -351,6 +445,22 @@ void ElfDisassembler::prettyPrintCapstoneInst
     }
 }
 
+void ElfDisassembler::setBudget(AnalysisBudget *budget) noexcept {
+    m_budget = budget;
+}
+
+void ElfDisassembler::setLineTable
+    (const LineTableIndex *line_table) noexcept {
+    m_line_table = line_table;
+}
+
+void ElfDisassembler::prettyPrintSourceLine(addr_t addr) const {
+    LineTableIndex::Row row;
+    if (m_line_table != nullptr && m_line_table->find(addr, row)) {
+        printf("\t; %s:%u", m_line_table->fileName(row.m_file), row.m_line);
+    }
+}
+
 void ElfDisassembler::prettyPrintMaximalBlock
     (const MaximalBlock *mblock) const {
     printf("**************************************\n");
@@ -370,11 +480,14 @@ void ElfDisassembler::prettyPrintMaximalBlock
     }
     for (const auto &inst :mblock->getInstructions()) {
         printf("0x%" PRIx64 ":\t%s\t\t%s ",
-               inst.addr(), inst.mnemonic().c_str(), inst.operands().c_str());
+               inst.addr(),
+               inst.effectiveMnemonic().c_str(),
+               inst.operands().c_str());
         if (inst.condition() != ARM_CC_AL) {
             printf("/ condition: %s",
                    m_analyzer.conditionCodeToString(inst.condition()).c_str());
         }
+        prettyPrintSourceLine(inst.addr());
         printf("\n");
     }
     printf("Direct branch: %d, Conditional: %d",
@@ -407,11 +520,14 @@ void ElfDisassembler::prettyPrintCFGNode
     }
     for (auto &inst :mblock->getInstructions()) {
         printf("0x%" PRIx64 ":\t%s\t\t%s ",
-               inst.addr(), inst.mnemonic().c_str(), inst.operands().c_str());
+               inst.addr(),
+               inst.effectiveMnemonic().c_str(),
+               inst.operands().c_str());
         if (inst.condition() != ARM_CC_AL) {
             printf("/ condition: %s",
                    m_analyzer.conditionCodeToString(inst.condition()).c_str());
         }
+        prettyPrintSourceLine(inst.addr());
         printf("\n");
     }
     printf("Direct branch: %d, Conditional: %d",
@@ -462,12 +578,13 @@ void ElfDisassembler::prettyPrintValidCFGNode
         for (const auto inst : cfg_node->getCandidateInstructions()) {
             printf("0x%" PRIx64 ":\t%s\t\t%s ",
                    inst->addr(),
-                   inst->mnemonic().c_str(),
+                   inst->effectiveMnemonic().c_str(),
                    inst->operands().c_str());
 //            if (inst->condition() != ARM_CC_AL) {
 //                printf("/ condition: %s",
 //                       m_analyzer.conditionCodeToString(inst->condition()).c_str());
 //            }
+            prettyPrintSourceLine(inst->addr());
             printf("\n");
         }
         printf("Direct branch: %d, Conditional: %d",
@@ -12,6 +12,12 @@
 #include "binutils/elf/elf++.hh"
 #include "MCParser.h"
 #include "MaximalBlockBuilder.h"
+#include "MappingSymbolIndex.h"
+#include "LineTableIndex.h"
+#include "AnalysisBudget.h"
+#include <functional>
+#include <memory>
+#include <mutex>
 
 #define EM_ARM  40 // From elf.h
 namespace disasm {
@@ -22,16 +28,22 @@ class BasicBlock;
 
 class ARMCodeSymbolVal {
 public:
-    static std::string
+    static const char *
     kThumb() { return "$t"; }
 
-    static std::string
+    static const char *
     kARM() { return "$a"; }
 
-    static std::string
+    static const char *
     kData() { return "$d"; }
 };
 
+/*
+ * Receives a window of maximal blocks. The window is discarded once the
+ * consumer returns, hence, anything to be kept has to be moved out.
+ */
+using SectionDisassemblyConsumer = std::function<void(SectionDisassemblyARM &)>;
+
 enum class PrettyPrintConfig: unsigned {
     kHideDataNodes,
     kDisplayDataNodes
@@ -62,12 +74,41 @@ public:
 
     SectionDisassemblyARM disassembleSectionUsingSymbols
         (const elf::section &sec) const;
+    /*
+     * Decodes code ranges given by mapping symbols using up to
+     * thread_count workers, each with its own Capstone handle. The result
+     * is identical to the one of serial disassembly.
+     */
+    SectionDisassemblyARM disassembleSectionUsingSymbols
+        (const elf::section &sec, unsigned thread_count) const;
     SectionDisassemblyARM disassembleSectionSpeculative
         (const elf::section &sec) const;
+    /*
+     * Speculatively disassembles [start_addr, end_addr) of the given section.
+     * The range can start inside an IT block.
+     */
+    SectionDisassemblyARM disassembleRangeSpeculative
+        (const elf::section &sec, addr_t start_addr, addr_t end_addr) const;
+    /*
+     * Streams speculative disassembly of the given section to consumer in
+     * windows of about window_size bytes. A window ends only where its last
+     * maximal block does not overlap the next one. Memory usage is thus
+     * proportional to window_size rather than to section size.
+     */
+    void disassembleSectionSpeculative
+        (const elf::section &sec,
+         size_t window_size,
+         const SectionDisassemblyConsumer &consumer) const;
+    void disassembleRangeSpeculative
+        (const elf::section &sec,
+         addr_t start_addr,
+         addr_t end_addr,
+         size_t window_size,
+         const SectionDisassemblyConsumer &consumer) const;
     std::vector<SectionDisassemblyARM> disassembleCodeSpeculative() const;
 
     SectionDisassemblyARM disassembleSectionbyName
-        (std::string sec_name) const;
+        (std::string sec_name, unsigned thread_count = 1) const;
     SectionDisassemblyARM disassembleSectionbyNameSpeculative
         (std::string sec_name) const;
     const std::pair<addr_t, addr_t> getExecutableRegion();
@@ -95,16 +136,54 @@ public:
          const PrettyPrintConfig config = PrettyPrintConfig::kHideDataNodes)
         const;
     void prettyPrintSwitchTables(const DisassemblyCFG *sec_cfg) const;
+    /*
+     * Pretty printers annotate instructions with source lines of given
+     * table. Passing nullptr disables annotation.
+     */
+    void setLineTable(const LineTableIndex *line_table) noexcept;
+    /*
+     * Decoding stops early once budget is exhausted, the result then covers
+     * only a prefix of the section. Each maximal block counts as a node.
+     * Passing nullptr keeps the budget of the calling thread, if any.
+     * precondition: budget outlives this disassembler.
+     */
+    void setBudget(AnalysisBudget *budget) noexcept;
     const RawInstAnalyzer *getMCAnalyzer() const;
 
 private:
+    // a range of ARM or Thumb code delimited by mapping symbols
+    struct CodeRange {
+        addr_t m_start_addr;
+        size_t m_size;
+        ARMCodeSymbolType m_type;
+    };
+    std::vector<CodeRange> getCodeRangesOfSection
+        (const elf::section &sec) const;
+    void disassembleCodeRanges
+        (const elf::section &sec,
+         std::vector<CodeRange>::const_iterator first,
+         std::vector<CodeRange>::const_iterator last,
+         SectionDisassemblyARM &result) const;
     void prettyPrintCapstoneInst
         (const csh &handle, cs_insn *inst, bool details_enabled) const;
-    std::vector<std::pair<size_t, ARMCodeSymbolType>>
+    void prettyPrintSourceLine(addr_t addr) const;
+    /*
+     * Mapping symbols are indexed on first use, which is thread-safe.
+     * Speculative disassembly does not use them.
+     */
+    const MappingSymbolIndex::MappingSymbolVec &
         getCodeSymbolsOfSection(const elf::section &sec) const;
 private:
+    struct LazyMappingSymbols {
+        std::once_flag m_once;
+        MappingSymbolIndex m_index;
+    };
     bool m_valid;
     mutable RawInstAnalyzer m_analyzer;
     const elf::elf *m_elf_file;
+    // behind a pointer to keep this movable
+    std::unique_ptr<LazyMappingSymbols> m_mapping_symbols;
+    const LineTableIndex *m_line_table;
+    AnalysisBudget *m_budget;
 };
 }
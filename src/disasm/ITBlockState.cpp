@@ -0,0 +1,82 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "ITBlockState.h"
+
+namespace disasm {
+
+ITBlockState::ITBlockState(uint16_t it_inst) :
+    m_state{static_cast<uint8_t>(it_inst & 0xFF)} {
+}
+
+arm_cc ITBlockState::condition() const noexcept {
+    unsigned cond = (m_state >> 4) & 0xF;
+    // Capstone's arm_cc starts with ARM_CC_INVALID, encoded conditions
+    // start right after it.
+    if (cond >= 0xE) {
+        return ARM_CC_AL;
+    }
+    return static_cast<arm_cc>(cond + 1);
+}
+
+unsigned ITBlockState::remainingCount() const noexcept {
+    if (!inITBlock()) {
+        return 0;
+    }
+    // the lowest set bit of mask marks the last instruction in block
+    unsigned count = 4;
+    for (unsigned mask = m_state & 0xF; (mask & 1) == 0; mask >>= 1) {
+        --count;
+    }
+    return count;
+}
+
+void ITBlockState::advance() noexcept {
+    if ((m_state & 0x7) == 0) {
+        m_state = 0;
+    } else {
+        m_state = static_cast<uint8_t>
+        ((m_state & 0xE0) | ((m_state << 1) & 0x1F));
+    }
+}
+
+const char *ITBlockState::conditionSuffix(arm_cc condition) noexcept {
+    switch (condition) {
+        case ARM_CC_EQ:
+            return "eq";
+        case ARM_CC_NE:
+            return "ne";
+        case ARM_CC_HS:
+            return "hs";
+        case ARM_CC_LO:
+            return "lo";
+        case ARM_CC_MI:
+            return "mi";
+        case ARM_CC_PL:
+            return "pl";
+        case ARM_CC_VS:
+            return "vs";
+        case ARM_CC_VC:
+            return "vc";
+        case ARM_CC_HI:
+            return "hi";
+        case ARM_CC_LS:
+            return "ls";
+        case ARM_CC_GE:
+            return "ge";
+        case ARM_CC_LT:
+            return "lt";
+        case ARM_CC_GT:
+            return "gt";
+        case ARM_CC_LE:
+            return "le";
+        default:
+            return "";
+    }
+}
+}
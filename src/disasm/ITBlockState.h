@@ -0,0 +1,69 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include "common.h"
+#include <capstone/arm.h>
+
+namespace disasm {
+
+/**
+ * ITBlockState
+ * Thumb-2 IT execution state (ITSTATE) as encoded in the firstcond and mask
+ * fields of an IT instruction. Conditions of instructions inside an IT block
+ * are derived from this state without consulting Capstone.
+ */
+class ITBlockState {
+public:
+    /**
+     * Construct a state that is outside of any IT block.
+     */
+    ITBlockState() : m_state{0} { }
+    /**
+     * Initializes state from the raw half-word encoding of an IT instruction.
+     */
+    explicit ITBlockState(uint16_t it_inst);
+    virtual ~ITBlockState() = default;
+    ITBlockState(const ITBlockState &src) = default;
+    ITBlockState &operator=(const ITBlockState &src) = default;
+    ITBlockState(ITBlockState &&src) = default;
+
+    /*
+     * returns true if the given half-word encodes an IT instruction.
+     * A zero mask encodes a hint instruction (e.g., nop) instead.
+     */
+    static bool isITInstruction(uint16_t hword) noexcept {
+        return (hword & 0xFF00) == 0xBF00 && (hword & 0x000F) != 0;
+    }
+
+    bool inITBlock() const noexcept { return (m_state & 0x0F) != 0; }
+    /*
+     * condition of the next instruction in IT block.
+     * precondition: inITBlock()
+     */
+    arm_cc condition() const noexcept;
+    /*
+     * number of instructions that are still affected by IT block.
+     */
+    unsigned remainingCount() const noexcept;
+    /*
+     * moves to next instruction in IT block (ITAdvance() in ARM ARM).
+     */
+    void advance() noexcept;
+
+    /*
+     * returns the condition suffix used in assembly mnemonics, e.g., "eq".
+     * An empty string is returned for ARM_CC_AL.
+     */
+    static const char *conditionSuffix(arm_cc condition) noexcept;
+
+private:
+    uint8_t m_state;
+};
+}
@@ -0,0 +1,166 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "ITBlockTracker.h"
+#include <cstring>
+
+namespace disasm {
+
+namespace {
+// returns true if the half-word is the first of a 32-bit Thumb instruction
+inline bool isWideThumbPrefix(uint16_t hword) {
+    return (hword & 0xF800) >= 0xE800;
+}
+
+inline uint16_t readHalfWord(const uint8_t *code_ptr) {
+    return static_cast<uint16_t>(code_ptr[0] | (code_ptr[1] << 8));
+}
+
+/*
+ * returns true for branches that are conditional by their encoding, i.e.,
+ * b<cond> (T1 and T3), cbz, and cbnz. Capstone's IT state must not be
+ * undone on them as the condition is their own.
+ */
+inline bool encodesCondition(const cs_insn *inst) {
+    auto first = readHalfWord(inst->bytes);
+    if (inst->size == 2) {
+        // b<cond> T1, cond 0b1110 and 0b1111 are udf and svc
+        if ((first & 0xF000) == 0xD000 && (first & 0x0E00) != 0x0E00) {
+            return true;
+        }
+        // cbz and cbnz
+        return (first & 0xF500) == 0xB100;
+    }
+    auto second = readHalfWord(inst->bytes + 2);
+    // b<cond> T3, cond 0b111x encodes other instructions
+    return (first & 0xF800) == 0xF000 && (second & 0xD000) == 0x8000
+        && (first & 0x0380) != 0x0380;
+}
+}
+
+ITBlockTracker::ITBlockTracker() :
+    m_path_count{0} {
+}
+
+void ITBlockTracker::seed(const uint8_t *code_ptr,
+                          addr_t addr,
+                          const uint8_t *code_start) noexcept {
+    // An IT block spans at most four 32-bit instructions. Hence, its IT
+    // instruction can be found at most 7 half-words before addr.
+    for (unsigned distance = 14; distance >= 2; distance -= 2) {
+        if (static_cast<size_t>(code_ptr - code_start) < distance) {
+            continue;
+        }
+        auto it_ptr = code_ptr - distance;
+        if (!ITBlockState::isITInstruction(readHalfWord(it_ptr))) {
+            continue;
+        }
+        ITBlockState state{readHalfWord(it_ptr)};
+        auto current_ptr = it_ptr + 2;
+        while (current_ptr < code_ptr && state.inITBlock()) {
+            current_ptr += isWideThumbPrefix(readHalfWord(current_ptr)) ? 4 : 2;
+            state.advance();
+        }
+        if (current_ptr == code_ptr && state.inITBlock()) {
+            addPath(addr, state);
+        }
+    }
+}
+
+arm_cc ITBlockTracker::track(cs_insn *inst) noexcept {
+    if (m_capstone_state.inITBlock()) {
+        // Capstone applied its IT state to this instruction regardless of
+        // its address.
+        if (inst->detail->arm.cc == m_capstone_state.condition()
+            && inst->detail->arm.cc != ARM_CC_AL
+            && !encodesCondition(inst)) {
+            removeConditionSuffix(inst);
+            inst->detail->arm.cc = ARM_CC_AL;
+        }
+        m_capstone_state.advance();
+    }
+    arm_cc result = ARM_CC_INVALID;
+    unsigned i = 0;
+    while (i < m_path_count) {
+        auto &path = m_paths[i];
+        if (path.m_next_addr == inst->address) {
+            if (result == ARM_CC_INVALID) {
+                result = path.m_state.condition();
+            }
+            path.m_state.advance();
+            path.m_next_addr += inst->size;
+        }
+        if (path.m_next_addr < inst->address || !path.m_state.inITBlock()) {
+            // path finished or its next instruction could not be decoded.
+            m_paths[i] = m_paths[m_path_count - 1];
+            --m_path_count;
+            continue;
+        }
+        ++i;
+    }
+    if (inst->id == ARM_INS_IT) {
+        ITBlockState state{readHalfWord(inst->bytes)};
+        addPath(inst->address + 2, state);
+        m_capstone_state = state;
+    }
+    return result;
+}
+
+void ITBlockTracker::trackFailure(addr_t addr) noexcept {
+    if (m_capstone_state.inITBlock()) {
+        m_capstone_state.advance();
+    }
+    unsigned i = 0;
+    while (i < m_path_count) {
+        if (m_paths[i].m_next_addr == addr) {
+            // next instruction of path could not be decoded.
+            m_paths[i] = m_paths[m_path_count - 1];
+            --m_path_count;
+            continue;
+        }
+        ++i;
+    }
+}
+
+void ITBlockTracker::reset() noexcept {
+    m_path_count = 0;
+    m_capstone_state = ITBlockState();
+}
+
+void ITBlockTracker::addPath
+    (addr_t next_addr, const ITBlockState &state) noexcept {
+    if (m_path_count == kMaxPathCount) {
+        for (unsigned i = 1; i < kMaxPathCount; ++i) {
+            m_paths[i - 1] = m_paths[i];
+        }
+        --m_path_count;
+    }
+    m_paths[m_path_count].m_next_addr = next_addr;
+    m_paths[m_path_count].m_state = state;
+    ++m_path_count;
+}
+
+void ITBlockTracker::removeConditionSuffix(cs_insn *inst) noexcept {
+    auto suffix = ITBlockState::conditionSuffix(inst->detail->arm.cc);
+    auto suffix_len = strlen(suffix);
+    auto mnemonic_len = strlen(inst->mnemonic);
+    // condition suffix precedes width qualifiers like ".w"
+    auto qualifier = strchr(inst->mnemonic, '.');
+    size_t suffix_end =
+        (qualifier != nullptr) ? qualifier - inst->mnemonic : mnemonic_len;
+    if (suffix_len == 0 || suffix_end < suffix_len
+        || strncmp(inst->mnemonic + suffix_end - suffix_len,
+                   suffix,
+                   suffix_len) != 0) {
+        return;
+    }
+    memmove(inst->mnemonic + suffix_end - suffix_len,
+            inst->mnemonic + suffix_end,
+            mnemonic_len - suffix_end + 1);
+}
+}
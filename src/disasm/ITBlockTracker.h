@@ -0,0 +1,74 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include "ITBlockState.h"
+#include <capstone/capstone.h>
+#include <array>
+
+namespace disasm {
+
+/**
+ * ITBlockTracker
+ * Tracks IT blocks during speculative disassembly where an instruction is
+ * decoded at every half-word. Each IT instruction starts a path of up to
+ * four instructions whose conditions are derived from its IT state.
+ *
+ * Capstone keeps its own IT state in the handle and applies it to whatever
+ * is decoded next. That state is mirrored here so that conditions Capstone
+ * applies to instructions off an IT path can be undone.
+ */
+class ITBlockTracker {
+public:
+    ITBlockTracker();
+    virtual ~ITBlockTracker() = default;
+    ITBlockTracker(const ITBlockTracker &src) = default;
+    ITBlockTracker &operator=(const ITBlockTracker &src) = default;
+    ITBlockTracker(ITBlockTracker &&src) = default;
+
+    /*
+     * Registers IT blocks that start before addr and still cover it. Needed
+     * when a sweep begins in the middle of an IT block. code_ptr points
+     * to the bytes at addr and code_start bounds the look-back.
+     */
+    void seed(const uint8_t *code_ptr,
+              addr_t addr,
+              const uint8_t *code_start) noexcept;
+
+    /*
+     * Must be called for every instruction successfully decoded by Capstone
+     * in decoding order. Undoes conditions wrongly applied by Capstone and
+     * returns the condition imposed by a tracked IT block, or ARM_CC_INVALID
+     * if the instruction is not on an IT path.
+     */
+    arm_cc track(cs_insn *inst) noexcept;
+    /*
+     * Must be called for every half-word Capstone failed to decode, since
+     * Capstone advances its IT state regardless.
+     */
+    void trackFailure(addr_t addr) noexcept;
+
+    void reset() noexcept;
+
+private:
+    void addPath(addr_t next_addr, const ITBlockState &state) noexcept;
+    static void removeConditionSuffix(cs_insn *inst) noexcept;
+
+private:
+    struct ITPath {
+        addr_t m_next_addr;
+        ITBlockState m_state;
+    };
+    // overlapping IT paths are rare, older paths are dropped when full.
+    static constexpr unsigned kMaxPathCount = 4;
+    std::array<ITPath, kMaxPathCount> m_paths;
+    unsigned m_path_count;
+    ITBlockState m_capstone_state;
+};
+}
@@ -0,0 +1,278 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "LineTableIndex.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace disasm {
+
+static const char kMagic[8] = {'S', 'P', 'E', 'D', 'I', 'L', 'T', '\0'};
+static const uint32_t kVersion = 1;
+
+/*
+ * Image layout: header followed by the columns, each aligned to 8 bytes.
+ * Offsets are relative to the start of the image.
+ */
+struct LineTableIndex::Header {
+    char m_magic[8];
+    uint32_t m_version;
+    uint32_t m_row_count;
+    uint32_t m_file_count;
+    uint32_t m_file_names_size;
+    uint64_t m_source_key;
+    uint64_t m_addrs_offset;
+    uint64_t m_lines_offset;
+    uint64_t m_files_offset;
+    uint64_t m_flags_offset;
+    uint64_t m_file_name_offsets_offset;
+    uint64_t m_file_names_offset;
+};
+
+static uint64_t alignTo8(uint64_t offset) {
+    return (offset + 7) & ~7ULL;
+}
+
+LineTableIndex::LineTableIndex() :
+    m_image_size{0},
+    m_header{nullptr},
+    m_addrs{nullptr},
+    m_lines{nullptr},
+    m_files{nullptr},
+    m_flags{nullptr},
+    m_file_name_offsets{nullptr},
+    m_file_names{nullptr} {
+}
+
+LineTableIndex LineTableIndex::build
+    (std::vector<Row> rows,
+     const std::vector<std::string> &files,
+     uint64_t source_key) {
+    // At equal addresses, the end of a sequence precedes the start
+    // of the next one so that the latter is kept.
+    std::stable_sort(rows.begin(), rows.end(),
+                     [](const Row &a, const Row &b) {
+                         if (a.m_addr != b.m_addr) {
+                             return a.m_addr < b.m_addr;
+                         }
+                         return a.isEndOfSequence() && !b.isEndOfSequence();
+                     });
+    // drop rows shadowed by a later row of the same address
+    size_t row_count = 0;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (i + 1 < rows.size() && rows[i + 1].m_addr == rows[i].m_addr) {
+            continue;
+        }
+        rows[row_count++] = rows[i];
+    }
+    rows.resize(row_count);
+
+    uint64_t file_names_size = 0;
+    for (auto &file : files) {
+        file_names_size += file.size() + 1;
+    }
+    Header header;
+    std::memcpy(header.m_magic, kMagic, sizeof(kMagic));
+    header.m_version = kVersion;
+    header.m_row_count = static_cast<uint32_t>(row_count);
+    header.m_file_count = static_cast<uint32_t>(files.size());
+    header.m_file_names_size = static_cast<uint32_t>(file_names_size);
+    header.m_source_key = source_key;
+    header.m_addrs_offset = alignTo8(sizeof(Header));
+    header.m_lines_offset =
+        alignTo8(header.m_addrs_offset + row_count * sizeof(uint64_t));
+    header.m_files_offset =
+        alignTo8(header.m_lines_offset + row_count * sizeof(uint32_t));
+    header.m_flags_offset =
+        alignTo8(header.m_files_offset + row_count * sizeof(uint32_t));
+    header.m_file_name_offsets_offset =
+        alignTo8(header.m_flags_offset + row_count * sizeof(uint8_t));
+    header.m_file_names_offset =
+        alignTo8(header.m_file_name_offsets_offset
+                     + files.size() * sizeof(uint32_t));
+    size_t image_size = header.m_file_names_offset + file_names_size;
+
+    std::shared_ptr<uint8_t> image
+        (new uint8_t[image_size](), std::default_delete<uint8_t[]>());
+    auto base = image.get();
+    std::memcpy(base, &header, sizeof(Header));
+    auto addrs = reinterpret_cast<uint64_t *>(base + header.m_addrs_offset);
+    auto lines = reinterpret_cast<uint32_t *>(base + header.m_lines_offset);
+    auto file_idxs = reinterpret_cast<uint32_t *>(base + header.m_files_offset);
+    auto flags = base + header.m_flags_offset;
+    for (size_t i = 0; i < row_count; ++i) {
+        addrs[i] = rows[i].m_addr;
+        lines[i] = rows[i].m_line;
+        file_idxs[i] = rows[i].m_file;
+        flags[i] = rows[i].m_flags;
+    }
+    auto name_offsets = reinterpret_cast<uint32_t *>
+        (base + header.m_file_name_offsets_offset);
+    auto names = reinterpret_cast<char *>(base + header.m_file_names_offset);
+    uint32_t name_offset = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        name_offsets[i] = name_offset;
+        std::memcpy(names + name_offset,
+                    files[i].c_str(),
+                    files[i].size() + 1);
+        name_offset += files[i].size() + 1;
+    }
+
+    LineTableIndex result;
+    result.setImage(image, image_size);
+    return result;
+}
+
+LineTableIndex LineTableIndex::load
+    (const std::string &path, uint64_t source_key) {
+    LineTableIndex result;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return result;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0
+        || static_cast<size_t>(file_stat.st_size) < sizeof(Header)) {
+        close(fd);
+        return result;
+    }
+    size_t size = file_stat.st_size;
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return result;
+    }
+    std::shared_ptr<const uint8_t> image
+        (static_cast<const uint8_t *>(data),
+         [size](const uint8_t *ptr) {
+             munmap(const_cast<uint8_t *>(ptr), size);
+         });
+
+    // validate before trusting any offset
+    auto header = reinterpret_cast<const Header *>(image.get());
+    if (std::memcmp(header->m_magic, kMagic, sizeof(kMagic)) != 0
+        || header->m_version != kVersion
+        || header->m_source_key != source_key) {
+        return result;
+    }
+    uint64_t rows = header->m_row_count;
+    uint64_t files = header->m_file_count;
+    const std::pair<uint64_t, uint64_t> columns[] = {
+        {header->m_addrs_offset, rows * sizeof(uint64_t)},
+        {header->m_lines_offset, rows * sizeof(uint32_t)},
+        {header->m_files_offset, rows * sizeof(uint32_t)},
+        {header->m_flags_offset, rows * sizeof(uint8_t)},
+        {header->m_file_name_offsets_offset, files * sizeof(uint32_t)},
+        {header->m_file_names_offset, header->m_file_names_size}};
+    for (auto &column : columns) {
+        if (column.first % 8 != 0 || column.first > size
+            || column.second > size - column.first) {
+            return result;
+        }
+    }
+    auto names = reinterpret_cast<const char *>
+        (image.get() + header->m_file_names_offset);
+    if (header->m_file_names_size > 0
+        && names[header->m_file_names_size - 1] != '\0') {
+        return result;
+    }
+    auto name_offsets = reinterpret_cast<const uint32_t *>
+        (image.get() + header->m_file_name_offsets_offset);
+    for (uint64_t i = 0; i < files; ++i) {
+        if (name_offsets[i] >= header->m_file_names_size) {
+            return result;
+        }
+    }
+    result.setImage(image, size);
+    return result;
+}
+
+bool LineTableIndex::save(const std::string &path) const {
+    if (!valid()) {
+        return false;
+    }
+    // written next to the target and renamed to never expose a partial file
+    std::string tmp_path = path + ".tmp";
+    FILE *file = fopen(tmp_path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool written = fwrite(m_image.get(), 1, m_image_size, file) == m_image_size;
+    written = (fclose(file) == 0) && written;
+    if (!written || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void LineTableIndex::setImage
+    (std::shared_ptr<const uint8_t> image, size_t image_size) {
+    auto base = image.get();
+    m_header = reinterpret_cast<const Header *>(base);
+    m_addrs = reinterpret_cast<const uint64_t *>
+        (base + m_header->m_addrs_offset);
+    m_lines = reinterpret_cast<const uint32_t *>
+        (base + m_header->m_lines_offset);
+    m_files = reinterpret_cast<const uint32_t *>
+        (base + m_header->m_files_offset);
+    m_flags = base + m_header->m_flags_offset;
+    m_file_name_offsets = reinterpret_cast<const uint32_t *>
+        (base + m_header->m_file_name_offsets_offset);
+    m_file_names = reinterpret_cast<const char *>
+        (base + m_header->m_file_names_offset);
+    m_image = std::move(image);
+    m_image_size = image_size;
+}
+
+bool LineTableIndex::valid() const noexcept {
+    return m_header != nullptr;
+}
+
+size_t LineTableIndex::size() const noexcept {
+    return valid() ? m_header->m_row_count : 0;
+}
+
+size_t LineTableIndex::fileCount() const noexcept {
+    return valid() ? m_header->m_file_count : 0;
+}
+
+uint64_t LineTableIndex::sourceKey() const noexcept {
+    return valid() ? m_header->m_source_key : 0;
+}
+
+bool LineTableIndex::find(addr_t addr, Row &row) const noexcept {
+    auto count = size();
+    auto iter = std::upper_bound(m_addrs, m_addrs + count,
+                                 static_cast<uint64_t>(addr));
+    if (iter == m_addrs) {
+        return false;
+    }
+    row = rowAt(iter - m_addrs - 1);
+    return !row.isEndOfSequence();
+}
+
+LineTableIndex::Row LineTableIndex::rowAt(size_t index) const noexcept {
+    return {static_cast<addr_t>(m_addrs[index]),
+            m_files[index],
+            m_lines[index],
+            m_flags[index]};
+}
+
+const char *LineTableIndex::fileName(unsigned file) const noexcept {
+    if (file >= fileCount()) {
+        return "";
+    }
+    return m_file_names + m_file_name_offsets[file];
+}
+}
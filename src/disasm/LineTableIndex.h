@@ -0,0 +1,104 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace disasm {
+
+/**
+ * LineTableIndex
+ * Flattened address to line mapping of all compilation units. Rows are
+ * sorted by address and stored column-wise in a single image which can be
+ * saved to and mapped from a sidecar file without any decoding.
+ */
+class LineTableIndex {
+public:
+    enum LineFlags : uint8_t {
+        kIsStmt = 1,
+        kBasicBlock = 2,
+        kEndSequence = 4,
+        kPrologueEnd = 8,
+        kEpilogueBegin = 16
+    };
+
+    /*
+     * A row covers all addresses up to the address of the next row.
+     */
+    struct Row {
+        addr_t m_addr;
+        unsigned m_file;
+        unsigned m_line;
+        uint8_t m_flags;
+        bool isEndOfSequence() const noexcept {
+            return (m_flags & kEndSequence) != 0;
+        }
+    };
+
+    /**
+     * Construct an empty index that is not valid.
+     */
+    LineTableIndex();
+    virtual ~LineTableIndex() = default;
+    LineTableIndex(const LineTableIndex &src) = default;
+    LineTableIndex &operator=(const LineTableIndex &src) = default;
+    LineTableIndex(LineTableIndex &&src) = default;
+    LineTableIndex &operator=(LineTableIndex &&src) = default;
+
+    /*
+     * Sorts rows by address. At equal addresses, the last row
+     * with its end of sequence flag cleared is kept. m_file of rows
+     * indexes files. source_key identifies the debug info rows were
+     * read from.
+     */
+    static LineTableIndex build
+        (std::vector<Row> rows,
+         const std::vector<std::string> &files,
+         uint64_t source_key);
+    /*
+     * Maps a sidecar file written by save. Returns an invalid index if the
+     * file is missing, malformed, or was built from a different source_key.
+     */
+    static LineTableIndex load(const std::string &path, uint64_t source_key);
+    bool save(const std::string &path) const;
+
+    bool valid() const noexcept;
+    size_t size() const noexcept;
+    size_t fileCount() const noexcept;
+    uint64_t sourceKey() const noexcept;
+
+    /*
+     * finds the row covering addr. Returns false if addr is not covered.
+     */
+    bool find(addr_t addr, Row &row) const noexcept;
+    Row rowAt(size_t index) const noexcept;
+    const char *fileName(unsigned file) const noexcept;
+
+private:
+    struct Header;
+    void setImage(std::shared_ptr<const uint8_t> image, size_t image_size);
+
+private:
+    // holds either a heap buffer or a file mapping
+    std::shared_ptr<const uint8_t> m_image;
+    size_t m_image_size;
+    const Header *m_header;
+    // columns
+    const uint64_t *m_addrs;
+    const uint32_t *m_lines;
+    const uint32_t *m_files;
+    const uint8_t *m_flags;
+    const uint32_t *m_file_name_offsets;
+    const char *m_file_names;
+};
+}
@@ -7,6 +7,8 @@
 // Copyright (c) 2015-2016 University of Kaiserslautern.
 
 #include "MCInst.h"
+#include "ITBlockState.h"
+#include <cstring>
 
 namespace disasm {
 
@@ -15,7 +17,8 @@ MCInst::MCInst(const cs_insn *inst) :
     m_addr{inst->address},
     m_size{inst->size},
     m_mnemonic{inst->mnemonic},
-    m_operands{inst->op_str} {
+    m_operands{inst->op_str},
+    m_it_condition{ARM_CC_INVALID} {
     m_detail = *(inst->detail);
 }
 
@@ -40,6 +43,9 @@ bool MCInst::operator==(MCInst &other) const noexcept {
 }
 
 arm_cc MCInst::condition() const noexcept {
+    if (hasITCondition()) {
+        return static_cast<arm_cc>(m_it_condition);
+    }
     return m_detail.arm.cc;
 }
 
@@ -59,11 +65,38 @@ const std::string &MCInst::operands() const noexcept {
     return m_operands;
 }
 
-void MCInst::setMnemonic(const std::string &mnemonic) noexcept {
-    m_mnemonic = mnemonic;
+std::string MCInst::effectiveMnemonic() const {
+    if (!hasITCondition() || condition() == m_detail.arm.cc) {
+        return m_mnemonic;
+    }
+    std::string result = m_mnemonic;
+    // condition suffix precedes width qualifiers like ".w"
+    auto suffix_pos = result.find('.');
+    if (suffix_pos == std::string::npos) {
+        suffix_pos = result.size();
+    }
+    auto decoded_suffix = ITBlockState::conditionSuffix(m_detail.arm.cc);
+    auto decoded_len = strlen(decoded_suffix);
+    if (decoded_len > 0 && suffix_pos >= decoded_len
+        && result.compare(suffix_pos - decoded_len,
+                          decoded_len,
+                          decoded_suffix) == 0) {
+        suffix_pos -= decoded_len;
+        result.erase(suffix_pos, decoded_len);
+    }
+    result.insert(suffix_pos, ITBlockState::conditionSuffix(condition()));
+    return result;
 }
 
-void MCInst::setDetail(const cs_detail &inst_detail) noexcept {
-    m_detail = inst_detail;
+void MCInst::setITCondition(arm_cc condition) noexcept {
+    m_it_condition = static_cast<uint8_t>(condition);
+}
+
+void MCInst::clearITCondition() noexcept {
+    m_it_condition = ARM_CC_INVALID;
+}
+
+bool MCInst::hasITCondition() const noexcept {
+    return m_it_condition != ARM_CC_INVALID;
 }
 }
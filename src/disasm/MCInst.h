@@ -25,6 +25,7 @@ public:
     MCInst(const MCInst &src) = default;
     MCInst &operator=(const MCInst &src) = default;
     MCInst(MCInst &&src) = default;
+    MCInst &operator=(MCInst &&src) = default;
 
     unsigned id() const noexcept;
     size_t size() const noexcept;
@@ -38,9 +39,23 @@ public:
 
     const std::string &mnemonic() const noexcept;
     const std::string &operands() const noexcept;
+    /*
+     * returns the mnemonic patched with the condition imposed by IT block.
+     * Built on demand since it is needed only for printing.
+     */
+    std::string effectiveMnemonic() const;
 
-    void setMnemonic(const std::string &mnemonic) noexcept;
-    void setDetail(const cs_detail &inst_detail) noexcept;
+    /*
+     * overrides the condition decoded by Capstone with the one dictated
+     * by the IT block containing this instruction.
+     */
+    void setITCondition(arm_cc condition) noexcept;
+    /*
+     * drops the override of an instruction that was wrongly considered
+     * part of an IT block. Its own encoded condition applies again.
+     */
+    void clearITCondition() noexcept;
+    bool hasITCondition() const noexcept;
 
 private:
     unsigned int m_id;
@@ -48,6 +63,8 @@ private:
     unsigned m_size;
     std::string m_mnemonic;
     std::string m_operands;
+    // ARM_CC_INVALID means that condition of m_detail is valid.
+    uint8_t m_it_condition;
     cs_detail m_detail;
 };
 }
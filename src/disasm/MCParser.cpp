@@ -8,6 +8,7 @@
 
 #include "MCParser.h"
 #include "RawInstWrapper.h"
+#include "Stats.h"
 #include <cassert>
 
 namespace disasm {
@@ -56,6 +57,7 @@ bool MCParser::disasm(const uint8_t *code,
                       addr_t address,
                       cs_insn *inst) const noexcept {
     assert(address <= m_end_addr && "Address out of bound");
+    SPEDI_COUNT(kCapstoneCalls, 1);
     return cs_disasm_iter(m_handle, &code, &size, &address, inst);
 }
 
@@ -64,6 +66,7 @@ bool MCParser::disasm2(const uint8_t **code,
                        addr_t *address,
                        cs_insn *inst) const noexcept {
     assert(*address <= m_end_addr && "Address out of bound");
+    SPEDI_COUNT(kCapstoneCalls, 1);
     return cs_disasm_iter(m_handle, code, size, address, inst);
 }
 }
@@ -0,0 +1,75 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "MappingSymbolIndex.h"
+#include "Stats.h"
+#include <binutils/elf/elf++.hh>
+#include <algorithm>
+
+namespace disasm {
+
+MappingSymbolIndex::MappingSymbolIndex(const elf::elf &elf_file) {
+    SPEDI_PHASE(kSymbolScan);
+    for (auto &sec : elf_file.sections()) {
+        m_sec_hdrs.push_back(&sec.get_hdr());
+    }
+    m_symbols.resize(m_sec_hdrs.size());
+    const elf::section &sym_sec = elf_file.get_section(".symtab");
+    if (!sym_sec.valid()) {
+        return;
+    }
+    // The following can throw a type_mismatch exception in case
+    // of corrupted symbol table in ELF.
+    for (auto symbol : sym_sec.as_symtab()) {
+        auto type = typeOf(symbol.get_name(nullptr));
+        if (type == 0) {
+            continue;
+        }
+        auto sec_idx = static_cast<unsigned>(symbol.get_data().shnxd);
+        if (sec_idx >= m_symbols.size()) {
+            // special section index, e.g., SHN_ABS
+            continue;
+        }
+        m_symbols[sec_idx].emplace_back
+            (std::make_pair(symbol.get_data().value,
+                            static_cast<ARMCodeSymbolType>(type)));
+    }
+    // Symbols are not necessary sorted, this step is required to
+    // avoid potential SEGEV.
+    for (auto &symbols : m_symbols) {
+        std::sort(symbols.begin(), symbols.end());
+    }
+}
+
+const MappingSymbolIndex::MappingSymbolVec &
+MappingSymbolIndex::symbolsOf(const elf::section &sec) const noexcept {
+    static const MappingSymbolVec kEmpty;
+    auto hdr_iter =
+        std::find(m_sec_hdrs.cbegin(), m_sec_hdrs.cend(), &sec.get_hdr());
+    if (hdr_iter == m_sec_hdrs.cend()) {
+        return kEmpty;
+    }
+    return m_symbols[hdr_iter - m_sec_hdrs.cbegin()];
+}
+
+unsigned short MappingSymbolIndex::typeOf(const char *name) noexcept {
+    if (name[0] != '$' || name[1] == '\0' || name[2] != '\0') {
+        return 0;
+    }
+    switch (name[1]) {
+        case 't':
+            return static_cast<unsigned short>(ARMCodeSymbolType::kThumb);
+        case 'a':
+            return static_cast<unsigned short>(ARMCodeSymbolType::kARM);
+        case 'd':
+            return static_cast<unsigned short>(ARMCodeSymbolType::kData);
+        default:
+            return 0;
+    }
+}
+}
@@ -0,0 +1,64 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include "common.h"
+#include <vector>
+#include <utility>
+
+namespace elf {
+class elf;
+class section;
+}
+
+namespace disasm {
+
+/**
+ * MappingSymbolIndex
+ * ARM mapping symbols ($a, $t, and $d) of an ELF file bucketed by section
+ * and sorted by address. Built once by a single pass over symbol table.
+ */
+class MappingSymbolIndex {
+public:
+    using MappingSymbolVec = std::vector<std::pair<size_t, ARMCodeSymbolType>>;
+
+    /**
+     * Construct an empty index.
+     */
+    MappingSymbolIndex() = default;
+    /**
+     * Indexes mapping symbols of given file. An empty index is built
+     * if no symbol table was found.
+     */
+    explicit MappingSymbolIndex(const elf::elf &elf_file);
+    virtual ~MappingSymbolIndex() = default;
+    MappingSymbolIndex(const MappingSymbolIndex &src) = default;
+    MappingSymbolIndex &operator=(const MappingSymbolIndex &src) = default;
+    MappingSymbolIndex(MappingSymbolIndex &&src) = default;
+    MappingSymbolIndex &operator=(MappingSymbolIndex &&src) = default;
+
+    /*
+     * returns mapping symbols of given section sorted by address.
+     * precondition: sec belongs to the indexed file.
+     */
+    const MappingSymbolVec &symbolsOf(const elf::section &sec) const noexcept;
+
+    /*
+     * returns the type of a mapping symbol name or 0 if name is not
+     * a mapping symbol. No memory is allocated.
+     */
+    static unsigned short typeOf(const char *name) noexcept;
+
+private:
+    // section headers of the file, used to find the index of a section
+    std::vector<const void *> m_sec_hdrs;
+    // mapping symbols indexed by section index
+    std::vector<MappingSymbolVec> m_symbols;
+};
+}
@@ -25,6 +25,7 @@ public:
     MaximalBlock(const MaximalBlock &src) = default;
     MaximalBlock &operator=(const MaximalBlock &src) = default;
     MaximalBlock(MaximalBlock &&src) = default;
+    MaximalBlock &operator=(MaximalBlock &&src) = default;
     bool operator==(const MaximalBlock& src) const noexcept;
 
     /**
@@ -77,6 +78,7 @@ public:
     bool isAppendableBy(const MaximalBlock &block) const noexcept;
 
     friend class MaximalBlockBuilder;
+    friend class SectionDisassemblyARM;
 private:
     explicit MaximalBlock(size_t id, const BranchData &branch);
 private:
@@ -7,10 +7,13 @@
 // Copyright (c) 2015-2016 University of Kaiserslautern.
 
 #include "MaximalBlockBuilder.h"
+#include "Stats.h"
 #include <algorithm>
 #include <cassert>
 #include <array>
 #include <cstring>
+#include <iterator>
+#include <string>
 
 namespace disasm {
 
@@ -18,7 +21,8 @@ MaximalBlockBuilder::MaximalBlockBuilder() :
     m_buildable{false},
     m_bb_idx{0},
     m_max_block_idx{0},
-    m_end_addr{0} {
+    m_end_addr{0},
+    m_last_build_stats{} {
 }
 
 std::vector<unsigned int>
@@ -26,213 +30,317 @@ MaximalBlockBuilder::appendableBasicBlocksAt(const addr_t addr) const {
     // XXX: an instruction can be appendable to multiple basic blocks
     // that share the same last fragment.
     std::vector<unsigned int> result;
-    for (auto &bblock : m_bblocks) {
-        if (bblock.isAppendableAt(addr))
-            result.push_back(bblock.id());
+    auto end_idx = findBasicBlocksEndingAt(addr);
+    if (end_idx != kNotFound) {
+        m_bblock_ends[end_idx].m_bblocks.forEach([&](unsigned position) {
+            result.push_back(m_bblocks[position].id());
+        });
     }
     return result;
 }
 
 void
-MaximalBlockBuilder::createBasicBlockWith(const cs_insn *inst) {
+MaximalBlockBuilder::createBasicBlockWith
+    (const cs_insn *inst, arm_cc it_condition) {
+    BasicBlockSet bblocks;
+    bblocks.insert(m_bblocks.size());
     m_bblocks.emplace_back(BasicBlock(m_bb_idx, inst));
-    m_insts.emplace_back(MCInst(inst));
+    appendInstruction(inst, it_condition, bblocks);
+    addBasicBlocksEndingAt(inst->address + inst->size, bblocks);
     m_end_addr = inst->address + inst->size;
     m_bb_idx++;
 }
 
 void
-MaximalBlockBuilder::createValidBasicBlockWith(const cs_insn *inst) {
-    createBasicBlockWith(inst);
+MaximalBlockBuilder::createValidBasicBlockWith
+    (const cs_insn *inst, arm_cc it_condition) {
+    createBasicBlockWith(inst, it_condition);
     m_bblocks.back().m_valid = true;
-    setBranch(inst);
+    setBranch(inst, it_condition);
+}
+
+void MaximalBlockBuilder::appendInstruction
+    (const cs_insn *inst, arm_cc it_condition, const BasicBlockSet &bblocks) {
+    m_insts.emplace_back(MCInst(inst));
+    if (it_condition != ARM_CC_INVALID) {
+        m_insts.back().setITCondition(it_condition);
+    }
+    m_inst_bblocks.push_back(bblocks);
+}
+
+size_t MaximalBlockBuilder::findBasicBlocksEndingAt
+    (addr_t end_addr) const noexcept {
+    // only a handful of distinct end addresses exist at a time.
+    for (size_t i = 0; i < m_bblock_ends.size(); ++i) {
+        if (m_bblock_ends[i].m_end_addr == end_addr) {
+            return i;
+        }
+    }
+    return kNotFound;
+}
+
+void MaximalBlockBuilder::addBasicBlocksEndingAt
+    (addr_t end_addr, const BasicBlockSet &bblocks) {
+    auto end_idx = findBasicBlocksEndingAt(end_addr);
+    if (end_idx != kNotFound) {
+        m_bblock_ends[end_idx].m_bblocks |= bblocks;
+    } else {
+        m_bblock_ends.push_back(BasicBlockEnd{end_addr, bblocks});
+    }
+}
+
+BasicBlockSet MaximalBlockBuilder::takeBasicBlocksEndingAt(addr_t end_addr) {
+    BasicBlockSet result;
+    auto end_idx = findBasicBlocksEndingAt(end_addr);
+    if (end_idx != kNotFound) {
+        result = std::move(m_bblock_ends[end_idx].m_bblocks);
+        m_bblock_ends[end_idx] = std::move(m_bblock_ends.back());
+        m_bblock_ends.pop_back();
+    }
+    return result;
+}
+
+void MaximalBlockBuilder::reset() noexcept {
+    m_bblocks.clear();
+    m_insts.clear();
+    m_inst_bblocks.clear();
+    m_bblock_ends.clear();
+    m_bb_idx = 0;
+    m_end_addr = 0;
+}
+
+void MaximalBlockBuilder::addInstCopy(const MCInst &inst) noexcept {
+    // strings longer than the inline buffer of an empty one are allocated
+    static const size_t kInlineCapacity = std::string().capacity();
+    m_last_build_stats.m_bytes_copied += sizeof(MCInst);
+    for (auto str : {&inst.mnemonic(), &inst.operands()}) {
+        if (str->size() > kInlineCapacity) {
+            m_last_build_stats.m_allocation_count++;
+            m_last_build_stats.m_bytes_copied += str->size() + 1;
+        }
+    }
+}
+
+template <typename T>
+void MaximalBlockBuilder::addVectorGrowth
+    (const std::vector<T> &vec, size_t capacity) noexcept {
+    if (vec.capacity() != capacity) {
+        m_last_build_stats.m_allocation_count++;
+    }
+}
+
+void MaximalBlockBuilder::countBuildStats() const noexcept {
+    SPEDI_COUNT(kBuildAllocations, m_last_build_stats.m_allocation_count);
+    SPEDI_COUNT(kBuildBytesMoved, m_last_build_stats.m_bytes_moved);
+    SPEDI_COUNT(kBuildBytesCopied, m_last_build_stats.m_bytes_copied);
 }
 
 MaximalBlock MaximalBlockBuilder::buildResultDirectlyAndReset() {
     MaximalBlock result{m_max_block_idx, m_branch};
-    // one BB & buildable then put in the result
-    result.m_bblocks.swap(m_bblocks);
-    result.m_insts.swap(m_insts);
+    // one BB & buildable then put in the result. Elements are moved so
+    // that the builder keeps its capacity.
+    result.m_bblocks.assign(std::make_move_iterator(m_bblocks.begin()),
+                            std::make_move_iterator(m_bblocks.end()));
+    result.m_insts.assign(std::make_move_iterator(m_insts.begin()),
+                          std::make_move_iterator(m_insts.end()));
+    addVectorGrowth(result.m_bblocks, 0);
+    addVectorGrowth(result.m_insts, 0);
+    m_last_build_stats.m_bytes_moved += result.m_bblocks.size()
+        * sizeof(BasicBlock) + result.m_insts.size() * sizeof(MCInst);
     result.m_end_addr = result.m_insts.back().addr()
         + result.m_insts.back().size();
-    m_bb_idx = 0;
-    m_end_addr = 0;
+    reset();
     m_buildable = false;
     m_max_block_idx++;
     return result;
 }
 
-MaximalBlock MaximalBlockBuilder::buildResultFromValidBasicBlocks
-    (const std::vector<BasicBlock *> &valid_blocks) {
-    MaximalBlock result{m_max_block_idx, m_branch};
-    for (auto block : valid_blocks) {
-        result.m_bblocks.push_back(*block);
+void MaximalBlockBuilder::classifyInstructions
+    (const BasicBlockSet &valid_bblocks, const BasicBlockSet &overlap_bblocks) {
+    m_inst_kinds.resize(m_insts.size());
+    for (unsigned i = 0; i < m_insts.size(); ++i) {
+        m_inst_kinds[i] = kDiscarded;
+        if (m_inst_bblocks[i].intersects(valid_bblocks)) {
+            m_inst_kinds[i] |= kValid;
+        }
+        if (m_inst_bblocks[i].intersects(overlap_bblocks)) {
+            m_inst_kinds[i] |= kOverlap;
+        }
     }
-    // move only valid instructions to result
-    for (auto inst_iter = m_insts.cbegin();
-         inst_iter < m_insts.cend(); ++inst_iter) {
-        bool inst_valid = false;
-        for (auto valid_block_iter = valid_blocks.cbegin();
-             valid_block_iter < valid_blocks.cend() && !inst_valid;
-             ++valid_block_iter) {
-            for (auto addr :
-                (*valid_block_iter)->getInstructionAddresses()) {
-                if ((*inst_iter).addr() == addr) {
-                    result.m_insts.push_back(*inst_iter);
-                    inst_valid = true;
-                    break;
-                }
-            }
+}
+
+void MaximalBlockBuilder::moveValidBasicBlocksTo
+    (MaximalBlock &result, size_t valid_bblock_count) {
+    size_t valid_inst_count = 0;
+    for (auto kind : m_inst_kinds) {
+        if ((kind & kValid) != 0) {
+            valid_inst_count++;
         }
     }
+    auto bblocks_capacity = result.m_bblocks.capacity();
+    auto insts_capacity = result.m_insts.capacity();
+    result.m_bblocks.reserve(valid_bblock_count);
+    result.m_insts.reserve(valid_inst_count);
+    for (unsigned i = 0; i < m_bblocks.size(); ++i) {
+        if (m_bblock_kinds[i] == kValid) {
+            result.m_bblocks.push_back(std::move(m_bblocks[i]));
+            m_last_build_stats.m_bytes_moved += sizeof(BasicBlock);
+        }
+    }
+    for (unsigned i = 0; i < m_insts.size(); ++i) {
+        if (m_inst_kinds[i] == kValid) {
+            result.m_insts.push_back(std::move(m_insts[i]));
+            m_last_build_stats.m_bytes_moved += sizeof(MCInst);
+        } else if ((m_inst_kinds[i] & kValid) != 0) {
+            // shared with an overlap block which keeps the original.
+            result.m_insts.push_back(m_insts[i]);
+            addInstCopy(m_insts[i]);
+            SPEDI_COUNT(kSharedInstCopies, 1);
+        }
+    }
+    addVectorGrowth(result.m_bblocks, bblocks_capacity);
+    addVectorGrowth(result.m_insts, insts_capacity);
     result.m_end_addr = result.m_insts.back().addr()
         + result.m_insts.back().size();
-    return result;
+}
+
+void MaximalBlockBuilder::keepOverlapBasicBlocks() {
+    // compact in place to reuse capacity of builder. Positions of kept
+    // basic blocks change, hence, membership of instructions is remapped.
+    std::vector<unsigned> new_positions(m_bblocks.size(), 0);
+    size_t kept = 0;
+    for (unsigned i = 0; i < m_bblocks.size(); ++i) {
+        if (m_bblock_kinds[i] == kOverlap) {
+            if (kept != i) {
+                m_bblocks[kept] = std::move(m_bblocks[i]);
+            }
+            new_positions[i] = kept;
+            kept++;
+        }
+    }
+    m_bblocks.erase(m_bblocks.begin() + kept, m_bblocks.end());
+    kept = 0;
+    for (unsigned i = 0; i < m_insts.size(); ++i) {
+        if ((m_inst_kinds[i] & kOverlap) == 0) {
+            continue;
+        }
+        BasicBlockSet bblocks;
+        m_inst_bblocks[i].forEach([&](unsigned position) {
+            if (m_bblock_kinds[position] == kOverlap) {
+                bblocks.insert(new_positions[position]);
+            }
+        });
+        if (kept != i) {
+            m_insts[kept] = std::move(m_insts[i]);
+        }
+        m_inst_bblocks[kept] = std::move(bblocks);
+        kept++;
+    }
+    m_insts.erase(m_insts.begin() + kept, m_insts.end());
+    m_inst_bblocks.erase(m_inst_bblocks.begin() + kept, m_inst_bblocks.end());
+    m_bblock_ends.clear();
+    for (unsigned i = 0; i < m_bblocks.size(); ++i) {
+        BasicBlockSet bblocks;
+        bblocks.insert(i);
+        addBasicBlocksEndingAt(m_bblocks[i].endAddr(), bblocks);
+    }
 }
 
 MaximalBlock MaximalBlockBuilder::build() {
+    m_last_build_stats = BuildStats();
     if (!m_buildable) {
         //  return an invalid maximal block!
         m_max_block_idx++;
         return disasm::MaximalBlock();
     }
+    SPEDI_COUNT(kMaximalBlocks, 1);
     if (m_bblocks.size() == 1) {
-        return buildResultDirectlyAndReset();
+        auto result = buildResultDirectlyAndReset();
+        countBuildStats();
+        return result;
     }
     // classify BBs to valid and overlap the rest (if found) should be discarded
-    std::vector<BasicBlock *> valid_blocks;
-    std::vector<BasicBlock *> overlap_blocks;
-
-    for (auto bblock_iter = m_bblocks.begin();
-         bblock_iter < m_bblocks.end(); ++bblock_iter) {
-        if ((*bblock_iter).isValid()) {
-            valid_blocks.push_back(&(*bblock_iter));
-        } else {
+    size_t valid_bblock_count = 0;
+    size_t overlap_bblock_count = 0;
+    BasicBlockSet valid_bblocks;
+    BasicBlockSet overlap_bblocks;
+    m_bblock_kinds.assign(m_bblocks.size(), kDiscarded);
+    for (unsigned i = 0; i < m_bblocks.size(); ++i) {
+        if (m_bblocks[i].isValid()) {
+            m_bblock_kinds[i] = kValid;
+            valid_bblocks.insert(i);
+            valid_bblock_count++;
+        } else if (m_end_addr - m_bblocks[i].endAddr() <= 2) {
             // we keep only potential overlapping BBs
-            if (m_end_addr - (*bblock_iter).endAddr() <= 2) {
-                overlap_blocks.push_back(&(*bblock_iter));
-            }
+            m_bblock_kinds[i] = kOverlap;
+            overlap_bblocks.insert(i);
+            overlap_bblock_count++;
         }
     }
-    // Case of no overlap
-    if (overlap_blocks.size() == 0) {
-        if (valid_blocks.size() == m_bblocks.size()) {
-            // all basic blocks are valid and should be moved to result
-            return buildResultDirectlyAndReset();
-        } else {
-            MaximalBlock result = buildResultFromValidBasicBlocks(valid_blocks);
-            // move only valid BB to result
-            m_bblocks.clear();
-            m_insts.clear();
-            m_bb_idx = 0;
-            m_end_addr = 0;
-            m_buildable = false;
-            m_max_block_idx++;
-            return result;
-        }
-    }
-    // Case of BB overlap then MB should maintain overlap BBs and their instructions.
-    MaximalBlock result = buildResultFromValidBasicBlocks(valid_blocks);
-
-    if (overlap_blocks.size() + result.m_bblocks.size() == m_bblocks.size()
-        && result.m_insts.size() == 1) {
-        // optimization for the case of spurious branch instructions.
-        m_insts.pop_back();
-        m_bblocks.pop_back();
-        m_bb_idx = overlap_blocks.size();
-        m_end_addr = m_insts.back().addr() + m_insts.back().size();
-        m_buildable = false;
-        m_max_block_idx++;
+    if (overlap_bblock_count == 0
+        && valid_bblock_count == m_bblocks.size()) {
+        // all basic blocks are valid and should be moved to result
+        auto result = buildResultDirectlyAndReset();
+        countBuildStats();
         return result;
     }
-
-    std::vector<MCInst> insts_buffer;
-    std::vector<BasicBlock> bb_buffer;
-    // TODO: if valid block contain only one inst then optimize for that case
-    // copy all overlap blocks
-    for (auto block_iter = overlap_blocks.cbegin();
-         block_iter < overlap_blocks.cend(); ++block_iter) {
-        bb_buffer.push_back(*(*block_iter));
-    }
-    // move only overlap instructions to inst buffer
-    for (auto inst_iter = m_insts.cbegin();
-         inst_iter < m_insts.cend(); ++inst_iter) {
-        bool is_overlap_inst = false;
-        for (auto overlap_block_iter = overlap_blocks.cbegin();
-             overlap_block_iter < overlap_blocks.cend() && !is_overlap_inst;
-             ++overlap_block_iter) {
-            for (auto addr :
-                (*overlap_block_iter)->getInstructionAddresses()) {
-                if ((*inst_iter).addr() == addr) {
-                    insts_buffer.push_back(*inst_iter);
-                    is_overlap_inst = true;
-                    break;
-                }
-            }
-        }
-    }
-    // keep overlap instructions and blocks
-    m_insts.swap(insts_buffer);
-    m_bblocks.swap(bb_buffer);
-    m_end_addr = m_insts.back().addr() + m_insts.back().size();
+    MaximalBlock result{m_max_block_idx, m_branch};
+    classifyInstructions(valid_bblocks, overlap_bblocks);
+    moveValidBasicBlocksTo(result, valid_bblock_count);
     assert(result.m_bblocks.size() > 0
                && "No Basic Blocks in Maximal Block!!");
     assert(result.m_insts.size() > 0
                && "No Instructions in Maximal Block!!");
-    m_bb_idx = overlap_blocks.size();
+    if (overlap_bblock_count == 0) {
+        reset();
+    } else {
+        // Case of BB overlap then MB should maintain overlap BBs and
+        // their instructions.
+        keepOverlapBasicBlocks();
+        m_end_addr = m_insts.back().addr() + m_insts.back().size();
+    }
+    m_bb_idx = overlap_bblock_count;
     m_buildable = false;
     m_max_block_idx++;
+    countBuildStats();
     return result;
 }
 
-void MaximalBlockBuilder::append(const cs_insn *inst) {
-    if (m_bblocks.size() == 0) {
-        createBasicBlockWith(inst);
+void MaximalBlockBuilder::append(const cs_insn *inst, arm_cc it_condition) {
+    auto bblocks = takeBasicBlocksEndingAt(inst->address);
+    if (bblocks.empty()) {
+        createBasicBlockWith(inst, it_condition);
         return;
     }
-    // get all appendable BBs
-    bool appendable = false;
-    for (auto &bblock : m_bblocks) {
-        if (bblock.isAppendableBy(inst)) {
-            bblock.append(inst);
-            appendable = true;
-        }
-    }
-    if (appendable) {
-        m_insts.emplace_back(MCInst(inst));
-    } else {
-        createBasicBlockWith(inst);
-    }
+    bblocks.forEach([&](unsigned position) {
+        m_bblocks[position].append(inst);
+    });
+    appendInstruction(inst, it_condition, bblocks);
+    addBasicBlocksEndingAt(inst->address + inst->size, bblocks);
 }
 
-void MaximalBlockBuilder::appendBranch(const cs_insn *inst) {
+void MaximalBlockBuilder::appendBranch
+    (const cs_insn *inst, arm_cc it_condition) {
     m_buildable = true;
 
-    if (m_bblocks.size() == 0) {
-        createValidBasicBlockWith(inst);
-        return;
-    }
-    bool found_appendable = false;
-    // get all appendable BBs
-    for (auto &bblock : m_bblocks) {
-        if (bblock.isAppendableBy(inst)) {
-            bblock.append(inst);
+    auto bblocks = takeBasicBlocksEndingAt(inst->address);
+    if (bblocks.empty()) {
+        createValidBasicBlockWith(inst, it_condition);
+    } else {
+        bblocks.forEach([&](unsigned position) {
+            m_bblocks[position].append(inst);
             // a BB that ends with a branch is valid
-            bblock.m_valid = true;
-            found_appendable = true;
-        }
-    }
-
-    if (found_appendable) {
-        m_insts.emplace_back(MCInst(inst));
+            m_bblocks[position].m_valid = true;
+        });
+        appendInstruction(inst, it_condition, bblocks);
+        addBasicBlocksEndingAt(inst->address + inst->size, bblocks);
         m_end_addr = inst->address + inst->size;
-    } else {
-        createValidBasicBlockWith(inst);
     }
-    setBranch(inst);
+    setBranch(inst, it_condition);
 }
 
-void MaximalBlockBuilder::setBranch(const cs_insn *inst) {
+void MaximalBlockBuilder::setBranch
+    (const cs_insn *inst, arm_cc it_condition) {
     cs_detail *detail = inst->detail;
     if (inst->id == ARM_INS_CBZ || inst->id == ARM_INS_CBNZ) {
         m_branch.m_conditional_branch = true;
@@ -246,7 +354,11 @@ void MaximalBlockBuilder::setBranch(const cs_insn *inst) {
     } else {
         m_branch.m_is_call = false;
     }
-    m_branch.m_conditional_branch = (inst->detail->arm.cc != ARM_CC_AL);
+    if (it_condition != ARM_CC_INVALID) {
+        m_branch.m_conditional_branch = (it_condition != ARM_CC_AL);
+    } else {
+        m_branch.m_conditional_branch = (inst->detail->arm.cc != ARM_CC_AL);
+    }
     if (inst->detail->arm.op_count == 1
         && inst->detail->arm.operands[0].type == ARM_OP_IMM) {
         m_branch.m_direct_branch = true;
@@ -260,6 +372,11 @@ bool MaximalBlockBuilder::isCleanReset() {
     return !m_buildable && m_bblocks.size() == 0;
 }
 
+const MaximalBlockBuilder::BuildStats &
+MaximalBlockBuilder::lastBuildStats() const noexcept {
+    return m_last_build_stats;
+}
+
 const std::vector<addr_t>
 MaximalBlockBuilder::getInstructionAddrsOf(const BasicBlock &bblock) const {
     return bblock.m_inst_addrs;
@@ -11,6 +11,7 @@
 #include "MCInst.h"
 #include "MaximalBlock.h"
 #include "BranchData.h"
+#include "BasicBlockSet.h"
 #include <vector>
 
 namespace disasm {
@@ -43,32 +44,55 @@ public:
      * when the given instruction is not appendable.
      */
     void createBasicBlockWith
-        (const cs_insn *inst);
+        (const cs_insn *inst, arm_cc it_condition = ARM_CC_INVALID);
 
     /*
      * Add a new valid block with a single instruction.
      * precondition: inst is a branch instruction.
      */
     void createValidBasicBlockWith
-        (const cs_insn *inst);
+        (const cs_insn *inst, arm_cc it_condition = ARM_CC_INVALID);
 
     /*
      * Look up appendable basic blocks first and then appendBranch instruction if possible.
-     * Otherwise, create a new basic block.
+     * Otherwise, create a new basic block. A valid it_condition overrides
+     * the condition decoded by Capstone.
      */
-    void append(const cs_insn *inst);
+    void append(const cs_insn *inst, arm_cc it_condition = ARM_CC_INVALID);
 
     /*
      * Look up appendable basic blocks first and then appendBranch branch instruction
      * if possible. Otherwise, create a new basic block.
      */
-    void appendBranch(const cs_insn *inst);
+    void appendBranch
+        (const cs_insn *inst, arm_cc it_condition = ARM_CC_INVALID);
 
     /**
+     * Instructions and basic blocks are moved to the result, which is
+     * allocated to fit. An instruction is copied only if it is shared
+     * between a valid and an overlap basic block. The builder keeps the
+     * capacity of its vectors for the next block.
      * precondition: maximal block is buildable.
      */
     MaximalBlock build();
 
+    /*
+     * Cost of the last call to build() as measured while building. Heap
+     * allocations are those of the vectors of the result and of strings
+     * of copied instructions.
+     */
+    struct BuildStats {
+        unsigned m_allocation_count;
+        size_t m_bytes_moved;
+        size_t m_bytes_copied;
+    };
+    const BuildStats &lastBuildStats() const noexcept;
+
+    /*
+     * Discards basic blocks that are not built yet.
+     */
+    void reset() noexcept;
+
     /*
      * Return true on clean (no overlap) reset, false otherwise.
      */
@@ -78,11 +102,40 @@ public:
         getInstructionAddrsOf(const BasicBlock &bblock) const;
 
 private:
-    void setBranch(const cs_insn* inst);
+    void setBranch(const cs_insn* inst, arm_cc it_condition);
+    void appendInstruction
+        (const cs_insn *inst,
+         arm_cc it_condition,
+         const BasicBlockSet &bblocks);
+    size_t findBasicBlocksEndingAt(addr_t end_addr) const noexcept;
+    void addBasicBlocksEndingAt(addr_t end_addr, const BasicBlockSet &bblocks);
+    /*
+     * removes and returns basic blocks ending at given address.
+     */
+    BasicBlockSet takeBasicBlocksEndingAt(addr_t end_addr);
     MaximalBlock buildResultDirectlyAndReset();
-    MaximalBlock buildResultFromValidBasicBlocks
-        (const std::vector<BasicBlock *> &valid_blocks);
+    void classifyInstructions
+        (const BasicBlockSet &valid_bblocks,
+         const BasicBlockSet &overlap_bblocks);
+    void moveValidBasicBlocksTo
+        (MaximalBlock &result, size_t valid_bblock_count);
+    void keepOverlapBasicBlocks();
+    void addInstCopy(const MCInst &inst) noexcept;
+    template <typename T>
+    void addVectorGrowth(const std::vector<T> &vec, size_t capacity) noexcept;
+    void countBuildStats() const noexcept;
 private:
+    // kind of basic blocks and instructions during build.
+    enum BuildKind : uint8_t {
+        kDiscarded = 0,
+        kValid = 1,
+        kOverlap = 2
+    };
+    struct BasicBlockEnd {
+        addr_t m_end_addr;
+        BasicBlockSet m_bblocks;
+    };
+    static constexpr size_t kNotFound = static_cast<size_t>(-1);
     bool m_buildable;
     size_t m_bb_idx;
     size_t m_max_block_idx;
@@ -90,5 +143,13 @@ private:
     BranchData m_branch;
     std::vector<BasicBlock> m_bblocks;
     std::vector<MCInst> m_insts;
+    // basic blocks containing each instruction in m_insts.
+    std::vector<BasicBlockSet> m_inst_bblocks;
+    // basic blocks grouped by their end address, i.e., the address of
+    // the next instruction appendable to them.
+    std::vector<BasicBlockEnd> m_bblock_ends;
+    std::vector<uint8_t> m_bblock_kinds;
+    std::vector<uint8_t> m_inst_kinds;
+    BuildStats m_last_build_stats;
 };
 }
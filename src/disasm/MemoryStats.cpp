@@ -0,0 +1,234 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "MemoryStats.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+namespace disasm {
+
+static const char *kOwnerNames[] = {
+    "other",
+    "section_disassembly",
+    "cfg",
+    "call_graph",
+    "plt_map"
+};
+
+static_assert(sizeof(kOwnerNames) / sizeof(kOwnerNames[0])
+                  == MemoryStats::kOwnerCount, "owner names out of sync");
+
+namespace {
+
+/*
+ * Owners are charged from every thread, plain atomics are good enough
+ * for an instrumentation build.
+ */
+struct OwnerCounters {
+    std::atomic<uint64_t> m_live_bytes;
+    std::atomic<uint64_t> m_live_allocations;
+    std::atomic<uint64_t> m_allocations;
+    std::atomic<uint64_t> m_peak_bytes;
+};
+
+// zero initialized before any dynamic initialization may allocate
+OwnerCounters g_owners[MemoryStats::kOwnerCount];
+
+thread_local MemoryOwner t_owner = MemoryOwner::kOther;
+
+#ifdef SPEDI_MEMORY_STATS
+/*
+ * Precedes every block, keeps the block max aligned.
+ */
+struct alignas(std::max_align_t) BlockHeader {
+    size_t m_size;
+    MemoryOwner m_owner;
+};
+
+void *allocate(size_t size) noexcept {
+    auto header = static_cast<BlockHeader *>
+        (std::malloc(sizeof(BlockHeader) + size));
+    if (header == nullptr) {
+        return nullptr;
+    }
+    header->m_size = size;
+    header->m_owner = t_owner;
+    auto &owner = g_owners[static_cast<unsigned>(header->m_owner)];
+    auto live = owner.m_live_bytes.fetch_add
+        (size, std::memory_order_relaxed) + size;
+    owner.m_live_allocations.fetch_add(1, std::memory_order_relaxed);
+    owner.m_allocations.fetch_add(1, std::memory_order_relaxed);
+    auto peak = owner.m_peak_bytes.load(std::memory_order_relaxed);
+    while (peak < live
+        && !owner.m_peak_bytes.compare_exchange_weak
+            (peak, live, std::memory_order_relaxed)) {
+    }
+    return header + 1;
+}
+
+void deallocate(void *ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    auto header = static_cast<BlockHeader *>(ptr) - 1;
+    auto &owner = g_owners[static_cast<unsigned>(header->m_owner)];
+    owner.m_live_bytes.fetch_sub(header->m_size, std::memory_order_relaxed);
+    owner.m_live_allocations.fetch_sub(1, std::memory_order_relaxed);
+    std::free(header);
+}
+
+void *allocateOrThrow(size_t size) {
+    while (true) {
+        auto ptr = allocate(size);
+        if (ptr != nullptr) {
+            return ptr;
+        }
+        auto handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+#endif
+}
+
+MemoryStats::MemoryStats() {
+    std::fill(m_live_bytes, m_live_bytes + kOwnerCount, 0);
+    std::fill(m_live_allocations, m_live_allocations + kOwnerCount, 0);
+    std::fill(m_allocations, m_allocations + kOwnerCount, 0);
+    std::fill(m_peak_bytes, m_peak_bytes + kOwnerCount, 0);
+}
+
+bool MemoryStats::isAvailable() noexcept {
+#ifdef SPEDI_MEMORY_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+MemoryStats MemoryStats::collect() noexcept {
+    MemoryStats result;
+    for (unsigned i = 0; i < kOwnerCount; ++i) {
+        auto &owner = g_owners[i];
+        result.m_live_bytes[i] =
+            owner.m_live_bytes.load(std::memory_order_relaxed);
+        result.m_live_allocations[i] =
+            owner.m_live_allocations.load(std::memory_order_relaxed);
+        result.m_allocations[i] =
+            owner.m_allocations.load(std::memory_order_relaxed);
+        result.m_peak_bytes[i] =
+            owner.m_peak_bytes.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+MemoryOwner MemoryStats::swapOwner(MemoryOwner owner) noexcept {
+    auto previous = t_owner;
+    t_owner = owner;
+    return previous;
+}
+
+const char *MemoryStats::nameOf(MemoryOwner owner) noexcept {
+    return kOwnerNames[static_cast<unsigned>(owner)];
+}
+
+uint64_t MemoryStats::liveBytes(MemoryOwner owner) const noexcept {
+    return m_live_bytes[static_cast<unsigned>(owner)];
+}
+
+uint64_t MemoryStats::liveAllocations(MemoryOwner owner) const noexcept {
+    return m_live_allocations[static_cast<unsigned>(owner)];
+}
+
+uint64_t MemoryStats::allocations(MemoryOwner owner) const noexcept {
+    return m_allocations[static_cast<unsigned>(owner)];
+}
+
+uint64_t MemoryStats::peakBytes(MemoryOwner owner) const noexcept {
+    return m_peak_bytes[static_cast<unsigned>(owner)];
+}
+
+void MemoryStats::print(std::ostream &out) const {
+    auto flags = out.flags();
+    out << std::left << std::setw(24) << "memory owner"
+        << std::right << std::setw(14) << "live KB"
+        << std::setw(14) << "live allocs"
+        << std::setw(14) << "allocs"
+        << std::setw(14) << "peak KB" << "\n";
+    out << std::fixed << std::setprecision(1);
+    for (unsigned i = 0; i < kOwnerCount; ++i) {
+        out << std::left << std::setw(24) << kOwnerNames[i]
+            << std::right << std::setw(14) << m_live_bytes[i] / 1024.0
+            << std::setw(14) << m_live_allocations[i]
+            << std::setw(14) << m_allocations[i]
+            << std::setw(14) << m_peak_bytes[i] / 1024.0 << "\n";
+    }
+    out.flags(flags);
+}
+
+void MemoryStats::writeJson(std::ostream &out) const {
+    out << "{\n";
+    for (unsigned i = 0; i < kOwnerCount; ++i) {
+        out << "    \"" << kOwnerNames[i] << "\": {"
+            << "\"live_bytes\": " << m_live_bytes[i]
+            << ", \"live_allocations\": " << m_live_allocations[i]
+            << ", \"allocations\": " << m_allocations[i]
+            << ", \"peak_bytes\": " << m_peak_bytes[i] << "}"
+            << (i + 1 < kOwnerCount ? "," : "") << "\n";
+    }
+    out << "  }";
+}
+}
+
+#ifdef SPEDI_MEMORY_STATS
+void *operator new(size_t size) {
+    return disasm::allocateOrThrow(size);
+}
+
+void *operator new[](size_t size) {
+    return disasm::allocateOrThrow(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return disasm::allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return disasm::allocate(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    disasm::deallocate(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    disasm::deallocate(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    disasm::deallocate(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    disasm::deallocate(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+    disasm::deallocate(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+    disasm::deallocate(ptr);
+}
+#endif
@@ -0,0 +1,103 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+namespace disasm {
+
+enum class MemoryOwner : unsigned {
+    kOther,
+    kSectionDisassembly,
+    kCFG,
+    kCallGraph,
+    kPLTMap,
+    kCount
+};
+
+/**
+ * MemoryStats
+ * Heap usage per owner. With SPEDI_MEMORY_STATS defined, global operator
+ * new and delete are replaced to charge every allocation to the owner
+ * set on the allocating thread. Frees are charged back to the same owner
+ * wherever they happen.
+ *
+ * An instance is a snapshot returned by collect.
+ */
+class MemoryStats {
+public:
+    static constexpr unsigned kOwnerCount =
+        static_cast<unsigned>(MemoryOwner::kCount);
+
+    MemoryStats();
+    virtual ~MemoryStats() = default;
+    MemoryStats(const MemoryStats &src) = default;
+    MemoryStats &operator=(const MemoryStats &src) = default;
+    MemoryStats(MemoryStats &&src) = default;
+
+    /*
+     * returns true if operator new is instrumented in this build.
+     */
+    static bool isAvailable() noexcept;
+    static MemoryStats collect() noexcept;
+    /*
+     * sets owner of the calling thread and returns the previous one.
+     */
+    static MemoryOwner swapOwner(MemoryOwner owner) noexcept;
+    static const char *nameOf(MemoryOwner owner) noexcept;
+
+    uint64_t liveBytes(MemoryOwner owner) const noexcept;
+    uint64_t liveAllocations(MemoryOwner owner) const noexcept;
+    uint64_t allocations(MemoryOwner owner) const noexcept;
+    uint64_t peakBytes(MemoryOwner owner) const noexcept;
+
+    void print(std::ostream &out) const;
+    /*
+     * writes a JSON object without trailing new line.
+     */
+    void writeJson(std::ostream &out) const;
+
+private:
+    uint64_t m_live_bytes[kOwnerCount];
+    uint64_t m_live_allocations[kOwnerCount];
+    uint64_t m_allocations[kOwnerCount];
+    uint64_t m_peak_bytes[kOwnerCount];
+};
+
+/**
+ * ScopedMemoryOwner
+ * Charges allocations of the current thread in its scope to an owner.
+ */
+class ScopedMemoryOwner {
+public:
+    explicit ScopedMemoryOwner(MemoryOwner owner) noexcept :
+        m_previous{MemoryStats::swapOwner(owner)} { }
+
+    ~ScopedMemoryOwner() {
+        MemoryStats::swapOwner(m_previous);
+    }
+
+    ScopedMemoryOwner(const ScopedMemoryOwner &src) = delete;
+    ScopedMemoryOwner &operator=(const ScopedMemoryOwner &src) = delete;
+
+private:
+    MemoryOwner m_previous;
+};
+}
+
+#ifdef SPEDI_MEMORY_STATS
+#define SPEDI_MEMORY_CONCAT_(a, b) a##b
+#define SPEDI_MEMORY_CONCAT(a, b) SPEDI_MEMORY_CONCAT_(a, b)
+#define SPEDI_MEMORY_OWNER(owner) \
+    disasm::ScopedMemoryOwner SPEDI_MEMORY_CONCAT(spedi_owner_, __LINE__) \
+        {disasm::MemoryOwner::owner}
+#else
+#define SPEDI_MEMORY_OWNER(owner) ((void) 0)
+#endif
@@ -0,0 +1,118 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "PerfCounters.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace disasm {
+
+static const char *kEventNames[] = {
+    "cycles",
+    "instructions",
+    "cache_misses",
+    "branch_misses"
+};
+
+static_assert(sizeof(kEventNames) / sizeof(kEventNames[0])
+                  == PerfCounters::kEventCount, "event names out of sync");
+
+#ifdef __linux__
+namespace {
+
+const uint64_t kEventConfigs[] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+/*
+ * Counter group of a thread, the first event leads the group.
+ */
+class CounterGroup {
+public:
+    CounterGroup() : m_valid{true} {
+        std::fill(m_fds, m_fds + PerfCounters::kEventCount, -1);
+        for (unsigned i = 0; i < PerfCounters::kEventCount; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = kEventConfigs[i];
+            attr.read_format = PERF_FORMAT_GROUP
+                | PERF_FORMAT_TOTAL_TIME_ENABLED
+                | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.disabled = i == 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            m_fds[i] = static_cast<int>(
+                syscall(__NR_perf_event_open, &attr, 0, -1,
+                        i == 0 ? -1 : m_fds[0], 0));
+            if (m_fds[i] < 0) {
+                m_valid = false;
+                return;
+            }
+        }
+        ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    ~CounterGroup() {
+        for (auto fd : m_fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    bool read(uint64_t *values) noexcept {
+        if (!m_valid) {
+            return false;
+        }
+        // nr, time enabled, time running, and a value per event
+        uint64_t buffer[3 + PerfCounters::kEventCount];
+        if (::read(m_fds[0], buffer, sizeof(buffer))
+            != static_cast<ssize_t>(sizeof(buffer))) {
+            return false;
+        }
+        double scale = buffer[2] == 0 || buffer[2] >= buffer[1]
+                       ? 1.0 : static_cast<double>(buffer[1]) / buffer[2];
+        for (unsigned i = 0; i < PerfCounters::kEventCount; ++i) {
+            values[i] = static_cast<uint64_t>(buffer[3 + i] * scale);
+        }
+        return true;
+    }
+
+private:
+    bool m_valid;
+    int m_fds[PerfCounters::kEventCount];
+};
+}
+
+bool PerfCounters::read(uint64_t *values) noexcept {
+    static thread_local CounterGroup group;
+    return group.read(values);
+}
+#else
+bool PerfCounters::read(uint64_t *values) noexcept {
+    std::fill(values, values + kEventCount, 0);
+    return false;
+}
+#endif
+
+const char *PerfCounters::nameOf(PerfEvent event) noexcept {
+    return kEventNames[static_cast<unsigned>(event)];
+}
+}
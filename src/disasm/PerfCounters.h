@@ -0,0 +1,45 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include <cstdint>
+
+namespace disasm {
+
+enum class PerfEvent : unsigned {
+    kCycles,
+    kInstructions,
+    kCacheMisses,
+    kBranchMisses,
+    kCount
+};
+
+/**
+ * PerfCounters
+ * Hardware counters of the calling thread read through Linux perf
+ * events. Counters are opened as one group per thread on first read.
+ * Reading fails where perf events are unavailable, e.g., on other
+ * systems or if perf_event_paranoid forbids it.
+ */
+class PerfCounters {
+public:
+    static constexpr unsigned kEventCount =
+        static_cast<unsigned>(PerfEvent::kCount);
+
+    PerfCounters() = delete;
+
+    /*
+     * Reads current counter values of this thread into values, scaled
+     * if counters were multiplexed. Returns false if counters are not
+     * available.
+     */
+    static bool read(uint64_t *values) noexcept;
+    static const char *nameOf(PerfEvent event) noexcept;
+};
+}
@@ -0,0 +1,198 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "Progress.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace disasm {
+
+Progress::State Progress::s_state{};
+
+namespace {
+
+uint64_t nowNanos() noexcept {
+    return static_cast<uint64_t>
+        (std::chrono::duration_cast<std::chrono::nanoseconds>
+             (std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+const char *phaseName(StatsPhase phase) noexcept {
+    return phase == StatsPhase::kCount ? "none" : Stats::nameOf(phase);
+}
+}
+
+Progress::Sample Progress::sample() noexcept {
+    Sample result;
+    result.m_phase = static_cast<StatsPhase>
+        (s_state.m_phase.load(std::memory_order_relaxed));
+    result.m_phase_done =
+        s_state.m_phase_done.load(std::memory_order_relaxed);
+    result.m_phase_total =
+        s_state.m_phase_total.load(std::memory_order_relaxed);
+    result.m_phase_start_nanos =
+        s_state.m_phase_start_nanos.load(std::memory_order_relaxed);
+    result.m_bytes = s_state.m_bytes.load(std::memory_order_relaxed);
+    result.m_bytes_total =
+        s_state.m_bytes_total.load(std::memory_order_relaxed);
+    result.m_insts = s_state.m_insts.load(std::memory_order_relaxed);
+    return result;
+}
+
+void Progress::reset() noexcept {
+    s_state.m_phase.store(static_cast<unsigned>(StatsPhase::kCount),
+                          std::memory_order_relaxed);
+    s_state.m_phase_done.store(0, std::memory_order_relaxed);
+    s_state.m_phase_total.store(0, std::memory_order_relaxed);
+    s_state.m_phase_start_nanos.store(nowNanos(), std::memory_order_relaxed);
+    s_state.m_bytes.store(0, std::memory_order_relaxed);
+    s_state.m_bytes_total.store(0, std::memory_order_relaxed);
+    s_state.m_insts.store(0, std::memory_order_relaxed);
+}
+
+ScopedProgressPhase::ScopedProgressPhase
+    (StatsPhase phase, uint64_t total) noexcept :
+    m_active{Progress::isEnabled()} {
+    if (!m_active) {
+        return;
+    }
+    auto &state = Progress::s_state;
+    m_enclosing = Progress::sample();
+    state.m_phase.store(static_cast<unsigned>(phase),
+                        std::memory_order_relaxed);
+    state.m_phase_done.store(0, std::memory_order_relaxed);
+    state.m_phase_total.store(total, std::memory_order_relaxed);
+    state.m_phase_start_nanos.store(nowNanos(), std::memory_order_relaxed);
+}
+
+ScopedProgressPhase::~ScopedProgressPhase() {
+    if (!m_active) {
+        return;
+    }
+    auto &state = Progress::s_state;
+    state.m_phase.store(static_cast<unsigned>(m_enclosing.m_phase),
+                        std::memory_order_relaxed);
+    state.m_phase_done.store(m_enclosing.m_phase_done,
+                             std::memory_order_relaxed);
+    state.m_phase_total.store(m_enclosing.m_phase_total,
+                              std::memory_order_relaxed);
+    state.m_phase_start_nanos.store(m_enclosing.m_phase_start_nanos,
+                                    std::memory_order_relaxed);
+}
+
+ProgressReporter::ProgressReporter
+    (unsigned interval_ms, const std::string &status_path) :
+    m_interval_ms{interval_ms == 0 ? 1 : interval_ms},
+    m_status_path{status_path},
+    m_start_nanos{nowNanos()},
+    m_last_nanos{m_start_nanos},
+    m_last_insts{0},
+    m_stop{false} {
+    Progress::reset();
+    Progress::enable(true);
+    m_thread = std::thread(&ProgressReporter::run, this);
+}
+
+ProgressReporter::~ProgressReporter() {
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stop = true;
+    }
+    m_wakeup.notify_one();
+    m_thread.join();
+    Progress::enable(false);
+    report(true);
+}
+
+void ProgressReporter::run() {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (!m_wakeup.wait_for(lock,
+                              std::chrono::milliseconds(m_interval_ms),
+                              [this] { return m_stop; })) {
+        report(false);
+    }
+}
+
+void ProgressReporter::report(bool done) {
+    auto sample = Progress::sample();
+    auto now = nowNanos();
+    double elapsed = (now - m_start_nanos) / 1e9;
+    double interval = (now - m_last_nanos) / 1e9;
+    double insts_per_sec = interval > 0
+                           ? (sample.m_insts - m_last_insts) / interval : 0;
+    double bytes_per_sec = elapsed > 0 ? sample.m_bytes / elapsed : 0;
+    m_last_nanos = now;
+    m_last_insts = sample.m_insts;
+    // negative if unknown
+    double eta = -1;
+    if (done) {
+        eta = 0;
+    } else if (sample.m_bytes < sample.m_bytes_total) {
+        if (sample.m_bytes > 0) {
+            eta = (sample.m_bytes_total - sample.m_bytes) / bytes_per_sec;
+        }
+    } else if (0 < sample.m_phase_done
+        && sample.m_phase_done < sample.m_phase_total) {
+        eta = (sample.m_phase_total - sample.m_phase_done)
+            * ((now - sample.m_phase_start_nanos) / 1e9)
+            / sample.m_phase_done;
+    }
+    const char *state = done ? "done" : "running";
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(1);
+    if (m_status_path.empty()) {
+        out << "progress state=" << state
+            << " elapsed_s=" << elapsed
+            << " phase=" << phaseName(sample.m_phase)
+            << " phase_done=" << sample.m_phase_done
+            << " phase_total=" << sample.m_phase_total
+            << " bytes=" << sample.m_bytes
+            << " bytes_total=" << sample.m_bytes_total
+            << " insts=" << sample.m_insts
+            << " insts_per_s=" << insts_per_sec
+            << " eta_s=";
+        if (eta < 0) {
+            out << "unknown";
+        } else {
+            out << eta;
+        }
+        out << "\n";
+        std::fputs(out.str().c_str(), stderr);
+        return;
+    }
+    out << "{\"state\": \"" << state << "\""
+        << ", \"elapsed_s\": " << elapsed
+        << ", \"phase\": \"" << phaseName(sample.m_phase) << "\""
+        << ", \"phase_done\": " << sample.m_phase_done
+        << ", \"phase_total\": " << sample.m_phase_total
+        << ", \"bytes\": " << sample.m_bytes
+        << ", \"bytes_total\": " << sample.m_bytes_total
+        << ", \"insts\": " << sample.m_insts
+        << ", \"insts_per_s\": " << insts_per_sec
+        << ", \"eta_s\": ";
+    if (eta < 0) {
+        out << "null";
+    } else {
+        out << eta;
+    }
+    out << "}\n";
+    // readers never see a partially written status
+    auto temp_path = m_status_path + ".tmp";
+    {
+        std::ofstream status_file{temp_path};
+        status_file << out.str();
+        if (!status_file) {
+            return;
+        }
+    }
+    std::rename(temp_path.c_str(), m_status_path.c_str());
+}
+}
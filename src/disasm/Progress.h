@@ -0,0 +1,146 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include "Stats.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace disasm {
+
+/**
+ * Progress
+ * Position of a long run published by decode and analysis loops. Loops
+ * only store to relaxed atomics once per maximal block, code range, or
+ * node, a ProgressReporter samples them from its own thread. Publishing
+ * is a no-op until enabled.
+ */
+class Progress {
+public:
+    Progress() = delete;
+
+    static void enable(bool value) noexcept {
+        s_state.m_enabled.store(value, std::memory_order_relaxed);
+    }
+
+    static bool isEnabled() noexcept {
+        return s_state.m_enabled.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * adds to the bytes expected to be decoded.
+     */
+    static void addBytesTotal(uint64_t bytes) noexcept {
+        if (isEnabled()) {
+            s_state.m_bytes_total.fetch_add(bytes, std::memory_order_relaxed);
+        }
+    }
+
+    /*
+     * adds decoded bytes and instructions, safe to call from workers.
+     */
+    static void advance(uint64_t bytes, uint64_t insts) noexcept {
+        if (isEnabled()) {
+            s_state.m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+            s_state.m_insts.fetch_add(insts, std::memory_order_relaxed);
+        }
+    }
+
+    /*
+     * sets units, e.g., nodes, done in current phase.
+     */
+    static void setPhaseDone(uint64_t done) noexcept {
+        if (isEnabled()) {
+            s_state.m_phase_done.store(done, std::memory_order_relaxed);
+        }
+    }
+
+    struct Sample {
+        StatsPhase m_phase;
+        uint64_t m_phase_done;
+        uint64_t m_phase_total;
+        uint64_t m_phase_start_nanos;
+        uint64_t m_bytes;
+        uint64_t m_bytes_total;
+        uint64_t m_insts;
+    };
+
+    static Sample sample() noexcept;
+    static void reset() noexcept;
+
+private:
+    friend class ScopedProgressPhase;
+
+    struct alignas(64) State {
+        std::atomic<bool> m_enabled;
+        std::atomic<unsigned> m_phase;
+        std::atomic<uint64_t> m_phase_done;
+        std::atomic<uint64_t> m_phase_total;
+        std::atomic<uint64_t> m_phase_start_nanos;
+        std::atomic<uint64_t> m_bytes;
+        std::atomic<uint64_t> m_bytes_total;
+        std::atomic<uint64_t> m_insts;
+    };
+
+    static State s_state;
+};
+
+/**
+ * ScopedProgressPhase
+ * Publishes a phase of given total units for its scope. The enclosing
+ * phase, e.g., decoding that hands out windows for analysis, is restored
+ * on exit.
+ */
+class ScopedProgressPhase {
+public:
+    ScopedProgressPhase(StatsPhase phase, uint64_t total) noexcept;
+    ~ScopedProgressPhase();
+
+    ScopedProgressPhase(const ScopedProgressPhase &src) = delete;
+    ScopedProgressPhase &operator=(const ScopedProgressPhase &src) = delete;
+
+private:
+    bool m_active;
+    Progress::Sample m_enclosing;
+};
+
+/**
+ * ProgressReporter
+ * Reports progress periodically until destroyed, either as a key=value
+ * line to standard error or as a JSON object that replaces the content
+ * of a status file. Rates and ETA are based on decoded bytes while
+ * decoding and on units of the current phase afterwards.
+ */
+class ProgressReporter {
+public:
+    ProgressReporter(unsigned interval_ms, const std::string &status_path);
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter &src) = delete;
+    ProgressReporter &operator=(const ProgressReporter &src) = delete;
+
+private:
+    void run();
+    void report(bool done);
+
+    unsigned m_interval_ms;
+    std::string m_status_path;
+    uint64_t m_start_nanos;
+    uint64_t m_last_nanos;
+    uint64_t m_last_insts;
+    bool m_stop;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::thread m_thread;
+};
+}
@@ -0,0 +1,47 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "RawInstRing.h"
+#include <cassert>
+
+namespace disasm {
+
+RawInstRing::RawInstRing() :
+    m_live_mask{0} {
+    for (auto &slot : m_slots) {
+        slot.m_inst.detail = &slot.m_detail;
+    }
+}
+
+RawInstRing &RawInstRing::ofThisThread() noexcept {
+    static thread_local RawInstRing ring;
+    return ring;
+}
+
+cs_insn *RawInstRing::acquire() noexcept {
+    constexpr uint32_t kAllLive = (1u << kSlotCount) - 1;
+    assert(m_live_mask != kAllLive && "Too many borrowed instructions!!");
+    unsigned index = static_cast<unsigned>(__builtin_ctz(~m_live_mask));
+    m_live_mask |= 1u << index;
+    return &m_slots[index].m_inst;
+}
+
+void RawInstRing::release(cs_insn *inst) noexcept {
+    // m_inst is the first member of a slot
+    auto index = reinterpret_cast<Slot *>(inst) - m_slots.data();
+    assert(0 <= index && index < static_cast<ptrdiff_t>(kSlotCount)
+               && "Instruction not in ring!!");
+    assert((m_live_mask & (1u << index)) != 0
+               && "Instruction released twice!!");
+    m_live_mask &= ~(1u << index);
+}
+
+unsigned RawInstRing::liveCount() const noexcept {
+    return static_cast<unsigned>(__builtin_popcount(m_live_mask));
+}
+}
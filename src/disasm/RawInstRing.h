@@ -0,0 +1,61 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include <capstone/capstone.h>
+#include <array>
+#include <cstdint>
+
+namespace disasm {
+
+/**
+ * RawInstRing
+ * Preallocated cs_insn slots, each with its own cs_detail, that are shared
+ * by all decoding loops running on a thread. A slot obtained by acquire()
+ * stays valid until it is released, hence decoding into a borrowed slot
+ * allocates nothing. At most kSlotCount slots can be borrowed at a time
+ * on the same thread.
+ *
+ * Note that copying a decoded instruction into an MCInst still allocates
+ * per instruction whenever its mnemonic or operands exceed the small
+ * string buffer of std::string.
+ */
+class RawInstRing final {
+public:
+    static constexpr unsigned kSlotCount = 8;
+
+    /*
+     * returns the ring of the calling thread. It's allocated once per thread.
+     */
+    static RawInstRing &ofThisThread() noexcept;
+
+    ~RawInstRing() = default;
+    RawInstRing(const RawInstRing &src) = delete;
+    RawInstRing &operator=(const RawInstRing &src) = delete;
+    RawInstRing(RawInstRing &&src) = delete;
+
+    cs_insn *acquire() noexcept;
+    void release(cs_insn *inst) noexcept;
+    unsigned liveCount() const noexcept;
+
+private:
+    RawInstRing();
+
+private:
+    // a slot occupies whole cache lines to avoid false sharing between
+    // slots handed out to different loops.
+    struct alignas(64) Slot {
+        cs_insn m_inst;
+        cs_detail m_detail;
+    };
+    std::array<Slot, kSlotCount> m_slots;
+    // bit i is set while slot i is borrowed
+    uint32_t m_live_mask;
+};
+}
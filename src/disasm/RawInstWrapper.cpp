@@ -7,6 +7,7 @@
 // Copyright (c) 2015-2016 University of Kaiserslautern.
 
 #include "RawInstWrapper.h"
+#include "RawInstRing.h"
 
 namespace disasm {
 
@@ -21,6 +22,18 @@ RawInstWrapper::RawInstWrapper(cs_insn *inst) :
     m_inst{inst}
 { }
 
+RawInstWrapper RawInstWrapper::fromThreadRing() {
+    RawInstWrapper result{nullptr};
+    result.m_inst =
+        std::unique_ptr<cs_insn, RawInstWrapper::DefaultDeleter>
+            (RawInstRing::ofThisThread().acquire(), DefaultDeleter{false});
+    return result;
+}
+
+void RawInstWrapper::releaseToThreadRing(cs_insn *inst) noexcept {
+    RawInstRing::ofThisThread().release(inst);
+}
+
 cs_insn*
 RawInstWrapper::rawPtr()
 {
@@ -29,10 +29,16 @@ public:
      * Owns a pointer to an already allocated cs_insn.
      */
     explicit RawInstWrapper(cs_insn *instruction);
+    /**
+     * Borrows a slot of the ring of the calling thread until destroyed.
+     * No memory is allocated or freed.
+     */
+    static RawInstWrapper fromThreadRing();
     ~RawInstWrapper() = default;
     RawInstWrapper(const RawInstWrapper &src) = delete;
     RawInstWrapper &operator=(const RawInstWrapper &src) = delete;
     RawInstWrapper(RawInstWrapper &&src) = default;
+    RawInstWrapper &operator=(RawInstWrapper &&src) = default;
     cs_insn *rawPtr();
 
     bool isValid() const;
@@ -40,7 +46,13 @@ public:
 private:
     class DefaultDeleter {
     public:
+        DefaultDeleter() : m_owner{true} { }
+        explicit DefaultDeleter(bool owner) : m_owner{owner} { }
         void operator()(cs_insn *inst) {
+            if (!m_owner) {
+                releaseToThreadRing(inst);
+                return;
+            }
             if (inst->detail != NULL) {
                 // memory for instruction details could have been allocated
                 // by capstone API.
@@ -48,7 +60,10 @@ private:
             }
             free(inst);
         }
+    private:
+        bool m_owner;
     };
+    static void releaseToThreadRing(cs_insn *inst) noexcept;
     std::unique_ptr<cs_insn, RawInstWrapper::DefaultDeleter> m_inst;
 };
 }
@@ -12,21 +12,24 @@
 
 namespace disasm {
 
-SectionDisassemblyARM::SectionDisassemblyARM() : m_valid(false) {
+SectionDisassemblyARM::SectionDisassemblyARM() :
+    m_valid(false),
+    m_window_start_addr{0},
+    m_window_end_addr{0} {
 }
 
 SectionDisassemblyARM::SectionDisassemblyARM
     (const elf::section *section) :
-    m_valid{false},
-    m_isa{ISAType::kThumb},
-    m_section{section} {
+    SectionDisassemblyARM(section, ISAType::kThumb) {
 }
 
 SectionDisassemblyARM::SectionDisassemblyARM
     (const elf::section *section, ISAType isa) :
     m_valid{false},
     m_isa{isa},
-    m_section{section} {
+    m_section{section},
+    m_window_start_addr{section->get_hdr().addr},
+    m_window_end_addr{section->get_hdr().addr + section->get_hdr().size} {
 }
 
 const std::string
@@ -59,7 +62,8 @@ void SectionDisassemblyARM::add(const MaximalBlock &max_block) {
 }
 
 void SectionDisassemblyARM::add(MaximalBlock &&max_block) {
-    m_max_blocks.emplace_back(max_block);
+    max_block.m_id = m_max_blocks.size();
+    m_max_blocks.emplace_back(std::move(max_block));
 }
 
 const MaximalBlock &SectionDisassemblyARM::back() const {
@@ -110,8 +114,23 @@ std::vector<MaximalBlock>::const_iterator SectionDisassemblyARM::cend() const {
 }
 
 bool SectionDisassemblyARM::isWithinSectionAddressSpace(const addr_t &addr) const {
-    return m_section->get_hdr().addr <= addr &&
-        addr < m_section->get_hdr().addr + m_section->get_hdr().size;
+    return m_window_start_addr <= addr && addr < m_window_end_addr;
+}
+
+void SectionDisassemblyARM::setWindow
+    (addr_t start_addr, addr_t end_addr) noexcept {
+    assert(secStartAddr() <= start_addr && end_addr <= secEndAddr()
+               && "Invalid window of section!!");
+    m_window_start_addr = start_addr;
+    m_window_end_addr = end_addr;
+}
+
+addr_t SectionDisassemblyARM::windowStartAddr() const noexcept {
+    return m_window_start_addr;
+}
+
+addr_t SectionDisassemblyARM::windowEndAddr() const noexcept {
+    return m_window_end_addr;
 }
 
 size_t SectionDisassemblyARM::maximalBlockCount() const {
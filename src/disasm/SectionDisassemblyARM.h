@@ -34,6 +34,7 @@ public:
     SectionDisassemblyARM(const SectionDisassemblyARM &src) = default;
     SectionDisassemblyARM &operator=(const SectionDisassemblyARM &src) = default;
     SectionDisassemblyARM(SectionDisassemblyARM &&src) = default;
+    SectionDisassemblyARM &operator=(SectionDisassemblyARM &&src) = default;
     const MaximalBlock &maximalBlockAt(size_t index) const;
     MaximalBlock *ptrToMaximalBlockAt(size_t index);
     std::vector<MaximalBlock>::const_iterator cbegin() const;
@@ -57,6 +58,10 @@ public:
     const uint8_t *ptrToData() const;
     size_t maximalBlockCount() const;
     void add(const MaximalBlock &max_block);
+    /*
+     * Takes ownership of max_block and renumbers it to its index in
+     * this disassembly. Needed for windows of a streamed section.
+     */
     void add(MaximalBlock &&max_block);
     const MaximalBlock &back() const;
     addr_t virtualAddrOf(const uint8_t *ptr) const;
@@ -65,7 +70,14 @@ public:
 
     bool isLast(const MaximalBlock *max_block) const;
     bool isFirst(const MaximalBlock *max_block) const;
+    /*
+     * return true if addr is within the window covered by this disassembly
+     * which is the whole section unless set otherwise.
+     */
     bool isWithinSectionAddressSpace(const addr_t & addr) const;
+    void setWindow(addr_t start_addr, addr_t end_addr) noexcept;
+    addr_t windowStartAddr() const noexcept;
+    addr_t windowEndAddr() const noexcept;
     ISAType getISA() const;
     void reserve(size_t maximal_block_count);
     size_t size() const noexcept;
@@ -75,6 +87,8 @@ private:
     ISAType m_isa;
     // section size in bytes, section start address, section ptr, setion name
     const elf::section *m_section;
+    addr_t m_window_start_addr;
+    addr_t m_window_end_addr;
     std::vector<MaximalBlock> m_max_blocks;
 
 };
@@ -0,0 +1,446 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "Stats.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <thread>
+#endif
+
+namespace disasm {
+
+static const unsigned kEventSlotBase =
+    Stats::kCounterCount + 2 * Stats::kPhaseCount;
+static const unsigned kSlotCount =
+    kEventSlotBase + Stats::kPhaseCount * PerfCounters::kEventCount;
+
+static const char *kPhaseNames[] = {
+    "elf_load",
+    "symbol_scan",
+    "symbol_decode",
+    "speculative_decode",
+    "mb_build",
+    "build_cfg",
+    "refine_cfg",
+    "refine_nodes",
+    "recover_switch_statements",
+    "identify_pc_relative_load_data",
+    "build_call_graph"
+};
+
+// phase a phase is nested in, kCount at top level
+static const StatsPhase kPhaseParents[] = {
+    StatsPhase::kCount,
+    StatsPhase::kCount,
+    StatsPhase::kCount,
+    StatsPhase::kCount,
+    StatsPhase::kSpeculativeDecode,
+    StatsPhase::kCount,
+    StatsPhase::kCount,
+    StatsPhase::kRefineCFG,
+    StatsPhase::kRefineCFG,
+    StatsPhase::kRefineCFG,
+    StatsPhase::kCount
+};
+
+static const char *kCounterNames[] = {
+    "capstone_calls",
+    "invalid_decodes",
+    "maximal_blocks",
+    "shared_inst_copies",
+    "build_allocations",
+    "build_bytes_moved",
+    "build_bytes_copied",
+    "overlaps_resolved",
+    "nodes_invalidated",
+    "switch_tables",
+    "procedures"
+};
+
+static_assert(sizeof(kPhaseNames) / sizeof(kPhaseNames[0])
+                  == Stats::kPhaseCount, "phase names out of sync");
+static_assert(sizeof(kPhaseParents) / sizeof(kPhaseParents[0])
+                  == Stats::kPhaseCount, "phase parents out of sync");
+static_assert(sizeof(kCounterNames) / sizeof(kCounterNames[0])
+                  == Stats::kCounterCount, "counter names out of sync");
+
+static std::atomic<bool> g_enabled{false};
+static std::atomic<bool> g_perf_enabled{false};
+static std::atomic<bool> g_markers_enabled{false};
+
+namespace {
+
+/*
+ * Slots of a single thread. Only the owning thread writes, collect reads
+ * concurrently which is why slots are atomic.
+ */
+struct ThreadSlots {
+    ThreadSlots();
+    ~ThreadSlots();
+
+    void add(unsigned slot, uint64_t value) noexcept {
+        m_values[slot].store(m_values[slot].load(std::memory_order_relaxed)
+                                 + value, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> m_values[kSlotCount];
+};
+
+struct SlotRegistry {
+    std::mutex m_mutex;
+    std::vector<ThreadSlots *> m_threads;
+    // totals of exited threads
+    uint64_t m_retired[kSlotCount] = {};
+};
+
+SlotRegistry &registry() {
+    static SlotRegistry instance;
+    return instance;
+}
+
+ThreadSlots::ThreadSlots() {
+    for (auto &value : m_values) {
+        value.store(0, std::memory_order_relaxed);
+    }
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock{reg.m_mutex};
+    reg.m_threads.push_back(this);
+}
+
+ThreadSlots::~ThreadSlots() {
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock{reg.m_mutex};
+    for (unsigned i = 0; i < kSlotCount; ++i) {
+        reg.m_retired[i] += m_values[i].load(std::memory_order_relaxed);
+    }
+    reg.m_threads.erase(std::find(reg.m_threads.begin(),
+                                  reg.m_threads.end(),
+                                  this));
+}
+
+ThreadSlots &threadSlots() {
+    static thread_local ThreadSlots slots;
+    return slots;
+}
+
+struct MarkerFile {
+    std::mutex m_mutex;
+    std::ofstream m_out;
+};
+
+MarkerFile &markerFile() {
+    static MarkerFile instance;
+    return instance;
+}
+
+uint64_t currentThreadId() noexcept {
+#ifdef __linux__
+    // matches tids reported by perf
+    return static_cast<uint64_t>(syscall(SYS_gettid));
+#else
+    return std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+}
+
+void writeMarker(StatsPhase phase, char kind) noexcept {
+    // steady_clock is CLOCK_MONOTONIC on linux
+    auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>
+        (std::chrono::steady_clock::now().time_since_epoch()).count();
+    auto tid = currentThreadId();
+    auto &file = markerFile();
+    std::lock_guard<std::mutex> lock{file.m_mutex};
+    file.m_out << nanos << " " << tid << " " << kind << " "
+               << kPhaseNames[static_cast<unsigned>(phase)] << "\n";
+}
+}
+
+Stats::Stats() :
+    m_minor_faults{0},
+    m_major_faults{0} {
+    std::fill(m_counters, m_counters + kCounterCount, 0);
+    std::fill(m_phase_nanos, m_phase_nanos + kPhaseCount, 0);
+    std::fill(m_phase_calls, m_phase_calls + kPhaseCount, 0);
+    std::fill(&m_phase_events[0][0],
+              &m_phase_events[0][0] + kPhaseCount * PerfCounters::kEventCount,
+              0);
+}
+
+void Stats::enable(bool value) noexcept {
+    g_enabled.store(value, std::memory_order_relaxed);
+}
+
+bool Stats::isEnabled() noexcept {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void Stats::count(StatsCounter counter, uint64_t value) noexcept {
+    if (!isEnabled()) {
+        return;
+    }
+    threadSlots().add(static_cast<unsigned>(counter), value);
+}
+
+void Stats::addPhaseTime(StatsPhase phase, uint64_t nanos) noexcept {
+    auto &slots = threadSlots();
+    auto index = kCounterCount + static_cast<unsigned>(phase);
+    slots.add(index, nanos);
+    slots.add(index + kPhaseCount, 1);
+}
+
+bool Stats::enablePerfCounters(bool value) noexcept {
+    uint64_t events[PerfCounters::kEventCount];
+    if (value && !PerfCounters::read(events)) {
+        g_perf_enabled.store(false, std::memory_order_relaxed);
+        return false;
+    }
+    g_perf_enabled.store(value, std::memory_order_relaxed);
+    return true;
+}
+
+bool Stats::setMarkerFile(const std::string &path) {
+    auto &file = markerFile();
+    std::lock_guard<std::mutex> lock{file.m_mutex};
+    if (file.m_out.is_open()) {
+        file.m_out.close();
+    }
+    g_markers_enabled.store(false, std::memory_order_relaxed);
+    if (path.empty()) {
+        return true;
+    }
+    file.m_out.open(path);
+    if (!file.m_out) {
+        return false;
+    }
+    file.m_out << "# ns tid B|E phase\n";
+    g_markers_enabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+bool Stats::isSampled(StatsPhase phase) noexcept {
+    // maximal blocks are built one at a time, too short to sample
+    return phase != StatsPhase::kMaximalBlockBuild
+        && (g_perf_enabled.load(std::memory_order_relaxed)
+            || g_markers_enabled.load(std::memory_order_relaxed));
+}
+
+void Stats::beginSample(StatsPhase phase, uint64_t *events) noexcept {
+    if (g_markers_enabled.load(std::memory_order_relaxed)) {
+        writeMarker(phase, 'B');
+    }
+    if (!g_perf_enabled.load(std::memory_order_relaxed)
+        || !PerfCounters::read(events)) {
+        std::fill(events, events + PerfCounters::kEventCount, UINT64_MAX);
+    }
+}
+
+void Stats::endSample(StatsPhase phase, const uint64_t *events) noexcept {
+    uint64_t current[PerfCounters::kEventCount];
+    if (events[0] != UINT64_MAX && PerfCounters::read(current)) {
+        auto &slots = threadSlots();
+        auto index = kEventSlotBase
+            + static_cast<unsigned>(phase) * PerfCounters::kEventCount;
+        for (unsigned i = 0; i < PerfCounters::kEventCount; ++i) {
+            // multiplex scaling may yield a smaller estimate than before
+            if (current[i] > events[i]) {
+                slots.add(index + i, current[i] - events[i]);
+            }
+        }
+    }
+    if (g_markers_enabled.load(std::memory_order_relaxed)) {
+        writeMarker(phase, 'E');
+    }
+}
+
+Stats Stats::collect() {
+    uint64_t values[kSlotCount];
+    auto &reg = registry();
+    {
+        std::lock_guard<std::mutex> lock{reg.m_mutex};
+        std::copy(reg.m_retired, reg.m_retired + kSlotCount, values);
+        for (auto slots : reg.m_threads) {
+            for (unsigned i = 0; i < kSlotCount; ++i) {
+                values[i] +=
+                    slots->m_values[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    Stats result;
+    std::copy(values, values + kCounterCount, result.m_counters);
+    std::copy(values + kCounterCount,
+              values + kCounterCount + kPhaseCount,
+              result.m_phase_nanos);
+    std::copy(values + kCounterCount + kPhaseCount,
+              values + kEventSlotBase,
+              result.m_phase_calls);
+    std::copy(values + kEventSlotBase,
+              values + kSlotCount,
+              &result.m_phase_events[0][0]);
+    result.m_memory = MemoryStats::collect();
+    return result;
+}
+
+void Stats::reset() {
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock{reg.m_mutex};
+    std::fill(reg.m_retired, reg.m_retired + kSlotCount, 0);
+    for (auto slots : reg.m_threads) {
+        for (auto &value : slots->m_values) {
+            value.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+const char *Stats::nameOf(StatsPhase phase) noexcept {
+    return kPhaseNames[static_cast<unsigned>(phase)];
+}
+
+const char *Stats::nameOf(StatsCounter counter) noexcept {
+    return kCounterNames[static_cast<unsigned>(counter)];
+}
+
+uint64_t Stats::counter(StatsCounter counter) const noexcept {
+    return m_counters[static_cast<unsigned>(counter)];
+}
+
+uint64_t Stats::phaseNanos(StatsPhase phase) const noexcept {
+    return m_phase_nanos[static_cast<unsigned>(phase)];
+}
+
+uint64_t Stats::phaseCalls(StatsPhase phase) const noexcept {
+    return m_phase_calls[static_cast<unsigned>(phase)];
+}
+
+uint64_t
+Stats::phaseEvents(StatsPhase phase, PerfEvent event) const noexcept {
+    auto &events = m_phase_events[static_cast<unsigned>(phase)];
+    return events[static_cast<unsigned>(event)];
+}
+
+bool Stats::hasPerfCounters() const noexcept {
+    for (unsigned i = 0; i < kPhaseCount; ++i) {
+        if (m_phase_events[i][static_cast<unsigned>(PerfEvent::kCycles)]
+            != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const MemoryStats &Stats::memory() const noexcept {
+    return m_memory;
+}
+
+void Stats::setPageFaults(uint64_t minor, uint64_t major) noexcept {
+    m_minor_faults = minor;
+    m_major_faults = major;
+}
+
+void Stats::print(std::ostream &out) const {
+    auto flags = out.flags();
+    bool perf = hasPerfCounters();
+    out << std::left << std::setw(36) << "phase"
+        << std::right << std::setw(10) << "calls"
+        << std::setw(14) << "total ms";
+    if (perf) {
+        out << std::setw(8) << "IPC"
+            << std::setw(16) << "cache miss/ki"
+            << std::setw(16) << "branch miss/ki";
+    }
+    out << "\n" << std::fixed << std::setprecision(3);
+    for (unsigned i = 0; i < kPhaseCount; ++i) {
+        if (m_phase_calls[i] == 0) {
+            continue;
+        }
+        // nested phases are part of their parent's time
+        std::string name = kPhaseParents[i] == StatsPhase::kCount ? "" : "  ";
+        name += kPhaseNames[i];
+        out << std::left << std::setw(36) << name
+            << std::right << std::setw(10) << m_phase_calls[i]
+            << std::setw(14) << m_phase_nanos[i] / 1e6;
+        auto events = m_phase_events[i];
+        auto insts = events[static_cast<unsigned>(PerfEvent::kInstructions)];
+        auto cycles = events[static_cast<unsigned>(PerfEvent::kCycles)];
+        if (perf && insts != 0 && cycles != 0) {
+            auto per_kilo_inst = 1000.0 / insts;
+            out << std::setprecision(2)
+                << std::setw(8) << static_cast<double>(insts) / cycles
+                << std::setw(16) << per_kilo_inst
+                    * events[static_cast<unsigned>(PerfEvent::kCacheMisses)]
+                << std::setw(16) << per_kilo_inst
+                    * events[static_cast<unsigned>(PerfEvent::kBranchMisses)]
+                << std::setprecision(3);
+        }
+        out << "\n";
+    }
+    out << "\n" << std::left << std::setw(36) << "counter"
+        << std::right << std::setw(24) << "value" << "\n";
+    for (unsigned i = 0; i < kCounterCount; ++i) {
+        out << std::left << std::setw(36) << kCounterNames[i]
+            << std::right << std::setw(24) << m_counters[i] << "\n";
+    }
+    out << std::left << std::setw(36) << "minor_page_faults"
+        << std::right << std::setw(24) << m_minor_faults << "\n"
+        << std::left << std::setw(36) << "major_page_faults"
+        << std::right << std::setw(24) << m_major_faults << "\n";
+    out.flags(flags);
+    if (MemoryStats::isAvailable()) {
+        out << "\n";
+        m_memory.print(out);
+    }
+}
+
+void Stats::writeJson(std::ostream &out) const {
+    bool perf = hasPerfCounters();
+    out << "{\n  \"phases\": [";
+    bool first = true;
+    for (unsigned i = 0; i < kPhaseCount; ++i) {
+        if (m_phase_calls[i] == 0) {
+            continue;
+        }
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "    {\"name\": \"" << kPhaseNames[i] << "\""
+            << ", \"parent\": ";
+        if (kPhaseParents[i] == StatsPhase::kCount) {
+            out << "null";
+        } else {
+            out << "\"" << nameOf(kPhaseParents[i]) << "\"";
+        }
+        out << ", \"calls\": " << m_phase_calls[i]
+            << ", \"ns\": " << m_phase_nanos[i];
+        if (perf) {
+            for (unsigned j = 0; j < PerfCounters::kEventCount; ++j) {
+                out << ", \"" << PerfCounters::nameOf(static_cast<PerfEvent>(j))
+                    << "\": " << m_phase_events[i][j];
+            }
+        }
+        out << "}";
+    }
+    out << (first ? "" : "\n  ") << "],\n  \"counters\": {\n";
+    for (unsigned i = 0; i < kCounterCount; ++i) {
+        out << "    \"" << kCounterNames[i] << "\": " << m_counters[i]
+            << (i + 1 < kCounterCount ? "," : "") << "\n";
+    }
+    out << "  },\n  \"page_faults\": {\"minor\": " << m_minor_faults
+        << ", \"major\": " << m_major_faults << "}";
+    if (MemoryStats::isAvailable()) {
+        out << ",\n  \"memory\": ";
+        m_memory.writeJson(out);
+    }
+    out << "\n}\n";
+}
+}
@@ -0,0 +1,214 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include "MemoryStats.h"
+#include "PerfCounters.h"
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace disasm {
+
+/*
+ * Phases are listed in execution order, nested phases follow their parent.
+ */
+enum class StatsPhase : unsigned {
+    kElfLoad,
+    kSymbolScan,
+    kSymbolDecode,
+    kSpeculativeDecode,
+    kMaximalBlockBuild,
+    kBuildCFG,
+    kRefineCFG,
+    kRefineNodes,
+    kRecoverSwitchStatements,
+    kIdentifyPCRelativeLoadData,
+    kBuildCallGraph,
+    kCount
+};
+
+enum class StatsCounter : unsigned {
+    kCapstoneCalls,
+    kInvalidDecodes,
+    kMaximalBlocks,
+    kSharedInstCopies,
+    kBuildAllocations,
+    kBuildBytesMoved,
+    kBuildBytesCopied,
+    kOverlapsResolved,
+    kNodesInvalidated,
+    kSwitchTables,
+    kProcedures,
+    kCount
+};
+
+/**
+ * Stats
+ * Process wide phase timings and counters. Each thread records into its
+ * own slots, so recording costs neither a lock nor a contended atomic.
+ * Recording is a no-op until enabled, and the SPEDI_PHASE and SPEDI_COUNT
+ * macros compile to nothing unless SPEDI_STATS is defined.
+ *
+ * An instance is a snapshot of all threads returned by collect. Heap
+ * usage is reported alongside if MemoryStats is available.
+ *
+ * Phases other than per block ones can additionally be sampled, i.e.,
+ * hardware counters are read at their start and end, and begin and end
+ * markers are written to a marker file. Markers carry CLOCK_MONOTONIC
+ * timestamps and thread ids so they line up with samples of
+ * 'perf record -k CLOCK_MONOTONIC'.
+ */
+class Stats {
+public:
+    static constexpr unsigned kPhaseCount =
+        static_cast<unsigned>(StatsPhase::kCount);
+    static constexpr unsigned kCounterCount =
+        static_cast<unsigned>(StatsCounter::kCount);
+
+    Stats();
+    virtual ~Stats() = default;
+    Stats(const Stats &src) = default;
+    Stats &operator=(const Stats &src) = default;
+    Stats(Stats &&src) = default;
+
+    static void enable(bool value) noexcept;
+    static bool isEnabled() noexcept;
+    static void count(StatsCounter counter, uint64_t value) noexcept;
+    static void addPhaseTime(StatsPhase phase, uint64_t nanos) noexcept;
+    /*
+     * returns false if perf events can not be read on this system.
+     */
+    static bool enablePerfCounters(bool value) noexcept;
+    /*
+     * returns false if the marker file can not be opened.
+     */
+    static bool setMarkerFile(const std::string &path);
+    static bool isSampled(StatsPhase phase) noexcept;
+    static void beginSample(StatsPhase phase, uint64_t *events) noexcept;
+    static void endSample(StatsPhase phase, const uint64_t *events) noexcept;
+    /*
+     * returns totals of live and exited threads.
+     */
+    static Stats collect();
+    static void reset();
+
+    static const char *nameOf(StatsPhase phase) noexcept;
+    static const char *nameOf(StatsCounter counter) noexcept;
+
+    uint64_t counter(StatsCounter counter) const noexcept;
+    uint64_t phaseNanos(StatsPhase phase) const noexcept;
+    uint64_t phaseCalls(StatsPhase phase) const noexcept;
+    uint64_t phaseEvents(StatsPhase phase, PerfEvent event) const noexcept;
+    bool hasPerfCounters() const noexcept;
+    const MemoryStats &memory() const noexcept;
+    /*
+     * page faults are counted by the caller, e.g., around loading and
+     * decoding a mapped file, and reported alongside.
+     */
+    void setPageFaults(uint64_t minor, uint64_t major) noexcept;
+
+    void print(std::ostream &out) const;
+    void writeJson(std::ostream &out) const;
+
+private:
+    uint64_t m_counters[kCounterCount];
+    uint64_t m_phase_nanos[kPhaseCount];
+    uint64_t m_phase_calls[kPhaseCount];
+    uint64_t m_phase_events[kPhaseCount][PerfCounters::kEventCount];
+    MemoryStats m_memory;
+    uint64_t m_minor_faults;
+    uint64_t m_major_faults;
+};
+
+/**
+ * ScopedPhaseTimer
+ * Adds the time spent in its scope to a phase. Time between suspend and
+ * resume, e.g., spent in a callback, is not accounted. Suspending an
+ * already suspended timer has no effect. Hardware counters
+ * of sampled phases cover the whole scope as reading them per suspend
+ * would cost a system call each.
+ */
+class ScopedPhaseTimer {
+public:
+    explicit ScopedPhaseTimer(StatsPhase phase) noexcept :
+        m_phase{phase},
+        m_active{Stats::isEnabled()},
+        m_sampled{m_active && Stats::isSampled(phase)},
+        m_running{m_active},
+        m_elapsed{0} {
+        if (m_sampled) {
+            Stats::beginSample(m_phase, m_events);
+        }
+        if (m_active) {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedPhaseTimer() {
+        if (m_active) {
+            suspend();
+            Stats::addPhaseTime
+                (m_phase,
+                 static_cast<uint64_t>(std::chrono::duration_cast
+                     <std::chrono::nanoseconds>(m_elapsed).count()));
+        }
+        if (m_sampled) {
+            Stats::endSample(m_phase, m_events);
+        }
+    }
+
+    ScopedPhaseTimer(const ScopedPhaseTimer &src) = delete;
+    ScopedPhaseTimer &operator=(const ScopedPhaseTimer &src) = delete;
+
+    void suspend() noexcept {
+        if (m_running) {
+            m_elapsed += std::chrono::steady_clock::now() - m_start;
+            m_running = false;
+        }
+    }
+
+    void resume() noexcept {
+        if (m_active && !m_running) {
+            m_start = std::chrono::steady_clock::now();
+            m_running = true;
+        }
+    }
+
+private:
+    StatsPhase m_phase;
+    bool m_active;
+    bool m_sampled;
+    // false while suspended
+    bool m_running;
+    uint64_t m_events[PerfCounters::kEventCount];
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::duration m_elapsed;
+};
+}
+
+#ifdef SPEDI_STATS
+#define SPEDI_STATS_CONCAT_(a, b) a##b
+#define SPEDI_STATS_CONCAT(a, b) SPEDI_STATS_CONCAT_(a, b)
+#define SPEDI_PHASE_TIMER(name, phase) \
+    disasm::ScopedPhaseTimer name{disasm::StatsPhase::phase}
+#define SPEDI_PHASE(phase) \
+    SPEDI_PHASE_TIMER(SPEDI_STATS_CONCAT(spedi_phase_, __LINE__), phase)
+#define SPEDI_PHASE_SUSPEND(name) name.suspend()
+#define SPEDI_PHASE_RESUME(name) name.resume()
+#define SPEDI_COUNT(counter, value) \
+    disasm::Stats::count(disasm::StatsCounter::counter, value)
+#else
+#define SPEDI_PHASE_TIMER(name, phase) ((void) 0)
+#define SPEDI_PHASE(phase) ((void) 0)
+#define SPEDI_PHASE_SUSPEND(name) ((void) 0)
+#define SPEDI_PHASE_RESUME(name) ((void) 0)
+#define SPEDI_COUNT(counter, value) ((void) 0)
+#endif
@@ -7,6 +7,8 @@
 // Copyright (c) 2016 University of Kaiserslautern.
 
 #include "CFGNode.h"
+#include "disasm/AnalysisBudget.h"
+#include "disasm/Stats.h"
 #include <cassert>
 
 namespace disasm {
@@ -121,6 +123,10 @@ void CFGNode::setCandidateStartAddr(addr_t candidate_start) noexcept {
     // match it.
     for (const auto &inst : m_max_block->getInstructions()) {
         if (candidate_start <= inst.addr()) {
+            if (m_candidate_start_addr != inst.addr()) {
+                SPEDI_DECISION(kCandidateStart, 0, id(), inst.addr(),
+                               m_candidate_start_addr);
+            }
             m_candidate_start_addr = inst.addr();
             break;
         }
@@ -178,10 +184,19 @@ bool CFGNode::isCandidateStartAddressValid
     return candidate_addr <= m_max_block->addrOfLastInst();
 }
 
-void CFGNode::setToDataAndInvalidatePredecessors() {
+void CFGNode::setToDataAndInvalidatePredecessors(TraceDataReason reason) {
+    if (m_type != CFGNodeType::kData) {
+        SPEDI_COUNT(kNodesInvalidated, 1);
+        SPEDI_DECISION(kNodeToData, reason, id(),
+                       m_max_block->addrOfFirstInst(), 0);
+    }
     m_type = CFGNodeType::kData;
     for (auto pred_iter = m_direct_preds.begin();
          pred_iter < m_direct_preds.end(); ++pred_iter) {
+        if (AnalysisBudget::shouldStop()) {
+            // invalidation of long chains is cut off
+            return;
+        }
         if (!(*pred_iter).node()->isData()
             && (*pred_iter).type() == CFGEdgeType::kDirect
             || (*pred_iter).type() == CFGEdgeType::kConditional) {
@@ -189,7 +204,8 @@ void CFGNode::setToDataAndInvalidatePredecessors() {
 //                   this->id(),
 //                   this->maximalBlock()->addrOfLastInst(),
 //                   (*pred_iter).node()->id());
-            (*pred_iter).node()->setToDataAndInvalidatePredecessors();
+            (*pred_iter).node()->setToDataAndInvalidatePredecessors
+                (TraceDataReason::kInvalidSuccessor);
         }
     }
 }
@@ -9,6 +9,7 @@
 #pragma once
 #include "disasm/common.h"
 #include "disasm/MaximalBlock.h"
+#include "disasm/DecisionTrace.h"
 #include "CFGEdge.h"
 #include <functional>
 
@@ -91,7 +92,7 @@ public:
     addr_t getCandidateStartAddr() const noexcept;
     void setCandidateStartAddr(addr_t candidate_start) noexcept;
     void setType(const CFGNodeType type);
-    void setToDataAndInvalidatePredecessors();
+    void setToDataAndInvalidatePredecessors(TraceDataReason reason);
     void resetCandidateStartAddress();
     CFGNodeType getType() const;
     bool isData() const;
@@ -7,6 +7,7 @@
 // Copyright (c) 2016 University of Kaiserslautern.
 
 #include "DisassemblyCallGraph.h"
+#include "disasm/DecisionTrace.h"
 #include <algorithm>
 #include <cassert>
 #include <iostream>
@@ -88,6 +89,9 @@ void DisassemblyCallGraph::buildCallGraph() noexcept {
                     node_pair.first = ICFGExitNodeType::kOverlap;
                 }
             }
+            SPEDI_DECISION(kProcedureExit, node_pair.first,
+                           node_pair.second->id(), (*proc_iter).entryAddr(),
+                           node_pair.second->maximalBlock()->endAddr());
             // If tail call proc (node_pair)
         }
         prettyPrintProcedure(*proc_iter);
@@ -108,27 +112,37 @@ bool DisassemblyCallGraph::isNonReturnProcedure(const ICFGNode &proc) const noex
     return false;
 }
 
-void DisassemblyCallGraph::checkNonReturnProcedureAndFixCallers
-    (ICFGNode &proc) const noexcept {
+bool DisassemblyCallGraph::checkNonReturnProcedureAndFixCallers
+    (ICFGNode &proc, std::vector<CFGNode *> &fixed_calls) const noexcept {
 
-    if (!proc.isReturnsToCaller()) {
-        for (const auto &type_node_pair : proc.getExitNodes()) {
-            if (type_node_pair.first != ICFGExitNodeType::kTailCall) {
-                // indirect branches with unknown destination
-                return;
-            }
-            if (!type_node_pair.second->maximalBlock()->branchInfo().isCall()) {
-                // branch to procedure that is not well-known non-return procedure
-                return;
-            }
+    if (proc.isNonReturnProcedure() || proc.isReturnsToCaller()) {
+        return false;
+    }
+    for (const auto &type_node_pair : proc.getExitNodes()) {
+        if (type_node_pair.first != ICFGExitNodeType::kTailCall) {
+            // indirect branches with unknown destination
+            return false;
         }
-        // TODO: recursively identify non-return procedures?
-        proc.setNonReturn(true);
-        for (auto &cfg_edge : proc.entryNode()->getDirectPredecessors()) {
-            if (cfg_edge.type() == CFGEdgeType::kDirect
-                && cfg_edge.node()->isCall()) {
-                cfg_edge.node()->setIsCall(false);
-            }
+        if (!type_node_pair.second->maximalBlock()->branchInfo().isCall()) {
+            // branch to procedure that is not known to be non-returning
+            return false;
+        }
+    }
+    markNonReturnProcedure(proc, fixed_calls);
+    return true;
+}
+
+void DisassemblyCallGraph::markNonReturnProcedure
+    (ICFGNode &proc, std::vector<CFGNode *> &fixed_calls) const noexcept {
+    proc.setNonReturn(true);
+    if (proc.entryNode() == nullptr) {
+        return;
+    }
+    for (auto &cfg_edge : proc.entryNode()->getDirectPredecessors()) {
+        if (cfg_edge.type() == CFGEdgeType::kDirect
+            && cfg_edge.node()->isCall()) {
+            cfg_edge.node()->setIsCall(false);
+            fixed_calls.push_back(cfg_edge.node());
         }
     }
 }
@@ -209,4 +223,9 @@ void DisassemblyCallGraph::prettyPrintProcedure
 addr_t DisassemblyCallGraph::sectionEndAddr() const noexcept {
     return m_section_end_addr;
 }
+
+const std::vector<ICFGNode> &
+DisassemblyCallGraph::getMainProcedures() const noexcept {
+    return m_main_procs;
+}
 }
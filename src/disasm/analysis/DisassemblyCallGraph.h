@@ -46,8 +46,23 @@ public:
     void setSectionStartAddr(addr_t sec_start_addr) noexcept;
     void setSectionEndAddr(addr_t sec_end_addr) noexcept;
     bool isNonReturnProcedure(const ICFGNode &proc) const noexcept;
-    void checkNonReturnProcedureAndFixCallers(ICFGNode &proc) const noexcept;
+    /*
+     * Marks proc as non-returning if all of its exits are calls to
+     * non-returning procedures. Returns true if proc was marked.
+     */
+    bool checkNonReturnProcedureAndFixCallers
+        (ICFGNode &proc, std::vector<CFGNode *> &fixed_calls) const noexcept;
+    /*
+     * Marks proc as non-returning. Direct calls to proc no longer fall
+     * through, they are appended to fixed_calls.
+     */
+    void markNonReturnProcedure
+        (ICFGNode &proc, std::vector<CFGNode *> &fixed_calls) const noexcept;
     addr_t sectionEndAddr() const noexcept;
+    /*
+     * returns procedures of this section sorted by entry address.
+     */
+    const std::vector<ICFGNode> &getMainProcedures() const noexcept;
     friend class SectionDisassemblyAnalyzerARM;
 private:
     std::vector<ICFGNode> &buildInitialCallGraph() noexcept;
@@ -0,0 +1,244 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#include "NoReturnDatabase.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace disasm {
+
+static const uint32_t kEmptySlot = ~0U;
+// seeds tried per bucket before growing the table.
+static const uint32_t kMaxSeed = 1U << 16;
+
+static const char *kBuiltinNames[] = {
+    // libc
+    "abort",
+    "exit",
+    "_exit",
+    "_Exit",
+    "quick_exit",
+    "__assert_fail",
+    "__assert_perror_fail",
+    "__assert",
+    "__assert_func",
+    "__stack_chk_fail",
+    "__stack_chk_fail_local",
+    "__chk_fail",
+    "__fortify_fail",
+    "__libc_fatal",
+    "__libc_start_main",
+    "longjmp",
+    "_longjmp",
+    "siglongjmp",
+    "__longjmp_chk",
+    "pthread_exit",
+    "thrd_exit",
+    "err",
+    "errx",
+    "verr",
+    "verrx",
+    // libgcc and libstdc++
+    "_Unwind_Resume",
+    "__cxa_throw",
+    "__cxa_rethrow",
+    "__cxa_bad_cast",
+    "__cxa_bad_typeid",
+    "__cxa_pure_virtual",
+    "__cxa_deleted_virtual",
+    "__cxa_call_unexpected",
+    "_ZSt9terminatev",
+    "_ZSt10unexpectedv",
+    "_ZSt17__throw_bad_allocv",
+    "_ZSt16__throw_bad_castv",
+    "_ZSt19__throw_logic_errorPKc",
+    "_ZSt20__throw_length_errorPKc",
+    "_ZSt20__throw_out_of_rangePKc",
+    "_ZSt24__throw_out_of_range_fmtPKcz",
+    "_ZSt21__throw_runtime_errorPKc",
+    "_ZSt25__throw_bad_function_callv",
+    "_ZN9__gnu_cxx27__verbose_terminate_handlerEv",
+    // RTOS
+    "vTaskStartScheduler",
+    "prvPortStartFirstTask",
+    "vPortStartFirstTask",
+    "tx_kernel_enter",
+    "_tx_thread_schedule",
+    "z_cstart",
+    "z_fatal_error",
+    "arch_system_halt",
+    "sys_reboot",
+    "rtems_fatal",
+    "rtems_fatal_error_occurred",
+    "_Terminate",
+    "_Internal_error",
+    "panic",
+    // vendor SDK
+    "NVIC_SystemReset",
+    "__NVIC_SystemReset",
+    "sd_nvic_SystemReset",
+    "esp_restart",
+    "esp_system_abort",
+    "Error_Handler",
+};
+
+/*
+ * FNV-1a followed by a final avalanche step. seed selects the function.
+ */
+static uint64_t hashName(const char *name, size_t length, uint32_t seed) {
+    uint64_t hash = 14695981039346656037ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<uint8_t>(name[i]);
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+NoReturnDatabase::NoReturnDatabase() {
+}
+
+const NoReturnDatabase &NoReturnDatabase::builtin() {
+    static const NoReturnDatabase database = []() {
+        NoReturnDatabase result;
+        result.addBuiltinNames();
+        result.build();
+        return result;
+    }();
+    return database;
+}
+
+void NoReturnDatabase::add(const std::string &proc_name) {
+    m_names.push_back(proc_name);
+}
+
+void NoReturnDatabase::addBuiltinNames() {
+    for (auto name : kBuiltinNames) {
+        m_names.emplace_back(name);
+    }
+}
+
+bool NoReturnDatabase::loadFile(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        auto last = line.find_last_not_of(" \t\r");
+        m_names.push_back(line.substr(first, last - first + 1));
+    }
+    return true;
+}
+
+void NoReturnDatabase::build() {
+    std::sort(m_names.begin(), m_names.end());
+    m_names.erase(std::unique(m_names.begin(), m_names.end()), m_names.end());
+    m_seeds.clear();
+    m_slots.clear();
+    if (m_names.empty()) {
+        return;
+    }
+    // a minimal table is found quickly for the sizes expected here.
+    auto slot_count = m_names.size();
+    while (!tryBuild(slot_count)) {
+        slot_count += m_names.size() / 4 + 1;
+    }
+}
+
+/*
+ * Hash and displace: names are grouped into buckets by a first hash.
+ * Starting with the largest bucket, a seed is searched that places all
+ * names of the bucket into free slots.
+ */
+bool NoReturnDatabase::tryBuild(size_t slot_count) {
+    size_t bucket_count = (m_names.size() + 3) / 4;
+    std::vector<std::vector<uint32_t>> buckets(bucket_count);
+    for (uint32_t i = 0; i < m_names.size(); ++i) {
+        auto hash = hashName(m_names[i].c_str(), m_names[i].size(), 0);
+        buckets[hash % bucket_count].push_back(i);
+    }
+    std::vector<uint32_t> bucket_order(bucket_count);
+    for (uint32_t i = 0; i < bucket_count; ++i) {
+        bucket_order[i] = i;
+    }
+    std::stable_sort(bucket_order.begin(), bucket_order.end(),
+                     [&buckets](uint32_t a, uint32_t b) {
+                         return buckets[a].size() > buckets[b].size();
+                     });
+    m_seeds.assign(bucket_count, 0);
+    m_slots.assign(slot_count, kEmptySlot);
+    std::vector<size_t> bucket_slots;
+    for (auto bucket_idx : bucket_order) {
+        auto &bucket = buckets[bucket_idx];
+        if (bucket.empty()) {
+            break;
+        }
+        uint32_t seed = 1;
+        for (; seed < kMaxSeed; ++seed) {
+            bucket_slots.clear();
+            for (auto name_idx : bucket) {
+                auto slot = hashName(m_names[name_idx].c_str(),
+                                     m_names[name_idx].size(),
+                                     seed) % slot_count;
+                if (m_slots[slot] != kEmptySlot
+                    || std::find(bucket_slots.begin(),
+                                 bucket_slots.end(),
+                                 slot) != bucket_slots.end()) {
+                    break;
+                }
+                bucket_slots.push_back(slot);
+            }
+            if (bucket_slots.size() == bucket.size()) {
+                break;
+            }
+        }
+        if (seed == kMaxSeed) {
+            return false;
+        }
+        m_seeds[bucket_idx] = seed;
+        for (size_t i = 0; i < bucket.size(); ++i) {
+            m_slots[bucket_slots[i]] = bucket[i];
+        }
+    }
+    return true;
+}
+
+bool NoReturnDatabase::contains
+    (const char *proc_name, size_t length) const noexcept {
+    if (m_slots.empty()) {
+        return false;
+    }
+    auto bucket_idx = hashName(proc_name, length, 0) % m_seeds.size();
+    auto slot = hashName(proc_name, length, m_seeds[bucket_idx])
+        % m_slots.size();
+    auto name_idx = m_slots[slot];
+    return name_idx != kEmptySlot
+        && m_names[name_idx].size() == length
+        && std::memcmp(m_names[name_idx].c_str(), proc_name, length) == 0;
+}
+
+bool NoReturnDatabase::contains(const char *proc_name) const noexcept {
+    return contains(proc_name, std::strlen(proc_name));
+}
+
+bool NoReturnDatabase::contains(const std::string &proc_name) const noexcept {
+    return contains(proc_name.c_str(), proc_name.size());
+}
+
+size_t NoReturnDatabase::size() const noexcept {
+    return m_names.size();
+}
+}
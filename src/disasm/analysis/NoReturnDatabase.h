@@ -0,0 +1,68 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace disasm {
+
+/**
+ * NoReturnDatabase
+ * Names of procedures known to never return to their caller. Names are
+ * compiled into a perfect hash so that a lookup costs a single string
+ * comparison.
+ */
+class NoReturnDatabase {
+public:
+    /**
+     * Construct an empty database. build has to be called after adding
+     * names and before any lookup.
+     */
+    NoReturnDatabase();
+    virtual ~NoReturnDatabase() = default;
+    NoReturnDatabase(const NoReturnDatabase &src) = default;
+    NoReturnDatabase &operator=(const NoReturnDatabase &src) = default;
+    NoReturnDatabase(NoReturnDatabase &&src) = default;
+
+    /*
+     * returns a built database of well-known libc, libgcc, RTOS,
+     * and vendor SDK procedures.
+     */
+    static const NoReturnDatabase &builtin();
+
+    void add(const std::string &proc_name);
+    void addBuiltinNames();
+    /*
+     * Adds names read from file, one per line. Empty lines and lines
+     * starting with '#' are ignored. Returns false if file can't be read.
+     */
+    bool loadFile(const std::string &path);
+    /*
+     * Compiles added names into a perfect hash.
+     */
+    void build();
+
+    bool contains(const char *proc_name) const noexcept;
+    bool contains(const std::string &proc_name) const noexcept;
+    size_t size() const noexcept;
+
+private:
+    bool contains(const char *proc_name, size_t length) const noexcept;
+    bool tryBuild(size_t slot_count);
+
+private:
+    std::vector<std::string> m_names;
+    // displacement seed of each bucket
+    std::vector<uint32_t> m_seeds;
+    // index in m_names of each slot
+    std::vector<uint32_t> m_slots;
+};
+}
@@ -7,52 +7,173 @@
 // Copyright (c) 2016 University of Kaiserslautern.
 
 #include "PLTProcedureMap.h"
+#include "disasm/MemoryStats.h"
 #include <elf.h>
 #include <cassert>
+#include <cstring>
 
 namespace disasm {
 
-PLTProcedureMap::PLTProcedureMap(const elf::elf *elf_file) :
-    m_elf_file{elf_file} {
+constexpr uint32_t PLTProcedureMap::kNoStub;
+// bx pc; nop
+static const uint32_t kThumbVeneer = 0x46c04778;
+
+static uint32_t readWord(const uint8_t *code) {
+    uint32_t word;
+    std::memcpy(&word, code, sizeof(word));
+    return word;
+}
+
+/*
+ * Decodes the 12-bit modified immediate of ARM data processing instructions.
+ */
+static uint32_t decodeModifiedImmediate(uint32_t imm12) {
+    uint32_t rotation = (imm12 >> 8) * 2;
+    uint32_t value = imm12 & 0xff;
+    if (rotation == 0) {
+        return value;
+    }
+    return (value >> rotation) | (value << (32 - rotation));
+}
+
+/*
+ * Matches the PLT entries emitted by GNU ld for ARM:
+ *  [bx pc; nop]                 optional Thumb veneer
+ *  add ip, pc, #imm
+ *  add ip, ip, #imm             once or twice
+ *  ldr pc, [ip, #imm]!
+ * Returns the size of the stub and sets got_offset, or returns zero if
+ * code does not start with a known stub.
+ */
+static size_t matchPLTStub
+    (const uint8_t *code, size_t size, addr_t addr, addr_t &got_offset) {
+    const uint32_t kAddIpPc = 0xe28fc000;
+    const uint32_t kAddIpIp = 0xe28cc000;
+    const uint32_t kLdrPcIp = 0xe5bcf000;
+    size_t offset = 0;
+    if (size >= 4 && readWord(code) == kThumbVeneer) {
+        offset = 4;
+    }
+    if (size < offset + 12
+        || (readWord(code + offset) & 0xfffff000) != kAddIpPc) {
+        return 0;
+    }
+    // PC reads 8 bytes ahead in ARM state
+    uint32_t ip = static_cast<uint32_t>(addr + offset + 8)
+        + decodeModifiedImmediate(readWord(code + offset) & 0xfff);
+    offset += 4;
+    for (unsigned i = 0; i < 2 && offset + 4 < size; ++i) {
+        auto word = readWord(code + offset);
+        if ((word & 0xfffff000) != kAddIpIp) {
+            break;
+        }
+        ip += decodeModifiedImmediate(word & 0xfff);
+        offset += 4;
+    }
+    if (offset + 4 > size
+        || (readWord(code + offset) & 0xfffff000) != kLdrPcIp) {
+        return 0;
+    }
+    got_offset = ip + (readWord(code + offset) & 0xfff);
+    return offset + 4;
+}
 
+PLTProcedureMap::PLTProcedureMap(const elf::elf *elf_file) :
+    m_elf_file{elf_file},
+    m_noreturn_db{&NoReturnDatabase::builtin()},
+    m_parser_initialized{false},
+    m_start_plt_code_ptr{nullptr},
+    m_start_plt_addr{0},
+    m_end_plt_addr{0} {
+    SPEDI_MEMORY_OWNER(kPLTMap);
     std::vector<const char *> dyn_func_names;
     // ELF standard: sections and segments have no specified order
-    for (const auto &sec : m_elf_file->sections()) {
-        if (sec.get_name() == ".dynsym") {
-            auto dynsymtab = sec.as_symtab();
-            size_t len;
-            for (auto sym : dynsymtab) {
-                dyn_func_names.push_back(sym.get_name(&len));
-            }
-            break;
+    auto &dynsym_sec = m_elf_file->get_section(".dynsym");
+    if (dynsym_sec.valid()) {
+        auto dynsymtab = dynsym_sec.as_symtab();
+        size_t len;
+        for (auto sym : dynsymtab) {
+            dyn_func_names.push_back(sym.get_name(&len));
         }
     }
+    auto &rel_plt_sec = m_elf_file->get_section(".rel.plt");
+    if (rel_plt_sec.valid()) {
+        for (const Elf32_Rel
+                 *rel_iter = static_cast<const Elf32_Rel *> (rel_plt_sec.data());
+             rel_iter < reinterpret_cast<const Elf32_Rel *>
+             (static_cast<const uint8_t *>(rel_plt_sec.data())
+                 + rel_plt_sec.size());
+             ++rel_iter) {
+            auto func_name = dyn_func_names[ELF32_M_SYM(rel_iter->r_info)];
+            m_got_proc_name_map.insert({rel_iter->r_offset, func_name});
+        }
+    }
+    auto &plt_sec = m_elf_file->get_section(".plt");
+    if (plt_sec.valid()) {
+        m_start_plt_addr = plt_sec.get_hdr().addr;
+        m_start_plt_code_ptr = static_cast<const uint8_t *>(plt_sec.data());
+        m_end_plt_addr = m_start_plt_addr + plt_sec.get_hdr().size;
+        buildStubTable(plt_sec);
+    }
+}
 
-    for (const auto &sec : m_elf_file->sections()) {
-        if (sec.get_name() == ".rel.plt") {
-            for (const Elf32_Rel
-                     *rel_iter = static_cast<const Elf32_Rel *> (sec.data());
-                 rel_iter < reinterpret_cast<const Elf32_Rel *>
-                 (static_cast<const uint8_t *>(sec.data()) + sec.size());
-                 ++rel_iter) {
-                auto func_name = dyn_func_names[ELF32_M_SYM(rel_iter->r_info)];
-                m_got_proc_name_map.insert({rel_iter->r_offset, func_name});
+void PLTProcedureMap::buildStubTable(const elf::section &plt_sec) {
+    m_stub_of_word.assign((m_end_plt_addr - m_start_plt_addr) / 4, kNoStub);
+    // stub encodings are matched in little endian only
+    if (m_elf_file->get_hdr().ei_data != elf::elfdata::lsb) {
+        return;
+    }
+    size_t plt_size = plt_sec.get_hdr().size;
+    // skipping the PLT header and unknown stubs one word at a time.
+    for (size_t offset = 0; offset + 4 <= plt_size;) {
+        addr_t got_offset;
+        auto stub_size = matchPLTStub(m_start_plt_code_ptr + offset,
+                                      plt_size - offset,
+                                      m_start_plt_addr + offset,
+                                      got_offset);
+        if (stub_size == 0) {
+            offset += 4;
+            continue;
+        }
+        auto res_got_name = m_got_proc_name_map.find(got_offset);
+        if (res_got_name != m_got_proc_name_map.end()) {
+            auto stub_idx = static_cast<uint32_t>(m_stubs.size());
+            m_stubs.push_back
+                ({got_offset,
+                  (*res_got_name).second,
+                  isNonReturnProcedure((*res_got_name).second)});
+            // Thumb callers enter at the veneer, ARM callers after it.
+            m_stub_of_word[offset / 4] = stub_idx;
+            if (readWord(m_start_plt_code_ptr + offset) == kThumbVeneer) {
+                m_stub_of_word[offset / 4 + 1] = stub_idx;
             }
-            break;
         }
+        offset += stub_size;
     }
-    for (const auto &sec : m_elf_file->sections()) {
-        if (sec.get_name() == ".plt") {
-            m_start_plt_addr = sec.get_hdr().addr;
-            m_start_plt_code_ptr = static_cast<const uint8_t *>(sec.data());
-            m_end_plt_addr = m_start_plt_addr + sec.get_hdr().size;
-            m_parser.initialize(CS_ARCH_ARM, CS_MODE_ARM, m_end_plt_addr);
-            break;
-        }
+}
+
+const PLTProcedureMap::PLTStub *PLTProcedureMap::findStub
+    (addr_t proc_entry_addr) const noexcept {
+    if (!isWithinPLTSection(proc_entry_addr)
+        || (proc_entry_addr - m_start_plt_addr) % 4 != 0) {
+        return nullptr;
     }
+    auto stub_idx = m_stub_of_word[(proc_entry_addr - m_start_plt_addr) / 4];
+    if (stub_idx == kNoStub) {
+        return nullptr;
+    }
+    return &m_stubs[stub_idx];
+}
+
+size_t PLTProcedureMap::stubCount() const noexcept {
+    return m_stubs.size();
 }
 
 const char *PLTProcedureMap::getName(addr_t proc_entry_addr) const noexcept {
+    auto stub = findStub(proc_entry_addr);
+    if (stub != nullptr) {
+        return stub->m_name;
+    }
     auto res_find_entry = m_addr_got_map.find(proc_entry_addr);
     if (res_find_entry != m_addr_got_map.end()) {
         auto res_find_proc_name =
@@ -64,7 +185,12 @@ const char *PLTProcedureMap::getName(addr_t proc_entry_addr) const noexcept {
 
 std::pair<const char *, bool> PLTProcedureMap::addProcedure
     (addr_t proc_entry_addr) noexcept {
-    // first check if procedure is already found
+    SPEDI_MEMORY_OWNER(kPLTMap);
+    auto stub = findStub(proc_entry_addr);
+    if (stub != nullptr) {
+        return {stub->m_name, stub->m_non_return};
+    }
+    // otherwise, check if procedure was already decoded
     auto res_addr_got_return = m_addr_got_map.find(proc_entry_addr);
     if (res_addr_got_return != m_addr_got_map.end()) {
         auto res_got_name =
@@ -81,6 +207,10 @@ std::pair<const char *, bool> PLTProcedureMap::addProcedure
 }
 
 bool PLTProcedureMap::isNonReturnProcedure(addr_t proc_entry_addr) noexcept {
+    auto stub = findStub(proc_entry_addr);
+    if (stub != nullptr) {
+        return stub->m_non_return;
+    }
     auto res_find_entry = m_addr_got_map.find(proc_entry_addr);
     if (res_find_entry != m_addr_got_map.end()) {
         return (*res_find_entry).second.second;
@@ -89,26 +219,30 @@ bool PLTProcedureMap::isNonReturnProcedure(addr_t proc_entry_addr) noexcept {
 }
 
 bool PLTProcedureMap::isNonReturnProcedure(const char *proc_name) const noexcept {
-    // compares procedure name with well-known non-returning procedures
-    if (strcmp(proc_name, "__assert_fail") == 0) {
-        return true;
-    }
-    if (strcmp(proc_name, "__stack_chk_fail") == 0) {
-        return true;
-    }
-    if (strcmp(proc_name, "_exit") == 0) {
-        return true;
-    }
-    if (strcmp(proc_name, "abort") == 0) {
-        return true;
+    return m_noreturn_db->contains(proc_name);
+}
+
+void PLTProcedureMap::setNoReturnDatabase
+    (const NoReturnDatabase *noreturn_db) noexcept {
+    m_noreturn_db = noreturn_db;
+    for (auto &stub : m_stubs) {
+        stub.m_non_return = isNonReturnProcedure(stub.m_name);
     }
-    if (strcmp(proc_name, "exit") == 0) {
-        return true;
+    for (auto &addr_got_pair : m_addr_got_map) {
+        auto res_got_name =
+            m_got_proc_name_map.find(addr_got_pair.second.first);
+        if (res_got_name != m_got_proc_name_map.end()) {
+            addr_got_pair.second.second =
+                isNonReturnProcedure((*res_got_name).second);
+        }
     }
-    return false;
 }
 
 addr_t PLTProcedureMap::calculateGotOffset(addr_t proc_entry_addr) const noexcept {
+    if (!m_parser_initialized) {
+        m_parser.initialize(CS_ARCH_ARM, CS_MODE_ARM, m_end_plt_addr);
+        m_parser_initialized = true;
+    }
     const uint8_t *code_ptr =
         m_start_plt_code_ptr - m_start_plt_addr + proc_entry_addr;
     cs_insn inst;
@@ -11,13 +11,17 @@
 #include "binutils/elf/elf++.hh"
 #include "disasm/common.h"
 #include "disasm/MCParser.h"
+#include "NoReturnDatabase.h"
 #include <unordered_map>
+#include <vector>
 
 namespace disasm {
 /**
  * PLTProcedureMap
  * Provides mapping between .got offsets, procedure names,
- * and procedure addresses.
+ * and procedure addresses. Stubs of .plt are matched against known
+ * encodings once on construction. Stubs that are not recognized are decoded
+ * on demand.
  */
 class PLTProcedureMap {
 public:
@@ -40,11 +44,37 @@ public:
     addr_t calculateGotOffset(addr_t proc_entry_addr) const noexcept;
     bool valid() const { return m_elf_file->valid(); }
     bool isWithinPLTSection(addr_t addr) const noexcept;
+    /*
+     * Procedures found in noreturn_db are non-returning. Defaults to the
+     * builtin database.
+     * precondition: noreturn_db outlives this map.
+     */
+    void setNoReturnDatabase(const NoReturnDatabase *noreturn_db) noexcept;
+    /*
+     * returns number of stubs recognized on construction.
+     */
+    size_t stubCount() const noexcept;
+
+private:
+    struct PLTStub {
+        addr_t m_got_offset;
+        const char *m_name;
+        bool m_non_return;
+    };
+    static constexpr uint32_t kNoStub = ~0U;
+    void buildStubTable(const elf::section &plt_sec);
+    const PLTStub *findStub(addr_t proc_entry_addr) const noexcept;
+
 private:
     const elf::elf *m_elf_file;
+    const NoReturnDatabase *m_noreturn_db;
     std::unordered_map<addr_t, const char *> m_got_proc_name_map;
     std::unordered_map<addr_t, std::pair<addr_t, bool>> m_addr_got_map;
-    MCParser m_parser;
+    std::vector<PLTStub> m_stubs;
+    // index of stub entered at each word of .plt
+    std::vector<uint32_t> m_stub_of_word;
+    mutable MCParser m_parser;
+    mutable bool m_parser_initialized;
     const uint8_t *m_start_plt_code_ptr;
     addr_t m_start_plt_addr;
     addr_t m_end_plt_addr;
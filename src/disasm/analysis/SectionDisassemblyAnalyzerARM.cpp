@@ -11,8 +11,10 @@
 #include <iostream>
 #include <algorithm>
 #include <cassert>
-#include <disasm/MCParser.h>
-#include <disasm/RawInstWrapper.h>
+#include <disasm/ITBlockState.h>
+#include <disasm/DwarfIndex.h>
+#include <disasm/Progress.h>
+#include <disasm/Stats.h>
 #include <deque>
 
 namespace disasm {
@@ -23,21 +25,14 @@ SectionDisassemblyAnalyzerARM::SectionDisassemblyAnalyzerARM
     m_sec_disasm{sec_disasm},
     m_analyzer{sec_disasm->getISA()},
     m_call_graph{sec_disasm->secStartAddr(), sec_disasm->secEndAddr()},
-    m_plt_map{elf_file} {
-    addr_t start_addr = UINT64_MAX;
-    addr_t end_addr = 0;
-    for (auto &sec : m_elf_file->sections()) {
-        if (sec.is_alloc() && sec.is_exec()) {
-            if (sec.get_hdr().addr < start_addr) {
-                start_addr = sec.get_hdr().addr;
-            }
-            if (end_addr < sec.get_hdr().addr + sec.get_hdr().size) {
-                end_addr = sec.get_hdr().addr + sec.get_hdr().size;
-            }
-        }
-    }
-    m_exec_addr_start = start_addr;
-    m_exec_addr_end = end_addr;
+    m_plt_map{elf_file},
+    m_dwarf_index{nullptr},
+    m_noreturn_db{&NoReturnDatabase::builtin()},
+    m_budget{nullptr},
+    m_status{AnalysisStatus::kComplete} {
+    auto exec_range = m_elf_file->executable_range();
+    m_exec_addr_start = exec_range.first;
+    m_exec_addr_end = exec_range.second;
 }
 
 size_t SectionDisassemblyAnalyzerARM::calculateBasicBlockWeight
@@ -71,12 +66,17 @@ size_t SectionDisassemblyAnalyzerARM::calculateNodeWeight
 }
 
 void SectionDisassemblyAnalyzerARM::buildCFG() {
+    SPEDI_PHASE(kBuildCFG);
+    SPEDI_MEMORY_OWNER(kCFG);
+    ScopedAnalysisBudget budget_scope{m_budget};
     if (m_sec_disasm->maximalBlockCount() == 0) {
         return;
     }
     // work directly with the vector of CFGNode
     auto &cfg = m_sec_cfg.m_cfg;
     cfg.resize(m_sec_disasm->maximalBlockCount());
+    // nodes are visited in two passes
+    ScopedProgressPhase progress{StatsPhase::kBuildCFG, 2 * cfg.size()};
     {
         MaximalBlock *first_maximal_block =
             &(*m_sec_disasm->getMaximalBlocks().begin());
@@ -85,7 +85,8 @@ void SectionDisassemblyAnalyzerARM::buildCFG() {
         if (first_maximal_block->branchInfo().isDirect()
             && !isValidCodeAddr(first_maximal_block->branchInfo().target())) {
             // a branch to an address outside of executable code
-            cfg.front().setToDataAndInvalidatePredecessors();
+            cfg.front().setToDataAndInvalidatePredecessors
+                (TraceDataReason::kBranchOutsideCode);
         }
     }
     {
@@ -97,10 +98,12 @@ void SectionDisassemblyAnalyzerARM::buildCFG() {
              ++block_iter, ++node_iter) {
 
             (*node_iter).setMaximalBlock(&(*block_iter));
+            Progress::setPhaseDone(node_iter - cfg.begin());
             if ((*block_iter).branchInfo().isDirect()
                 && !isValidCodeAddr((*block_iter).branchInfo().target())) {
                 // a branch to an address outside of executable code
-                (*node_iter).setToDataAndInvalidatePredecessors();
+                (*node_iter).setToDataAndInvalidatePredecessors
+                    (TraceDataReason::kBranchOutsideCode);
                 continue;
             }
             auto rev_cfg_node_iter = (node_iter) - 1;
@@ -122,6 +125,11 @@ void SectionDisassemblyAnalyzerARM::buildCFG() {
     // second pass for setting successors and predecessors to each CFGNode
     for (auto node_iter = cfg.begin();
          node_iter < cfg.end(); ++node_iter) {
+        Progress::setPhaseDone(cfg.size() + (node_iter - cfg.begin()));
+        // nodes are complete after the first pass, edges can be missing
+        if (isStopped()) {
+            break;
+        }
         if ((*node_iter).isData()) {
             continue;
         }
@@ -142,7 +150,8 @@ void SectionDisassemblyAnalyzerARM::buildCFG() {
 //                        << " Points to: " << (*succ).id() << "\n";
             } else {
                 // a direct branch that doesn't target an MB is data
-                (*node_iter).setToDataAndInvalidatePredecessors();
+                (*node_iter).setToDataAndInvalidatePredecessors
+                    (TraceDataReason::kBranchToNoNode);
             }
         }
     }
@@ -224,46 +233,51 @@ const DisassemblyCFG &SectionDisassemblyAnalyzerARM::getCFG() const noexcept {
     return m_sec_cfg;
 }
 
+const DisassemblyCallGraph &
+SectionDisassemblyAnalyzerARM::getCallGraph() const noexcept {
+    return m_call_graph;
+}
+
 void SectionDisassemblyAnalyzerARM::refineCFG() {
     if (!m_sec_cfg.isValid()) {
         return;
     }
-    // variables related to fixing IT block
-    MCParser parser;
-    parser.initialize(CS_ARCH_ARM, CS_MODE_THUMB, m_sec_disasm->secEndAddr());
-    addr_t it_block_size = 0;
+    SPEDI_PHASE(kRefineCFG);
+    SPEDI_MEMORY_OWNER(kCFG);
+    ScopedAnalysisBudget budget_scope{m_budget};
+    refineNodes();
+    recoverSwitchStatements();
+    identifyPCRelativeLoadData();
+}
+
+void SectionDisassemblyAnalyzerARM::refineNodes() {
+    SPEDI_PHASE(kRefineNodes);
+    ScopedAnalysisBudget budget_scope{m_budget};
+    ScopedProgressPhase progress{StatsPhase::kRefineNodes,
+                                 m_sec_cfg.m_cfg.size()};
+    // Instructions following an invalid IT were speculatively decoded with
+    // IT conditions. Their conditions are overridden lazily instead of
+    // re-decoding them. An invalid IT block can span multiple MBs.
+    unsigned it_block_size = 0;
     addr_t it_block_addr = 0;
-    const uint8_t *it_block_ptr = nullptr;
 
     for (auto node_iter = m_sec_cfg.m_cfg.begin();
          node_iter < m_sec_cfg.m_cfg.end(); ++node_iter) {
+        Progress::setPhaseDone(node_iter - m_sec_cfg.m_cfg.begin());
+        if (isStopped()) {
+            break;
+        }
         if ((*node_iter).isData())
             continue;
         resolveSpaceOverlap(*node_iter);
         if ((*node_iter).isData())
             continue;
         auto &node = (*node_iter);
+        auto &insts = node.maximalBlockPtr()->getInstructionsRef();
         if (it_block_size > 0) {
             // Fix invalid IT found in a previous MB.
-            // XXX: copy'n'paste code, consider refactoring
-            RawInstWrapper inst;
-            size_t dummy_size = 20;
-            for (auto inst_iter =
-                node.maximalBlockPtr()->getInstructionsRef().begin();
-                 inst_iter
-                     < node.maximalBlockPtr()->getInstructionsRef().end()
-                     && it_block_size > 0;
-                 ++inst_iter) {
-                if ((*inst_iter).addr() != it_block_addr) continue;
-                parser.disasm2(&it_block_ptr, &dummy_size, &it_block_addr, inst.rawPtr());
-                (*inst_iter).setMnemonic(inst.rawPtr()->mnemonic);
-                (*inst_iter).setDetail(*inst.rawPtr()->detail);
-                --it_block_size;
-            }
-            bool is_conditional =
-                node.maximalBlock()->branchInstruction()->condition()
-                    != ARM_CC_AL;
-            node.maximalBlockPtr()->setBranchCondition(is_conditional);
+            resetITBlockConditions
+                (node, insts.begin(), it_block_size, it_block_addr);
         }
         addCallReturnRelation(*node_iter);
         if (!node.isCandidateStartAddressSet()) {
@@ -271,65 +285,61 @@ void SectionDisassemblyAnalyzerARM::refineCFG() {
         }
         // Fix insts errors caused by invalid IT
         addr_t current = node.getCandidateStartAddr();
-        for (auto inst_iter =
-            node.maximalBlockPtr()->getInstructionsRef().begin();
-             inst_iter < node.maximalBlockPtr()->getInstructionsRef().end();
-             ++inst_iter) {
+        auto inst_iter = insts.begin();
+        while (inst_iter < insts.end()) {
             if ((*inst_iter).addr() == current) {
                 current += (*inst_iter).size();
-            } else {
-                if ((*inst_iter).id() == ARM_INS_IT) {
-                    RawInstWrapper inst;
-                    it_block_addr = (*inst_iter).addr() + 2;
-                    it_block_ptr = m_sec_disasm->physicalAddrOf(it_block_addr);
-                    // XXX workaround Capstone's behavior which does allow
-                    // to control it_state stored in cs_handle.
-//#define RESET_IT "\xe8\xbf" //it al
-//                    parser.disasm((unsigned char *)RESET_IT,
-//                                  2,
-//                                  0,
-//                                  inst.rawPtr());
-                    if (it_block_size > 0) {
-                        it_block_size = 7;
-                    } else {
-                        it_block_size = (*inst_iter).mnemonic().length() - 1;
-                    }
-                    size_t dummy_size = 20;
-                    ++inst_iter;
-                    for (;
-                        inst_iter
-                            < node.maximalBlockPtr()->getInstructionsRef().end()
-                            && it_block_size > 0;
-                        ++inst_iter) {
-                        if ((*inst_iter).addr() != it_block_addr) continue;
-                        parser.disasm2(&it_block_ptr,
-                                      &dummy_size,
-                                      &it_block_addr,
-                                      inst.rawPtr());
-                        (*inst_iter).setMnemonic(inst.rawPtr()->mnemonic);
-                        (*inst_iter).setDetail(*inst.rawPtr()->detail);
-                        --it_block_size;
-                    }
-                    bool is_conditional =
-                        node.maximalBlock()->branchInstruction()->condition()
-                            != ARM_CC_AL;
-                    node.maximalBlockPtr()->setBranchCondition(is_conditional);
-                    current = it_block_addr;
-                }
+                ++inst_iter;
+                continue;
+            }
+            if ((*inst_iter).id() != ARM_INS_IT) {
+                ++inst_iter;
+                continue;
             }
+            // an invalid IT nested in another invalid IT block extends
+            // the range of affected instructions.
+            it_block_size += ITBlockState
+                (*reinterpret_cast<const uint16_t *>
+                (m_sec_disasm->physicalAddrOf((*inst_iter).addr())))
+                .remainingCount();
+            it_block_addr = (*inst_iter).addr() + 2;
+            inst_iter = resetITBlockConditions
+                (node, inst_iter + 1, it_block_size, it_block_addr);
+            current = it_block_addr;
         }
         addConditionalBranchToCFG(node);
         // find maximally valid BB and resolves conflicts between MBs
 //        resolveValidBasicBlock((*node_iter));
     }
-    recoverSwitchStatements();
-    identifyPCRelativeLoadData();
+}
+
+std::vector<MCInst>::iterator
+SectionDisassemblyAnalyzerARM::resetITBlockConditions
+    (CFGNode &node,
+     std::vector<MCInst>::iterator inst_iter,
+     unsigned &it_block_size,
+     addr_t &it_block_addr) noexcept {
+    auto &insts = node.maximalBlockPtr()->getInstructionsRef();
+    for (; inst_iter < insts.end() && it_block_size > 0; ++inst_iter) {
+        if ((*inst_iter).addr() != it_block_addr) continue;
+        // The IT instruction is not valid, hence instructions it covers
+        // keep the condition of their own encoding, e.g., b<cond>.
+        (*inst_iter).clearITCondition();
+        it_block_addr += (*inst_iter).size();
+        --it_block_size;
+    }
+    bool is_conditional =
+        node.maximalBlock()->branchInstruction()->condition() != ARM_CC_AL;
+    node.maximalBlockPtr()->setBranchCondition(is_conditional);
+    return inst_iter;
 }
 
 void SectionDisassemblyAnalyzerARM::resolveSpaceOverlap(CFGNode &node) {
     if (!node.hasOverlapWithOtherNode() || node.getOverlapNode()->isData()) {
         return;
     }
+    SPEDI_COUNT(kOverlapsResolved, 1);
+    auto outcome = TraceOverlapOutcome::kKept;
     // resolve overlap between MBs by shrinking the next or converting this to data
     if (node.getOverlapNode()->maximalBlock()->
         coversAddressSpaceOf(node.maximalBlock())) {
@@ -340,10 +350,13 @@ void SectionDisassemblyAnalyzerARM::resolveSpaceOverlap(CFGNode &node) {
                 // TODO: alignment should be revisted!!
                 // XXX: heuristic applied when this node aligns with previous
                 // what if next is one instruction?
+                outcome = TraceOverlapOutcome::kShrinkOverlap;
                 node.getOverlapNodePtr()->
                     setCandidateStartAddr(node.maximalBlock()->endAddr());
             } else {
-                node.setToDataAndInvalidatePredecessors();
+                outcome = TraceOverlapOutcome::kNodeToData;
+                node.setToDataAndInvalidatePredecessors
+                    (TraceDataReason::kOverlapLighter);
             }
         }
     } else {
@@ -353,19 +366,29 @@ void SectionDisassemblyAnalyzerARM::resolveSpaceOverlap(CFGNode &node) {
                 node.getOverlapNodePtr()->getOverlapNodePtr();
             if (nested_overlap != nullptr
                 && node.isAppendableBy(nested_overlap)) {
-                node.getOverlapNodePtr()->setToDataAndInvalidatePredecessors();
+                outcome = TraceOverlapOutcome::kOverlapToData;
+                node.getOverlapNodePtr()->setToDataAndInvalidatePredecessors
+                    (TraceDataReason::kOverlapNested);
             } else {
+                outcome = TraceOverlapOutcome::kShrinkOverlap;
                 node.getOverlapNodePtr()->
                     setCandidateStartAddr(node.maximalBlock()->endAddr());
             }
         } else if (calculateNodeWeight(&node) <
             calculateNodeWeight(node.getOverlapNode())) {
-            node.setToDataAndInvalidatePredecessors();
+            outcome = TraceOverlapOutcome::kNodeToData;
+            node.setToDataAndInvalidatePredecessors
+                (TraceDataReason::kOverlapLighter);
         } else {
             // overlapping node consists of only one instruction?
-            node.getOverlapNodePtr()->setToDataAndInvalidatePredecessors();
+            outcome = TraceOverlapOutcome::kOverlapToData;
+            node.getOverlapNodePtr()->setToDataAndInvalidatePredecessors
+                (TraceDataReason::kOverlapSingleInst);
         }
     }
+    SPEDI_DECISION(kOverlap, outcome, node.id(),
+                   node.maximalBlock()->addrOfFirstInst(),
+                   node.getOverlapNode()->id());
 }
 
 void SectionDisassemblyAnalyzerARM::resolveValidBasicBlock(CFGNode &node) {
@@ -396,9 +419,12 @@ void SectionDisassemblyAnalyzerARM::resolveValidBasicBlock(CFGNode &node) {
                             m_sec_cfg.ptrToNodeAt(node.id() - 1);
                         if (calculateNodeWeight((*pred_iter).node()) <
                             calculateNodeWeight(overlap_pred)) {
-                            (*pred_iter).node()->setToDataAndInvalidatePredecessors();
+                            (*pred_iter).node()->
+                                setToDataAndInvalidatePredecessors
+                                (TraceDataReason::kConflictingPredecessor);
                         } else {
-                            overlap_pred->setToDataAndInvalidatePredecessors();
+                            overlap_pred->setToDataAndInvalidatePredecessors
+                                (TraceDataReason::kConflictingPredecessor);
                         }
                     }
                     target_count++;
@@ -461,14 +487,23 @@ void SectionDisassemblyAnalyzerARM::resolveCFGConflicts
          pred_iter < valid_predecessors.cend(); ++pred_iter, ++j) {
         if (assigned_predecessors[j] != valid_bb_idx) {
             // set predecessor to data
-            (*pred_iter).node()->setToDataAndInvalidatePredecessors();
+            (*pred_iter).node()->setToDataAndInvalidatePredecessors
+                (TraceDataReason::kConflictingPredecessor);
         }
     }
 }
 
 void SectionDisassemblyAnalyzerARM::identifyPCRelativeLoadData() {
+    SPEDI_PHASE(kIdentifyPCRelativeLoadData);
+    ScopedAnalysisBudget budget_scope{m_budget};
+    ScopedProgressPhase progress{StatsPhase::kIdentifyPCRelativeLoadData,
+                                 m_sec_cfg.m_cfg.size()};
     std::deque<addr_t> data_word_addrs;
     for (auto &node : m_sec_cfg.m_cfg) {
+        Progress::setPhaseDone(&node - &m_sec_cfg.m_cfg.front());
+        if (isStopped()) {
+            break;
+        }
         if (node.getType() == CFGNodeType::kData) {
             continue;
         }
@@ -482,7 +517,8 @@ void SectionDisassemblyAnalyzerARM::identifyPCRelativeLoadData() {
                 if (wordAddr < node.maximalBlock()->addrOfLastInst()) {
                     node.setCandidateStartAddr(wordAddr + 4);
                 } else {
-                    node.setToDataAndInvalidatePredecessors();
+                    node.setToDataAndInvalidatePredecessors
+                        (TraceDataReason::kPCRelativeLoad);
                 }
             }
         }
@@ -525,9 +561,17 @@ void SectionDisassemblyAnalyzerARM::identifyPCRelativeLoadData() {
 }
 
 void SectionDisassemblyAnalyzerARM::recoverSwitchStatements() {
+    SPEDI_PHASE(kRecoverSwitchStatements);
+    ScopedAnalysisBudget budget_scope{m_budget};
+    ScopedProgressPhase progress{StatsPhase::kRecoverSwitchStatements,
+                                 m_sec_cfg.m_cfg.size()};
     std::vector<SectionDisassemblyAnalyzerARM::SwitchTableData> sw_data_vec;
     for (auto node_iter = m_sec_cfg.m_cfg.begin();
          node_iter < m_sec_cfg.m_cfg.end(); ++node_iter) {
+        Progress::setPhaseDone(node_iter - m_sec_cfg.m_cfg.begin());
+        if (isStopped()) {
+            break;
+        }
         if ((*node_iter).isData() || isNotSwitchStatement(*node_iter))
             continue;
         if ((*node_iter).maximalBlock()->
@@ -544,8 +588,13 @@ void SectionDisassemblyAnalyzerARM::recoverSwitchStatements() {
         }
     }
     for (auto &table_data : sw_data_vec) {
+        SPEDI_DECISION(kSwitchTable, table_data.m_table_type,
+                       table_data.m_node->id(),
+                       table_data.m_node->maximalBlock()->addrOfFirstInst(),
+                       table_data.m_table_end);
         switchTableCleanUp(table_data);
     }
+    SPEDI_COUNT(kSwitchTables, sw_data_vec.size());
 }
 
 bool SectionDisassemblyAnalyzerARM::isNotSwitchStatement
@@ -575,7 +624,8 @@ void SectionDisassemblyAnalyzerARM::addConditionalBranchToCFG(CFGNode &node) {
             (&node, node.maximalBlock()->endAddr());
     } else {
         // a conditional branch without a direct successor is data
-        node.setToDataAndInvalidatePredecessors();
+        node.setToDataAndInvalidatePredecessors
+            (TraceDataReason::kConditionalWithoutSuccessor);
     }
 }
 
@@ -603,7 +653,7 @@ bool SectionDisassemblyAnalyzerARM::isConditionalBranchAffectedByNodeOverlap
                 else
                     return false;
             }
-            if ((*inst_iter).detail().arm.cc == ARM_CC_AL) {
+            if ((*inst_iter).condition() == ARM_CC_AL) {
                 return false;
             }
         }
@@ -730,6 +780,9 @@ void SectionDisassemblyAnalyzerARM::switchTableCleanUp
         }
         auto min_addr = (*node_iter).getMinTargetAddrOfValidPredecessor();
         if (min_addr == 0) {
+            SPEDI_DECISION(kNodeToData, TraceDataReason::kSwitchTableCleanUp,
+                           (*node_iter).id(),
+                           (*node_iter).maximalBlock()->addrOfFirstInst(), 0);
             (*node_iter).setType(CFGNodeType::kData);
 //            printf("Switch clean up at table_data %lu invalidating table_data %lu\n",
 //                   table_data.id(), (*node_iter).id());
@@ -810,25 +863,52 @@ addr_t SectionDisassemblyAnalyzerARM::validateProcedure(const ICFGNode &proc) no
 }
 
 void SectionDisassemblyAnalyzerARM::buildCallGraph() {
+    SPEDI_PHASE(kBuildCallGraph);
+    SPEDI_MEMORY_OWNER(kCallGraph);
+    ScopedAnalysisBudget budget_scope{m_budget};
+    // only the final pass over nodes reports units done
+    ScopedProgressPhase progress{StatsPhase::kBuildCallGraph,
+                                 m_sec_cfg.m_cfg.size()};
     // a procedure holds an average of 20 basic blocks!
     m_call_graph.reserve(m_sec_cfg.m_cfg.size() / 20);
     // recover a map of target addresses and direct call sites
     recoverDirectCalledProcedures();
+    if (m_dwarf_index != nullptr) {
+        recoverDebugInfoProcedures();
+    }
     // Initial call graph where every directly reachable procedure is identified
     //  together with its overestimated address space
     auto &untraversed_procedures = m_call_graph.buildInitialCallGraph();
+    markKnownNonReturnProcedures(untraversed_procedures);
     // building directly called procedures.
+    std::vector<CFGNode *> fixed_calls;
+    std::vector<CFGNode *> stale_calls;
     for (auto &proc : untraversed_procedures) {
+        if (isStopped()) {
+            break;
+        }
         buildProcedure(proc);
-        m_call_graph.checkNonReturnProcedureAndFixCallers(proc);
+        fixed_calls.clear();
+        m_call_graph.checkNonReturnProcedureAndFixCallers(proc, fixed_calls);
+        // callers in procedures built so far fell through the call.
+        for (auto call_node : fixed_calls) {
+            auto caller = findMainProcedure(*call_node);
+            if (caller != nullptr && caller->entryAddr() <= proc.entryAddr()) {
+                stale_calls.push_back(call_node);
+            }
+        }
     }
+    propagateNonReturnProcedures(stale_calls);
     // a pass to identify all remaining procedures.
     // these are either tail-called, indirectly called, or not called at all.
     auto proc_iter = m_call_graph.m_main_procs.begin();
     for (auto node_iter = m_sec_cfg.m_cfg.begin();
          node_iter < m_sec_cfg.m_cfg.end();
          ++node_iter) {
-
+        Progress::setPhaseDone(node_iter - m_sec_cfg.m_cfg.begin());
+        if (isStopped()) {
+            break;
+        }
         if (proc_iter < m_call_graph.m_main_procs.end()
             && ((*proc_iter).estimatedEndAddr()
                 <= (*node_iter).getCandidateStartAddr())) {
@@ -852,6 +932,7 @@ void SectionDisassemblyAnalyzerARM::buildCallGraph() {
         }
     }
     m_call_graph.buildCallGraph();
+    SPEDI_COUNT(kProcedures, m_call_graph.m_main_procs.size());
     // TODO: an entry node with two different entry addresses should be split to
     // two procedures.
     // TODO: a final pass over all procedures to (1) properly classify
@@ -904,6 +985,9 @@ void SectionDisassemblyAnalyzerARM::traverseProcedureNode
      CFGNode *cfg_node,
      CFGNode *predecessor) noexcept {
 
+    if (isStopped()) {
+        return;
+    }
     if (cfg_node == nullptr) {
         // branch to an external procedure
         if (!predecessor->isCall()) {
@@ -1037,6 +1121,185 @@ void SectionDisassemblyAnalyzerARM::recoverDirectCalledProcedures() noexcept {
     }
 }
 
+void SectionDisassemblyAnalyzerARM::setDebugInfo
+    (const DwarfIndex *dwarf_index) noexcept {
+    m_dwarf_index = dwarf_index;
+}
+
+void SectionDisassemblyAnalyzerARM::setBudget
+    (AnalysisBudget *budget) noexcept {
+    m_budget = budget;
+}
+
+AnalysisStatus SectionDisassemblyAnalyzerARM::status() const noexcept {
+    return m_status;
+}
+
+bool SectionDisassemblyAnalyzerARM::isStopped() noexcept {
+    if (m_status != AnalysisStatus::kComplete) {
+        return true;
+    }
+    if (AnalysisBudget::shouldStop()) {
+        m_status = AnalysisBudget::current()->status();
+        return true;
+    }
+    return false;
+}
+
+void SectionDisassemblyAnalyzerARM::setNoReturnDatabase
+    (const NoReturnDatabase *noreturn_db) noexcept {
+    m_noreturn_db = noreturn_db;
+    m_plt_map.setNoReturnDatabase(noreturn_db);
+}
+
+void SectionDisassemblyAnalyzerARM::markKnownNonReturnProcedures
+    (std::vector<ICFGNode> &procs) noexcept {
+    // Functions named in .symtab cover local and statically linked
+    // procedures, e.g., of an RTOS, also without debug info.
+    std::vector<std::pair<addr_t, const char *>> symbol_procs;
+    try {
+        auto &sym_sec = m_elf_file->get_section(".symtab");
+        if (sym_sec.valid()) {
+            for (auto symbol : sym_sec.as_symtab()) {
+                if (symbol.get_data().type() != elf::stt::func) {
+                    continue;
+                }
+                auto name = symbol.get_name(nullptr);
+                if (m_noreturn_db->contains(name)) {
+                    // Thumb functions have their first bit set.
+                    symbol_procs.emplace_back
+                        (symbol.get_data().value & ~1ULL, name);
+                }
+            }
+        }
+    } catch (std::exception &e) {
+        // corrupted symbol table.
+        symbol_procs.clear();
+    }
+    std::sort(symbol_procs.begin(), symbol_procs.end());
+    // nothing is built yet, so callers need no rebuild.
+    std::vector<CFGNode *> fixed_calls;
+    for (auto &proc : procs) {
+        const char *name = nullptr;
+        if (m_dwarf_index != nullptr) {
+            try {
+                auto function = m_dwarf_index->findFunction(proc.entryAddr());
+                if (function != nullptr
+                    && function->m_start_addr == proc.entryAddr()
+                    && m_noreturn_db->contains(function->m_name)) {
+                    name = function->m_name.c_str();
+                }
+            } catch (std::exception &e) {
+                // malformed debug info, symbols still apply.
+            }
+        }
+        if (name == nullptr) {
+            auto iter = std::lower_bound
+                (symbol_procs.cbegin(), symbol_procs.cend(),
+                 std::make_pair(proc.entryAddr(),
+                                static_cast<const char *>(nullptr)));
+            if (iter != symbol_procs.cend()
+                && (*iter).first == proc.entryAddr()) {
+                name = (*iter).second;
+            }
+        }
+        if (name != nullptr) {
+            proc.setName(name);
+            m_call_graph.markNonReturnProcedure(proc, fixed_calls);
+        }
+    }
+}
+
+void SectionDisassemblyAnalyzerARM::propagateNonReturnProcedures
+    (std::vector<CFGNode *> &stale_calls) noexcept {
+    // a procedure is marked non-returning at most once, hence this
+    // reaches a fixpoint.
+    std::vector<ICFGNode *> stale_procs;
+    while (!stale_calls.empty() && !isStopped()) {
+        stale_procs.clear();
+        for (auto call_node : stale_calls) {
+            auto proc = findMainProcedure(*call_node);
+            if (proc != nullptr) {
+                stale_procs.push_back(proc);
+            }
+        }
+        std::sort(stale_procs.begin(), stale_procs.end());
+        stale_procs.erase(std::unique(stale_procs.begin(), stale_procs.end()),
+                          stale_procs.end());
+        stale_calls.clear();
+        for (auto proc : stale_procs) {
+            resetProcedure(*proc);
+            buildProcedure(*proc);
+            m_call_graph.checkNonReturnProcedureAndFixCallers
+                (*proc, stale_calls);
+        }
+    }
+}
+
+void SectionDisassemblyAnalyzerARM::resetProcedure
+    (ICFGNode &proc_node) noexcept {
+    auto entry_node = proc_node.entryNode();
+    for (auto node_iter =
+        std::next(m_sec_cfg.m_cfg.begin(), entry_node->id() + 1);
+         node_iter < m_sec_cfg.m_cfg.end()
+             && (*node_iter).maximalBlock()->addrOfFirstInst()
+                 < proc_node.estimatedEndAddr();
+         ++node_iter) {
+        if ((*node_iter).procedure_id() == proc_node.id()
+            && (*node_iter).roleInProcedure()
+                == CFGNodeRoleInProcedure::kBody) {
+            (*node_iter).m_procedure_id = 0;
+            (*node_iter).m_role_in_procedure = CFGNodeRoleInProcedure::kUnknown;
+        }
+    }
+    proc_node.m_exit_nodes.clear();
+    proc_node.setReturnsToCaller(false);
+    proc_node.m_lr_store_idx = 0;
+    proc_node.m_end_node = entry_node;
+    proc_node.m_end_addr = entry_node->maximalBlock()->endAddr();
+}
+
+ICFGNode *SectionDisassemblyAnalyzerARM::findMainProcedure
+    (const CFGNode &cfg_node) noexcept {
+    if (!cfg_node.isAssignedToProcedure()) {
+        return nullptr;
+    }
+    auto &procs = m_call_graph.m_main_procs;
+    auto iter = std::upper_bound
+        (procs.begin(), procs.end(), cfg_node.getCandidateStartAddr(),
+         [](addr_t addr, const ICFGNode &proc) {
+             return addr < proc.entryAddr();
+         });
+    if (iter == procs.begin()) {
+        return nullptr;
+    }
+    --iter;
+    if ((*iter).id() == cfg_node.procedure_id()
+        || (*iter).entryNode() == &cfg_node) {
+        return &(*iter);
+    }
+    return nullptr;
+}
+
+void SectionDisassemblyAnalyzerARM::recoverDebugInfoProcedures() noexcept {
+    std::vector<addr_t> entry_addrs;
+    try {
+        entry_addrs = m_dwarf_index->functionStartsWithin
+            (m_sec_disasm->windowStartAddr(), m_sec_disasm->windowEndAddr());
+    } catch (std::exception &e) {
+        return;
+    }
+    for (auto entry_addr : entry_addrs) {
+        auto entry_node = findRemoteSuccessor(entry_addr);
+        if (entry_node == nullptr || entry_node->isData()) {
+            continue;
+        }
+        // procedures that are also directly called were already added.
+        m_call_graph.AddProcedure
+            (entry_addr, entry_node, ICFGProcedureType::kIndirectlyCalled);
+    }
+}
+
 void SectionDisassemblyAnalyzerARM::addCallReturnRelation(CFGNode &node) {
     if (node.maximalBlock()->branchInfo().isCall()) {
         auto succ = findImmediateSuccessor(node);
@@ -13,11 +13,13 @@
 #include "PLTProcedureMap.h"
 #include <binutils/elf/elf++.hh>
 #include <disasm/SectionDisassemblyARM.h>
+#include <disasm/AnalysisBudget.h>
 
 namespace disasm {
 
 class SectionDisassemblyARM;
 class RawInstAnalyzer;
+class DwarfIndex;
 
 /**
  * SectionDisassemblyAnalyzerARM
@@ -36,8 +38,42 @@ public:
         (SectionDisassemblyAnalyzerARM &&src) = default;
 
     void buildCFG();
+    /*
+     * Runs refineNodes, recoverSwitchStatements, and
+     * identifyPCRelativeLoadData in this order. The phases are exposed
+     * separately to measure them, they are not meant to be reordered.
+     */
     void refineCFG();
+    /*
+     * Resolves overlaps between nodes, fixes conditions of invalid IT
+     * blocks, and adds call-return and conditional branch relations.
+     */
+    void refineNodes();
+    void recoverSwitchStatements();
+    void identifyPCRelativeLoadData();
     void buildCallGraph();
+    /*
+     * Seeds call graph with function starts found in debug info. Debug info
+     * is parsed by buildCallGraph only if an index was set.
+     */
+    void setDebugInfo(const DwarfIndex *dwarf_index) noexcept;
+    /*
+     * Procedures named in noreturn_db are non-returning. Defaults to the
+     * builtin database.
+     * precondition: noreturn_db outlives this analyzer.
+     */
+    void setNoReturnDatabase(const NoReturnDatabase *noreturn_db) noexcept;
+    /*
+     * Analysis phases stop early once budget is exhausted and later phases
+     * are skipped, leaving a partial CFG and call graph. Passing nullptr
+     * keeps the budget of the calling thread, if any.
+     * precondition: budget outlives this analyzer.
+     */
+    void setBudget(AnalysisBudget *budget) noexcept;
+    /*
+     * returns kComplete unless a phase was stopped early.
+     */
+    AnalysisStatus status() const noexcept;
     /*
      * Search in CFG to find direct successor
      */
@@ -50,6 +86,7 @@ public:
     void RefineMaximalBlocks(const std::vector<addr_t> &known_code_addrs);
     bool isValidCodeAddr(addr_t addr) const noexcept;
     const DisassemblyCFG &getCFG() const noexcept;
+    const DisassemblyCallGraph &getCallGraph() const noexcept;
 
     /*
      * returns the sum of instruction count of all predecessors in addition to
@@ -74,10 +111,18 @@ private:
     void resolveSpaceOverlap(CFGNode &node);
     void resolveCFGConflicts
         (CFGNode &node, const std::vector<CFGEdge> &valid_predecessors);
-    void recoverSwitchStatements();
-    void identifyPCRelativeLoadData();
     bool isConditionalBranchAffectedByNodeOverlap
         (const CFGNode &node) const noexcept;
+    /*
+     * Drops IT conditions of instructions covered by an invalid IT block
+     * starting from inst_iter. Returns iterator past the last instruction
+     * visited.
+     */
+    std::vector<MCInst>::iterator resetITBlockConditions
+        (CFGNode &node,
+         std::vector<MCInst>::iterator inst_iter,
+         unsigned &it_block_size,
+         addr_t &it_block_addr) noexcept;
 private:
     // switch table related methods
     /*
@@ -113,10 +158,32 @@ private:
          CFGNode *cfg_node,
          CFGNode *predecessor) noexcept;
     void recoverDirectCalledProcedures() noexcept;
+    void recoverDebugInfoProcedures() noexcept;
+    /*
+     * Marks procedures whose debug info or .symtab name is known to be
+     * non-returning.
+     */
+    void markKnownNonReturnProcedures(std::vector<ICFGNode> &procs) noexcept;
+    /*
+     * Rebuilds procedures containing stale_calls, i.e., calls to
+     * non-returning procedures that were assumed to fall through, until
+     * no further procedure is found to be non-returning.
+     */
+    void propagateNonReturnProcedures
+        (std::vector<CFGNode *> &stale_calls) noexcept;
+    void resetProcedure(ICFGNode &proc_node) noexcept;
+    /*
+     * returns the built procedure containing cfg_node or nullptr.
+     */
+    ICFGNode *findMainProcedure(const CFGNode &cfg_node) noexcept;
     addr_t validateProcedure(const ICFGNode &proc) noexcept;
     CFGNode *findSwitchTableTarget
         (addr_t target_addr);
     void addCallReturnRelation(CFGNode &node);
+    /*
+     * polls budget and keeps its status once exhausted.
+     */
+    bool isStopped() noexcept;
 
 private:
     elf::elf *m_elf_file;
@@ -127,5 +194,9 @@ private:
     DisassemblyCFG m_sec_cfg;
     DisassemblyCallGraph m_call_graph;
     PLTProcedureMap m_plt_map;
+    const DwarfIndex *m_dwarf_index;
+    const NoReturnDatabase *m_noreturn_db;
+    AnalysisBudget *m_budget;
+    AnalysisStatus m_status;
 };
 }
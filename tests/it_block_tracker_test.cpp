@@ -0,0 +1,143 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+//
+// Checks that ITBlockTracker keeps IT paths and its mirror of Capstone's
+// hidden IT state in sync while decoding at every half-word. Capstone is not
+// needed, decoded instructions are built by hand.
+
+#include "disasm/ITBlockTracker.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace disasm;
+
+namespace {
+
+int g_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", \
+                    __FILE__, __LINE__, #cond); \
+            ++g_failures; \
+        } \
+    } while (0)
+
+struct DecodedInst {
+    cs_insn m_inst;
+    cs_detail m_detail;
+
+    DecodedInst(unsigned id,
+                addr_t addr,
+                uint16_t size,
+                uint16_t hword,
+                const char *mnemonic,
+                arm_cc condition) {
+        memset(&m_inst, 0, sizeof(m_inst));
+        memset(&m_detail, 0, sizeof(m_detail));
+        m_inst.id = id;
+        m_inst.address = addr;
+        m_inst.size = size;
+        m_inst.bytes[0] = static_cast<uint8_t>(hword & 0xFF);
+        m_inst.bytes[1] = static_cast<uint8_t>(hword >> 8);
+        strncpy(m_inst.mnemonic, mnemonic, sizeof(m_inst.mnemonic) - 1);
+        m_detail.arm.cc = condition;
+        m_inst.detail = &m_detail;
+    }
+};
+
+// "it eq" and "itt eq"
+constexpr uint16_t kITEq = 0xBF08;
+constexpr uint16_t kITTEq = 0xBF04;
+
+void testConditionOnPath() {
+    ITBlockTracker tracker;
+    DecodedInst it{ARM_INS_IT, 0x1000, 2, kITTEq, "itt", ARM_CC_AL};
+    CHECK(tracker.track(&it.m_inst) == ARM_CC_INVALID);
+    // a 32-bit instruction on path, Capstone applied condition itself
+    DecodedInst first{ARM_INS_MOV, 0x1002, 4, 0xF04F, "moveq.w", ARM_CC_EQ};
+    CHECK(tracker.track(&first.m_inst) == ARM_CC_EQ);
+    CHECK(first.m_detail.arm.cc == ARM_CC_AL);
+    CHECK(strcmp(first.m_inst.mnemonic, "mov.w") == 0);
+    // second half of the previous instruction is off path
+    DecodedInst middle{ARM_INS_MOV, 0x1004, 2, 0x2000, "moveq", ARM_CC_EQ};
+    CHECK(tracker.track(&middle.m_inst) == ARM_CC_INVALID);
+    CHECK(middle.m_detail.arm.cc == ARM_CC_AL);
+    CHECK(strcmp(middle.m_inst.mnemonic, "mov") == 0);
+    // Capstone state is exhausted while path continues
+    DecodedInst second{ARM_INS_MOV, 0x1006, 2, 0x2000, "mov", ARM_CC_AL};
+    CHECK(tracker.track(&second.m_inst) == ARM_CC_EQ);
+    CHECK(second.m_detail.arm.cc == ARM_CC_AL);
+}
+
+void testFailedDecodeAdvancesCapstoneState() {
+    ITBlockTracker tracker;
+    DecodedInst it{ARM_INS_IT, 0x1000, 2, kITEq, "it", ARM_CC_AL};
+    tracker.track(&it.m_inst);
+    // Capstone consumes its IT state on the half-word it fails to decode
+    tracker.trackFailure(0x1002);
+    // hence, the condition of this branch is its own and must be kept
+    DecodedInst branch{ARM_INS_B, 0x1004, 2, 0xD000, "beq", ARM_CC_EQ};
+    CHECK(tracker.track(&branch.m_inst) == ARM_CC_INVALID);
+    CHECK(branch.m_detail.arm.cc == ARM_CC_EQ);
+    CHECK(strcmp(branch.m_inst.mnemonic, "beq") == 0);
+}
+
+void testOwnConditionIsKept() {
+    // second half-word of a 32-bit instruction reads as "it eq"
+    const struct {
+        uint16_t m_size;
+        uint16_t m_first;
+        uint16_t m_second;
+        unsigned m_id;
+        const char *m_mnemonic;
+    } branches[] = {
+        {2, 0xD003, 0, ARM_INS_B, "beq"},
+        {4, 0xF000, 0x8004, ARM_INS_B, "beq.w"},
+        {2, 0xB108, 0, ARM_INS_CBZ, "cbz"}};
+    for (auto &branch_data : branches) {
+        ITBlockTracker tracker;
+        DecodedInst it{ARM_INS_IT, 0x1002, 2, kITEq, "it", ARM_CC_AL};
+        tracker.track(&it.m_inst);
+        DecodedInst branch{branch_data.m_id, 0x1004, branch_data.m_size,
+                           branch_data.m_first, branch_data.m_mnemonic,
+                           ARM_CC_EQ};
+        branch.m_inst.bytes[2] =
+            static_cast<uint8_t>(branch_data.m_second & 0xFF);
+        branch.m_inst.bytes[3] = static_cast<uint8_t>(branch_data.m_second >> 8);
+        tracker.track(&branch.m_inst);
+        CHECK(branch.m_detail.arm.cc == ARM_CC_EQ);
+        CHECK(strcmp(branch.m_inst.mnemonic, branch_data.m_mnemonic) == 0);
+    }
+}
+
+void testFailedDecodeEndsPath() {
+    ITBlockTracker tracker;
+    DecodedInst it{ARM_INS_IT, 0x1000, 2, kITTEq, "itt", ARM_CC_AL};
+    tracker.track(&it.m_inst);
+    tracker.trackFailure(0x1002);
+    // 0x1004 would be on path only if 0x1002 were a 16-bit instruction
+    DecodedInst next{ARM_INS_MOV, 0x1004, 2, 0x2000, "moveq", ARM_CC_EQ};
+    CHECK(tracker.track(&next.m_inst) == ARM_CC_INVALID);
+    // the remaining Capstone state still applies
+    CHECK(next.m_detail.arm.cc == ARM_CC_AL);
+}
+}
+
+int main() {
+    testConditionOnPath();
+    testFailedDecodeAdvancesCapstoneState();
+    testFailedDecodeEndsPath();
+    testOwnConditionIsKept();
+    if (g_failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    return 0;
+}
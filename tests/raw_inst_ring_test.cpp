@@ -0,0 +1,137 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+//
+// Checks that borrowed instructions of RawInstRing don't alias and that
+// decoding into them allocates no heap memory in steady state. Allocations
+// are counted by the hook of MemoryStats if compiled in, by a local one
+// otherwise.
+
+#include "disasm/MCParser.h"
+#include "disasm/MemoryStats.h"
+#include "disasm/RawInstRing.h"
+#include "disasm/RawInstWrapper.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+using namespace disasm;
+
+#ifndef SPEDI_MEMORY_STATS
+static std::atomic<uint64_t> g_allocations{0};
+
+void *operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *result = std::malloc(size == 0 ? 1 : size);
+    if (result == nullptr) {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+#endif
+
+namespace {
+
+int g_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", \
+                    __FILE__, __LINE__, #cond); \
+            ++g_failures; \
+        } \
+    } while (0)
+
+uint64_t allocationCount() {
+#ifdef SPEDI_MEMORY_STATS
+    auto stats = MemoryStats::collect();
+    uint64_t result = 0;
+    for (unsigned i = 0; i < MemoryStats::kOwnerCount; ++i) {
+        result += stats.allocations(static_cast<MemoryOwner>(i));
+    }
+    return result;
+#else
+    return g_allocations.load(std::memory_order_relaxed);
+#endif
+}
+
+// nop; movs r0, #1; mov.w r0, #1; bx lr
+const uint8_t kThumbCode[] = {
+    0x00, 0xBF, 0x01, 0x20, 0x4F, 0xF0, 0x01, 0x00, 0x70, 0x47
+};
+
+void testBorrowedSlotsDontAlias() {
+    auto &ring = RawInstRing::ofThisThread();
+    CHECK(ring.liveCount() == 0);
+    {
+        std::vector<RawInstWrapper> borrowed;
+        borrowed.reserve(RawInstRing::kSlotCount);
+        for (unsigned i = 0; i < RawInstRing::kSlotCount; ++i) {
+            borrowed.push_back(RawInstWrapper::fromThreadRing());
+        }
+        CHECK(ring.liveCount() == RawInstRing::kSlotCount);
+        for (unsigned i = 0; i < borrowed.size(); ++i) {
+            for (unsigned j = i + 1; j < borrowed.size(); ++j) {
+                CHECK(borrowed[i].rawPtr() != borrowed[j].rawPtr());
+                CHECK(borrowed[i].rawPtr()->detail
+                          != borrowed[j].rawPtr()->detail);
+            }
+        }
+        // a released slot is the only one free to borrow again
+        auto released = borrowed[3].rawPtr();
+        borrowed[3] = RawInstWrapper{nullptr};
+        CHECK(ring.liveCount() == RawInstRing::kSlotCount - 1);
+        borrowed[3] = RawInstWrapper::fromThreadRing();
+        CHECK(ring.liveCount() == RawInstRing::kSlotCount);
+        CHECK(borrowed[3].rawPtr() == released);
+    }
+    CHECK(ring.liveCount() == 0);
+}
+
+void testDecodingAllocatesNothing() {
+    MCParser parser;
+    parser.initialize(CS_ARCH_ARM, CS_MODE_THUMB, sizeof(kThumbCode));
+    // the first borrow creates the ring of this thread
+    {
+        auto inst = RawInstWrapper::fromThreadRing();
+        parser.disasm(kThumbCode, sizeof(kThumbCode), 0, inst.rawPtr());
+    }
+    auto before = allocationCount();
+    unsigned decoded = 0;
+    for (unsigned run = 0; run < 1000; ++run) {
+        // a fresh borrow per run like per section
+        auto inst = RawInstWrapper::fromThreadRing();
+        for (addr_t addr = 0; addr + 2 <= sizeof(kThumbCode); addr += 2) {
+            if (parser.disasm(kThumbCode + addr,
+                              sizeof(kThumbCode) - addr,
+                              addr,
+                              inst.rawPtr())) {
+                ++decoded;
+            }
+        }
+    }
+    CHECK(decoded > 0);
+    CHECK(allocationCount() == before);
+}
+}
+
+int main() {
+    testBorrowedSlotsDontAlias();
+    testDecodingAllocatesNothing();
+    if (g_failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,1079 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+//
+// Generates ARM ELF files of configurable size mixing ARM and Thumb-2
+// functions, IT blocks, literal pools, TBB/TBH/LDR switch tables, PLT
+// stubs, and data between functions. Ground truth is written next to the
+// file as lines of
+//   arm|thumb|data <start> <end>     half-open range of .plt or .text
+//   func <addr> arm|thumb            function entry
+// Output only depends on the options, the same seed gives the same file
+// on every platform. Code is streamed to disk, so sizes up to the limit
+// of ELF32 can be generated with little memory.
+
+#include "SyntheticElfGenerator.h"
+#include <algorithm>
+#include <cstring>
+#include <elf.h>
+#include <string>
+#include <vector>
+
+namespace synthetic {
+
+namespace {
+
+const uint32_t kBaseAddr = 0x8000;
+const uint32_t kPageSize = 0x1000;
+// functions that can be called from the current one
+const size_t kCalleeWindow = 64;
+
+const char *kImportNames[] = {
+    "abort", "exit", "printf", "malloc", "free", "memcpy", "memset",
+    "strlen", "strcmp", "puts", "__stack_chk_fail", "__assert_fail",
+    "fopen", "fclose", "fread", "fwrite", "calloc", "realloc", "strncpy",
+    "snprintf", "atoi", "qsort", "memmove", "_exit", "longjmp", "getenv",
+    "time", "rand", "srand", "open", "close", "read"
+};
+static_assert(sizeof(kImportNames) / sizeof(kImportNames[0])
+                  == kMaxImportCount, "Import names out of sync!!");
+
+enum class Kind : uint8_t {
+    kArm,
+    kThumb,
+    kData
+};
+
+const char *kindName(Kind kind) {
+    switch (kind) {
+        case Kind::kArm:
+            return "arm";
+        case Kind::kThumb:
+            return "thumb";
+        default:
+            return "data";
+    }
+}
+
+/*
+ * splitmix64. Standard distributions are implementation defined and would
+ * make output differ between standard libraries.
+ */
+class Random {
+public:
+    explicit Random(uint64_t seed) : m_state{seed} { }
+
+    uint64_t next() {
+        uint64_t z = (m_state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    /*
+     * returns a value in [0, bound).
+     */
+    uint32_t below(uint32_t bound) {
+        return static_cast<uint32_t>(next() % bound);
+    }
+
+    uint32_t between(uint32_t low, uint32_t high) {
+        return low + below(high - low + 1);
+    }
+
+    bool chance(unsigned percent) {
+        return below(100) < percent;
+    }
+
+private:
+    uint64_t m_state;
+};
+
+/*
+ * Code of a single function or data block together with its labels.
+ * Addresses are absolute, offsets are relative to the start of the buffer.
+ */
+class CodeBuffer {
+public:
+    explicit CodeBuffer(uint32_t start_addr) : m_start_addr{start_addr} { }
+
+    uint32_t addr() const {
+        return m_start_addr + static_cast<uint32_t>(m_bytes.size());
+    }
+
+    size_t size() const {
+        return m_bytes.size();
+    }
+
+    size_t offset() const {
+        return m_bytes.size();
+    }
+
+    uint32_t addrOf(size_t offset) const {
+        return m_start_addr + static_cast<uint32_t>(offset);
+    }
+
+    void mark(Kind kind) {
+        if (m_kinds.empty() || m_kinds.back().second != kind) {
+            m_kinds.push_back({addr(), kind});
+        }
+    }
+
+    void addFunction(uint32_t addr, Kind kind) {
+        m_functions.push_back({addr, kind});
+    }
+
+    void emit8(uint8_t value) {
+        m_bytes.push_back(value);
+    }
+
+    void emit16(uint16_t value) {
+        emit8(value & 0xff);
+        emit8(value >> 8);
+    }
+
+    void emit32(uint32_t value) {
+        emit16(value & 0xffff);
+        emit16(value >> 16);
+    }
+
+    /*
+     * 32-bit Thumb instructions are two half-words, the first one holds
+     * the opcode.
+     */
+    void emitThumb32(uint16_t first, uint16_t second) {
+        emit16(first);
+        emit16(second);
+    }
+
+    void patch16(size_t offset, uint16_t value) {
+        m_bytes[offset] = value & 0xff;
+        m_bytes[offset + 1] = value >> 8;
+    }
+
+    void patch32(size_t offset, uint32_t value) {
+        patch16(offset, value & 0xffff);
+        patch16(offset + 2, value >> 16);
+    }
+
+    uint16_t read16(size_t offset) const {
+        return static_cast<uint16_t>(m_bytes[offset] | m_bytes[offset + 1] << 8);
+    }
+
+    uint32_t read32(size_t offset) const {
+        return read16(offset) | static_cast<uint32_t>(read16(offset + 2)) << 16;
+    }
+
+    const std::vector<uint8_t> &bytes() const {
+        return m_bytes;
+    }
+
+    const std::vector<std::pair<uint32_t, Kind>> &kinds() const {
+        return m_kinds;
+    }
+
+    const std::vector<std::pair<uint32_t, Kind>> &functions() const {
+        return m_functions;
+    }
+
+private:
+    uint32_t m_start_addr;
+    std::vector<uint8_t> m_bytes;
+    // address where each labeled region starts
+    std::vector<std::pair<uint32_t, Kind>> m_kinds;
+    std::vector<std::pair<uint32_t, Kind>> m_functions;
+};
+
+struct Callee {
+    uint32_t m_addr;
+    Kind m_kind;
+};
+
+struct PLTEntry {
+    // ARM entry of the stub
+    uint32_t m_arm_addr;
+    // Thumb veneer preceding the stub or zero
+    uint32_t m_thumb_addr;
+};
+
+// offsets of a section in the file, addresses are kBaseAddr + offset
+struct Layout {
+    uint32_t m_offset;
+    uint32_t m_size;
+};
+
+uint32_t alignTo(uint32_t value, uint32_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/*
+ * Encodes BL, or BLX if exchange, from the Thumb instruction at from.
+ */
+void encodeThumbCall
+    (uint32_t from, uint32_t to, bool exchange, uint16_t &first,
+     uint16_t &second) {
+    // BLX computes its target from the word aligned PC
+    uint32_t pc = exchange ? ((from + 4) & ~3U) : from + 4;
+    int32_t offset = static_cast<int32_t>(to - pc);
+    uint32_t s = (offset >> 24) & 1;
+    uint32_t j1 = (~(((offset >> 23) & 1) ^ s)) & 1;
+    uint32_t j2 = (~(((offset >> 22) & 1) ^ s)) & 1;
+    first = static_cast<uint16_t>(0xf000 | s << 10 | ((offset >> 12) & 0x3ff));
+    second = static_cast<uint16_t>((exchange ? 0xc000 : 0xd000)
+                                       | j1 << 13 | j2 << 11
+                                       | ((offset >> 1) & 0x7ff));
+}
+
+bool isThumbCallInRange(uint32_t from, uint32_t to) {
+    int64_t offset = static_cast<int64_t>(to) - (from + 4);
+    return -(1 << 24) <= offset && offset < (1 << 24) - 4;
+}
+
+bool isArmCallInRange(uint32_t from, uint32_t to) {
+    int64_t offset = static_cast<int64_t>(to) - (from + 8);
+    return -(1 << 25) <= offset && offset < (1 << 25) - 4;
+}
+
+class Generator {
+public:
+    Generator(const Config &config, FILE *elf_file, FILE *labels_file);
+    bool generate();
+
+private:
+    // section indexes
+    enum : unsigned {
+        kNullSec,
+        kDynsymSec,
+        kDynstrSec,
+        kRelPltSec,
+        kPltSec,
+        kTextSec,
+        kGotSec,
+        kSymtabSec,
+        kStrtabSec,
+        kShstrtabSec,
+        kSectionCount
+    };
+
+    void computeLayout();
+    void writeDynamicSections();
+    void generatePLT();
+    void generateText();
+    void generateThumbFunction(CodeBuffer &buf);
+    void generateArmFunction(CodeBuffer &buf);
+    void generateThumbSwitch(CodeBuffer &buf);
+    void generateArmSwitch(CodeBuffer &buf);
+    void generateThumbCall(CodeBuffer &buf);
+    void generateArmCall(CodeBuffer &buf);
+    void generateData(CodeBuffer &buf, uint32_t size);
+    void commit(const CodeBuffer &buf, unsigned section_index);
+    void closeLabels(uint32_t end_addr);
+    void addSymbol
+        (uint32_t name, uint32_t value, unsigned char info,
+         unsigned section_index);
+    uint32_t addString(const std::string &str);
+    bool writeTrailer();
+
+private:
+    Config m_config;
+    FILE *m_elf_file;
+    FILE *m_labels_file;
+    Random m_random;
+    Layout m_sections[kSectionCount];
+    uint32_t m_got_addr;
+    bool m_long_plt;
+    uint32_t m_entry_addr;
+    std::vector<PLTEntry> m_plt_entries;
+    std::vector<Callee> m_callees;
+    // open labeled region
+    Kind m_kind;
+    uint32_t m_kind_start;
+    bool m_kind_open;
+    // symbols and their names are spooled since their size is not
+    // known before code is generated
+    FILE *m_symtab_spool;
+    FILE *m_strtab_spool;
+    uint32_t m_symbol_count;
+    uint32_t m_strtab_size;
+    uint32_t m_mapping_names[3];
+};
+
+Generator::Generator
+    (const Config &config, FILE *elf_file, FILE *labels_file) :
+    m_config(config),
+    m_elf_file{elf_file},
+    m_labels_file{labels_file},
+    m_random{config.m_seed},
+    m_got_addr{0},
+    m_long_plt{false},
+    m_entry_addr{0},
+    m_kind{Kind::kData},
+    m_kind_start{0},
+    m_kind_open{false},
+    m_symtab_spool{nullptr},
+    m_strtab_spool{nullptr},
+    m_symbol_count{0},
+    m_strtab_size{0} {
+    std::memset(m_sections, 0, sizeof(m_sections));
+}
+
+void Generator::computeLayout() {
+    auto import_count = m_config.m_import_count;
+    uint32_t dynstr_size = 1;
+    for (unsigned i = 0; i < import_count; ++i) {
+        dynstr_size += std::strlen(kImportNames[i]) + 1;
+    }
+    uint32_t offset = sizeof(Elf32_Ehdr) + 2 * sizeof(Elf32_Phdr);
+    offset = alignTo(offset, 4);
+    m_sections[kDynsymSec] = {offset, (import_count + 1) * 16};
+    offset += m_sections[kDynsymSec].m_size;
+    m_sections[kDynstrSec] = {offset, dynstr_size};
+    offset = alignTo(offset + dynstr_size, 4);
+    m_sections[kRelPltSec] = {offset, import_count * 8};
+    offset = alignTo(offset + import_count * 8, 16);
+    auto plt_offset = offset;
+    // the long form of stubs is needed once the GOT is 256MB away
+    for (m_long_plt = false;; m_long_plt = true) {
+        // every other stub has a Thumb veneer
+        uint32_t plt_size = 20 + import_count * (m_long_plt ? 16 : 12)
+            + (import_count + 1) / 2 * 4;
+        m_sections[kPltSec] = {plt_offset, plt_size};
+        offset = alignTo(plt_offset + plt_size, 16);
+        m_sections[kTextSec] = {offset, m_config.m_text_size};
+        offset = alignTo(offset + m_config.m_text_size, kPageSize);
+        m_sections[kGotSec] = {offset, (import_count + 3) * 4};
+        m_got_addr = kBaseAddr + offset;
+        if (m_long_plt || offset + m_sections[kGotSec].m_size
+                                 - plt_offset < (1U << 28)) {
+            break;
+        }
+    }
+}
+
+void Generator::writeDynamicSections() {
+    auto import_count = m_config.m_import_count;
+    std::vector<uint8_t> header(m_sections[kPltSec].m_offset, 0);
+    // .dynsym and .dynstr
+    uint32_t name_offset = 1;
+    for (unsigned i = 0; i < import_count; ++i) {
+        Elf32_Sym sym;
+        std::memset(&sym, 0, sizeof(sym));
+        sym.st_name = name_offset;
+        sym.st_info = ELF32_ST_INFO(STB_GLOBAL, STT_FUNC);
+        sym.st_shndx = SHN_UNDEF;
+        std::memcpy(header.data() + m_sections[kDynsymSec].m_offset
+                        + (i + 1) * sizeof(sym), &sym, sizeof(sym));
+        auto length = std::strlen(kImportNames[i]) + 1;
+        std::memcpy(header.data() + m_sections[kDynstrSec].m_offset
+                        + name_offset, kImportNames[i], length);
+        name_offset += length;
+    }
+    // .rel.plt
+    for (unsigned i = 0; i < import_count; ++i) {
+        Elf32_Rel rel;
+        rel.r_offset = m_got_addr + 12 + i * 4;
+        rel.r_info = ELF32_R_INFO(i + 1, R_ARM_JUMP_SLOT);
+        std::memcpy(header.data() + m_sections[kRelPltSec].m_offset
+                        + i * sizeof(rel), &rel, sizeof(rel));
+    }
+    // headers are rewritten once section headers are placed
+    fwrite(header.data(), 1, header.size(), m_elf_file);
+}
+
+void Generator::generatePLT() {
+    auto plt_addr = kBaseAddr + m_sections[kPltSec].m_offset;
+    CodeBuffer buf{plt_addr};
+    buf.mark(Kind::kArm);
+    buf.emit32(0xe52de004);   // push {lr}
+    buf.emit32(0xe59fe004);   // ldr lr, [pc, #4]
+    buf.emit32(0xe08fe00e);   // add lr, pc, lr
+    buf.emit32(0xe5bef008);   // ldr pc, [lr, #8]!
+    buf.mark(Kind::kData);
+    buf.emit32(m_got_addr - (plt_addr + 16));
+    for (unsigned i = 0; i < m_config.m_import_count; ++i) {
+        PLTEntry entry{0, 0};
+        if (i % 2 == 0) {
+            buf.mark(Kind::kThumb);
+            entry.m_thumb_addr = buf.addr();
+            buf.emit16(0x4778);   // bx pc
+            buf.emit16(0x46c0);   // nop
+        }
+        buf.mark(Kind::kArm);
+        entry.m_arm_addr = buf.addr();
+        uint32_t offset = m_got_addr + 12 + i * 4 - (entry.m_arm_addr + 8);
+        if (m_long_plt) {
+            buf.emit32(0xe28fc200 | ((offset >> 28) & 0xf));
+            buf.emit32(0xe28cc600 | ((offset >> 20) & 0xff));
+        } else {
+            buf.emit32(0xe28fc600 | ((offset >> 20) & 0xff));
+        }
+        buf.emit32(0xe28cca00 | ((offset >> 12) & 0xff));
+        buf.emit32(0xe5bcf000 | (offset & 0xfff));
+        m_plt_entries.push_back(entry);
+    }
+    commit(buf, kPltSec);
+    closeLabels(buf.addr());
+    // padding up to .text
+    std::vector<uint8_t> padding
+        (m_sections[kTextSec].m_offset - m_sections[kPltSec].m_offset
+             - m_sections[kPltSec].m_size, 0);
+    fwrite(padding.data(), 1, padding.size(), m_elf_file);
+}
+
+void Generator::generateData(CodeBuffer &buf, uint32_t size) {
+    buf.mark(Kind::kData);
+    for (uint32_t i = 0; i < size; ++i) {
+        buf.emit8(static_cast<uint8_t>(m_random.next()));
+    }
+}
+
+void Generator::generateThumbCall(CodeBuffer &buf) {
+    auto from = buf.addr();
+    uint16_t first, second;
+    if (!m_plt_entries.empty() && m_random.chance(20)) {
+        auto &entry = m_plt_entries[m_random.below(m_plt_entries.size())];
+        if (entry.m_thumb_addr != 0
+            && isThumbCallInRange(from, entry.m_thumb_addr)) {
+            encodeThumbCall(from, entry.m_thumb_addr, false, first, second);
+            buf.emitThumb32(first, second);
+            return;
+        }
+        if (isThumbCallInRange(from, entry.m_arm_addr)) {
+            encodeThumbCall(from, entry.m_arm_addr, true, first, second);
+            buf.emitThumb32(first, second);
+            return;
+        }
+    }
+    if (m_callees.empty()) {
+        buf.emit16(0x4600);   // mov r0, r0
+        return;
+    }
+    auto &callee = m_callees[m_random.below(m_callees.size())];
+    if (!isThumbCallInRange(from, callee.m_addr)) {
+        buf.emit16(0x4600);
+        return;
+    }
+    encodeThumbCall(from, callee.m_addr, callee.m_kind == Kind::kArm,
+                    first, second);
+    buf.emitThumb32(first, second);
+}
+
+void Generator::generateArmCall(CodeBuffer &buf) {
+    auto from = buf.addr();
+    if (!m_plt_entries.empty() && m_random.chance(20)) {
+        auto &entry = m_plt_entries[m_random.below(m_plt_entries.size())];
+        if (isArmCallInRange(from, entry.m_arm_addr)) {
+            buf.emit32(0xeb000000
+                           | (((entry.m_arm_addr - (from + 8)) >> 2)
+                               & 0xffffff));
+            return;
+        }
+    }
+    if (m_callees.empty()) {
+        buf.emit32(0xe1a00000);   // mov r0, r0
+        return;
+    }
+    auto &callee = m_callees[m_random.below(m_callees.size())];
+    if (!isArmCallInRange(from, callee.m_addr)) {
+        buf.emit32(0xe1a00000);
+        return;
+    }
+    uint32_t offset = callee.m_addr - (from + 8);
+    if (callee.m_kind == Kind::kArm) {
+        buf.emit32(0xeb000000 | ((offset >> 2) & 0xffffff));
+    } else {
+        // blx with the half-word bit of the Thumb target
+        buf.emit32(0xfa000000 | ((offset >> 1) & 1) << 24
+                       | ((offset >> 2) & 0xffffff));
+    }
+}
+
+/*
+ * cmp r0, #n-1; bhi default; followed by TBB, TBH, or an ADR based LDR
+ * table, the table, and the case blocks which all branch to the end.
+ */
+void Generator::generateThumbSwitch(CodeBuffer &buf) {
+    unsigned case_count = m_random.between(2, 8);
+    unsigned table_kind = m_random.below(3);
+    buf.emit16(0x2800 | (case_count - 1));   // cmp r0, #n-1
+    auto bhi_offset = buf.offset();
+    buf.emit16(0xd800);                      // bhi default
+    size_t adr_offset = 0;
+    if (table_kind == 2) {
+        adr_offset = buf.offset();
+        buf.emit16(0xa100);                  // adr r1, table
+        buf.emitThumb32(0xf851, 0xf020);     // ldr.w pc, [r1, r0, lsl #2]
+        if (buf.addr() % 4 != 0) {
+            buf.emit16(0xbf00);              // nop
+        }
+    } else {
+        // tbb [pc, r0] or tbh [pc, r0, lsl #1]
+        buf.emitThumb32(0xe8df, table_kind == 0 ? 0xf000 : 0xf010);
+    }
+    // table base is the address following tbb/tbh
+    auto table_base = buf.addr();
+    auto table_offset = buf.offset();
+    unsigned entry_size = table_kind == 0 ? 1 : (table_kind == 1 ? 2 : 4);
+    buf.mark(Kind::kData);
+    for (unsigned i = 0; i < case_count * entry_size; ++i) {
+        buf.emit8(0);
+    }
+    if (buf.offset() % 2 != 0) {
+        buf.emit8(0);
+    }
+    buf.mark(Kind::kThumb);
+    if (table_kind == 2) {
+        auto adr_pc = (buf.addrOf(adr_offset) + 4) & ~3U;
+        buf.patch16(adr_offset, 0xa100 | ((table_base - adr_pc) / 4));
+    }
+    std::vector<size_t> exit_branches;
+    for (unsigned i = 0; i < case_count; ++i) {
+        auto case_addr = buf.addr();
+        auto entry_offset = table_offset + i * entry_size;
+        if (table_kind == 0) {
+            auto value = (case_addr - table_base) / 2;
+            auto current = buf.read16(entry_offset & ~1UL);
+            if (entry_offset % 2 == 0) {
+                buf.patch16(entry_offset, (current & 0xff00) | value);
+            } else {
+                buf.patch16(entry_offset - 1, (current & 0xff) | value << 8);
+            }
+        } else if (table_kind == 1) {
+            buf.patch16(entry_offset, (case_addr - table_base) / 2);
+        } else {
+            buf.patch32(entry_offset, case_addr | 1);
+        }
+        buf.emit16(0x2100 | i);              // movs r1, #i
+        exit_branches.push_back(buf.offset());
+        buf.emit16(0xe000);                  // b end
+    }
+    auto default_addr = buf.addr();
+    buf.patch16(bhi_offset, 0xd800
+        | (((default_addr - (buf.addrOf(bhi_offset) + 4)) >> 1) & 0xff));
+    buf.emit16(0x21ff);                      // movs r1, #255
+    auto end_addr = buf.addr();
+    for (auto offset : exit_branches) {
+        buf.patch16(offset, 0xe000
+            | (((end_addr - (buf.addrOf(offset) + 4)) >> 1) & 0x7ff));
+    }
+}
+
+/*
+ * cmp r0, #n-1; ldrls pc, [pc, r0, lsl #2]; b default; table; cases.
+ */
+void Generator::generateArmSwitch(CodeBuffer &buf) {
+    unsigned case_count = m_random.between(2, 8);
+    buf.emit32(0xe3500000 | (case_count - 1));
+    buf.emit32(0x979ff100);
+    auto b_offset = buf.offset();
+    buf.emit32(0xea000000);
+    auto table_offset = buf.offset();
+    buf.mark(Kind::kData);
+    for (unsigned i = 0; i < case_count; ++i) {
+        buf.emit32(0);
+    }
+    buf.mark(Kind::kArm);
+    std::vector<size_t> exit_branches;
+    for (unsigned i = 0; i < case_count; ++i) {
+        buf.patch32(table_offset + i * 4, buf.addr());
+        buf.emit32(0xe3a01000 | i);          // mov r1, #i
+        exit_branches.push_back(buf.offset());
+        buf.emit32(0xea000000);              // b end
+    }
+    auto default_addr = buf.addr();
+    buf.patch32(b_offset, 0xea000000
+        | (((default_addr - (buf.addrOf(b_offset) + 8)) >> 2) & 0xffffff));
+    buf.emit32(0xe3a010ff);                  // mov r1, #255
+    auto end_addr = buf.addr();
+    for (auto offset : exit_branches) {
+        buf.patch32(offset, 0xea000000
+            | (((end_addr - (buf.addrOf(offset) + 8)) >> 2) & 0xffffff));
+    }
+}
+
+void Generator::generateThumbFunction(CodeBuffer &buf) {
+    buf.mark(Kind::kThumb);
+    buf.addFunction(buf.addr(), Kind::kThumb);
+    bool wide_frame = m_random.chance(30);
+    if (wide_frame) {
+        buf.emitThumb32(0xe92d, 0x4ff0);     // push.w {r4-r11, lr}
+    } else {
+        buf.emit16(0xb5f0);                  // push {r4-r7, lr}
+    }
+    // forward branches are resolved at the start of a later item
+    struct ForwardBranch {
+        size_t m_offset;
+        unsigned m_target_item;
+    };
+    std::vector<ForwardBranch> branches;
+    std::vector<size_t> literal_loads;
+    unsigned item_count = m_random.between(4, 48);
+    auto resolve = [&](unsigned item, bool all) {
+        for (auto iter = branches.begin(); iter != branches.end();) {
+            if (!all && (*iter).m_target_item != item) {
+                ++iter;
+                continue;
+            }
+            auto from = buf.addrOf((*iter).m_offset);
+            auto value = buf.read16((*iter).m_offset);
+            buf.patch16((*iter).m_offset,
+                        value | (((buf.addr() - (from + 4)) >> 1) & 0xff));
+            iter = branches.erase(iter);
+        }
+    };
+    for (unsigned item = 0; item < item_count; ++item) {
+        resolve(item, false);
+        auto rd = m_random.below(8);
+        auto rn = m_random.below(8);
+        auto choice = m_random.below(100);
+        if (choice < m_config.m_switch_percent) {
+            // tables are large, pending branches must not cross them
+            resolve(item, true);
+            generateThumbSwitch(buf);
+        } else if (choice < m_config.m_switch_percent
+                             + m_config.m_it_percent) {
+            // it<cond> with all then instructions
+            unsigned cond = m_random.below(14);
+            unsigned count = m_random.between(1, 3);
+            unsigned mask = 1U << (4 - count);
+            for (unsigned i = 1; i < count; ++i) {
+                mask |= (cond & 1) << (4 - i);
+            }
+            buf.emit16(0xbf00 | cond << 4 | mask);
+            for (unsigned i = 0; i < count; ++i) {
+                buf.emit16(0x2000 | m_random.below(8) << 8
+                               | m_random.below(256));
+            }
+        } else {
+            switch (m_random.below(12)) {
+                case 0:
+                    buf.emit16(0x2000 | rd << 8 | m_random.below(256));
+                    break;
+                case 1:
+                    buf.emit16(0x1800 | m_random.below(8) << 6 | rn << 3 | rd);
+                    break;
+                case 2:
+                    buf.emit16(0x6800 | m_random.below(32) << 6 | rn << 3 | rd);
+                    break;
+                case 3:
+                    buf.emit16(0x6000 | m_random.below(32) << 6 | rn << 3 | rd);
+                    break;
+                case 4:
+                    buf.emitThumb32(0xf04f, rd << 8 | m_random.below(256));
+                    break;
+                case 5:
+                    buf.emitThumb32(0xeb00 | rn, rd << 8 | m_random.below(8));
+                    break;
+                case 6:
+                    buf.emitThumb32(0xf8d0 | rn, rd << 12
+                        | m_random.below(1024) * 4);
+                    break;
+                case 7:
+                case 8: {
+                    // cmp rn, #imm; b<cond> to a later item
+                    buf.emit16(0x2800 | rn << 8 | m_random.below(256));
+                    branches.push_back
+                        ({buf.offset(), item + m_random.between(1, 3)});
+                    buf.emit16(0xd000 | m_random.below(14) << 8);
+                    break;
+                }
+                case 9:
+                    literal_loads.push_back(buf.offset());
+                    buf.emit16(0x4800 | rd << 8);   // ldr rd, [pc, #imm]
+                    break;
+                default:
+                    generateThumbCall(buf);
+                    break;
+            }
+        }
+    }
+    resolve(item_count, true);
+    if (wide_frame) {
+        buf.emitThumb32(0xe8bd, 0x8ff0);     // pop.w {r4-r11, pc}
+    } else {
+        buf.emit16(0xbdf0);                  // pop {r4-r7, pc}
+    }
+    if (literal_loads.empty()) {
+        return;
+    }
+    if (buf.addr() % 4 != 0) {
+        buf.emit16(0xbf00);                  // nop
+    }
+    auto pool_addr = buf.addr();
+    buf.mark(Kind::kData);
+    for (size_t i = 0; i < literal_loads.size(); ++i) {
+        auto load_pc = (buf.addrOf(literal_loads[i]) + 4) & ~3U;
+        auto offset = (pool_addr + i * 4 - load_pc) / 4;
+        auto value = buf.read16(literal_loads[i]);
+        if (offset <= 0xff) {
+            buf.patch16(literal_loads[i], value | offset);
+        } else {
+            // out of range, becomes movs rd, #0
+            buf.patch16(literal_loads[i], 0x2000 | (value & 0x0700));
+        }
+        buf.emit32(static_cast<uint32_t>(m_random.next()));
+    }
+}
+
+void Generator::generateArmFunction(CodeBuffer &buf) {
+    buf.mark(Kind::kArm);
+    buf.addFunction(buf.addr(), Kind::kArm);
+    buf.emit32(0xe92d4ff0);                  // push {r4-r11, lr}
+    struct ForwardBranch {
+        size_t m_offset;
+        unsigned m_target_item;
+    };
+    std::vector<ForwardBranch> branches;
+    std::vector<size_t> literal_loads;
+    unsigned item_count = m_random.between(4, 48);
+    auto resolve = [&](unsigned item, bool all) {
+        for (auto iter = branches.begin(); iter != branches.end();) {
+            if (!all && (*iter).m_target_item != item) {
+                ++iter;
+                continue;
+            }
+            auto from = buf.addrOf((*iter).m_offset);
+            auto value = buf.read32((*iter).m_offset);
+            buf.patch32((*iter).m_offset,
+                        value | (((buf.addr() - (from + 8)) >> 2) & 0xffffff));
+            iter = branches.erase(iter);
+        }
+    };
+    for (unsigned item = 0; item < item_count; ++item) {
+        resolve(item, false);
+        auto rd = m_random.below(8);
+        auto rn = m_random.below(8);
+        auto choice = m_random.below(100);
+        if (choice < m_config.m_switch_percent) {
+            generateArmSwitch(buf);
+            continue;
+        }
+        if (choice < m_config.m_switch_percent + m_config.m_it_percent) {
+            // conditionally executed mov
+            buf.emit32(m_random.below(14) << 28 | 0x03a00000 | rd << 12
+                           | m_random.below(256));
+            continue;
+        }
+        switch (m_random.below(10)) {
+            case 0:
+                buf.emit32(0xe3a00000 | rd << 12 | m_random.below(256));
+                break;
+            case 1:
+                buf.emit32(0xe0800000 | rn << 16 | rd << 12
+                               | m_random.below(8));
+                break;
+            case 2:
+                buf.emit32(0xe5900000 | rn << 16 | rd << 12
+                               | m_random.below(1024) * 4);
+                break;
+            case 3:
+                buf.emit32(0xe5800000 | rn << 16 | rd << 12
+                               | m_random.below(1024) * 4);
+                break;
+            case 4:
+            case 5:
+                // cmp rn, #imm; b<cond> to a later item
+                buf.emit32(0xe3500000 | rn << 16 | m_random.below(256));
+                branches.push_back
+                    ({buf.offset(), item + m_random.between(1, 3)});
+                buf.emit32(m_random.below(14) << 28 | 0x0a000000);
+                break;
+            case 6:
+                literal_loads.push_back(buf.offset());
+                buf.emit32(0xe59f0000 | rd << 12);   // ldr rd, [pc, #imm]
+                break;
+            default:
+                generateArmCall(buf);
+                break;
+        }
+    }
+    resolve(item_count, true);
+    buf.emit32(0xe8bd8ff0);                  // pop {r4-r11, pc}
+    if (literal_loads.empty()) {
+        return;
+    }
+    auto pool_addr = buf.addr();
+    buf.mark(Kind::kData);
+    for (size_t i = 0; i < literal_loads.size(); ++i) {
+        auto offset = pool_addr + i * 4 - (buf.addrOf(literal_loads[i]) + 8);
+        auto value = buf.read32(literal_loads[i]);
+        if (offset <= 0xfff) {
+            buf.patch32(literal_loads[i], value | offset);
+        } else {
+            buf.patch32(literal_loads[i], 0xe3a00000 | (value & 0xf000));
+        }
+        buf.emit32(static_cast<uint32_t>(m_random.next()));
+    }
+}
+
+void Generator::generateText() {
+    auto text_addr = kBaseAddr + m_sections[kTextSec].m_offset;
+    auto text_end = text_addr + m_config.m_text_size;
+    auto addr = text_addr;
+    while (text_end - addr > kMaxFunctionSize + 256) {
+        CodeBuffer buf{addr};
+        if (m_random.chance(m_config.m_arm_percent)) {
+            generateArmFunction(buf);
+        } else {
+            generateThumbFunction(buf);
+        }
+        if (buf.addr() % 4 != 0) {
+            buf.mark(Kind::kData);
+            buf.emit16(0);
+        }
+        if (m_random.chance(m_config.m_data_percent)) {
+            generateData(buf, m_random.between(1, 64) * 4);
+        }
+        for (auto &function : buf.functions()) {
+            if (m_callees.size() == kCalleeWindow) {
+                m_callees.erase(m_callees.begin());
+            }
+            m_callees.push_back({function.first, function.second});
+        }
+        commit(buf, kTextSec);
+        addr = buf.addr();
+    }
+    CodeBuffer tail{addr};
+    generateData(tail, text_end - addr);
+    commit(tail, kTextSec);
+    closeLabels(text_end);
+}
+
+void Generator::commit(const CodeBuffer &buf, unsigned section_index) {
+    fwrite(buf.bytes().data(), 1, buf.size(), m_elf_file);
+    for (auto &function : buf.functions()) {
+        if (m_entry_addr == 0) {
+            m_entry_addr = function.first
+                | (function.second == Kind::kThumb ? 1 : 0);
+        }
+        fprintf(m_labels_file, "func 0x%x %s\n",
+                function.first, kindName(function.second));
+        if (!m_config.m_strip) {
+            char name[32];
+            snprintf(name, sizeof(name), "fn_%x", function.first);
+            auto value = function.first
+                | (function.second == Kind::kThumb ? 1 : 0);
+            addSymbol(addString(name), value,
+                      ELF32_ST_INFO(STB_LOCAL, STT_FUNC), section_index);
+        }
+    }
+    for (auto &kind : buf.kinds()) {
+        if (m_kind_open && m_kind == kind.second) {
+            continue;
+        }
+        closeLabels(kind.first);
+        m_kind = kind.second;
+        m_kind_start = kind.first;
+        m_kind_open = true;
+        if (!m_config.m_strip) {
+            addSymbol(m_mapping_names[static_cast<unsigned>(kind.second)],
+                      kind.first, ELF32_ST_INFO(STB_LOCAL, STT_NOTYPE),
+                      section_index);
+        }
+    }
+}
+
+void Generator::closeLabels(uint32_t end_addr) {
+    if (m_kind_open && m_kind_start < end_addr) {
+        fprintf(m_labels_file, "%s 0x%x 0x%x\n",
+                kindName(m_kind), m_kind_start, end_addr);
+    }
+    m_kind_open = false;
+}
+
+void Generator::addSymbol
+    (uint32_t name, uint32_t value, unsigned char info,
+     unsigned section_index) {
+    Elf32_Sym sym;
+    std::memset(&sym, 0, sizeof(sym));
+    sym.st_name = name;
+    sym.st_value = value;
+    sym.st_info = info;
+    sym.st_shndx = static_cast<Elf32_Section>(section_index);
+    fwrite(&sym, sizeof(sym), 1, m_symtab_spool);
+    ++m_symbol_count;
+}
+
+uint32_t Generator::addString(const std::string &str) {
+    auto offset = m_strtab_size;
+    fwrite(str.c_str(), 1, str.size() + 1, m_strtab_spool);
+    m_strtab_size += str.size() + 1;
+    return offset;
+}
+
+static bool copySpool(FILE *spool, FILE *out) {
+    rewind(spool);
+    char buffer[1 << 16];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), spool)) > 0) {
+        if (fwrite(buffer, 1, count, out) != count) {
+            return false;
+        }
+    }
+    return !ferror(spool);
+}
+
+bool Generator::writeTrailer() {
+    auto offset = m_sections[kTextSec].m_offset + m_sections[kTextSec].m_size;
+    std::vector<uint8_t> padding(m_sections[kGotSec].m_offset - offset, 0);
+    fwrite(padding.data(), 1, padding.size(), m_elf_file);
+    // GOT entries initially point to PLT0
+    std::vector<uint32_t> got(m_config.m_import_count + 3, 0);
+    for (size_t i = 3; i < got.size(); ++i) {
+        got[i] = kBaseAddr + m_sections[kPltSec].m_offset;
+    }
+    fwrite(got.data(), 4, got.size(), m_elf_file);
+    offset = m_sections[kGotSec].m_offset + m_sections[kGotSec].m_size;
+
+    if (!m_config.m_strip) {
+        m_sections[kSymtabSec] = {offset, m_symbol_count * 16};
+        if (!copySpool(m_symtab_spool, m_elf_file)) {
+            return false;
+        }
+        offset += m_sections[kSymtabSec].m_size;
+        m_sections[kStrtabSec] = {offset, m_strtab_size};
+        if (!copySpool(m_strtab_spool, m_elf_file)) {
+            return false;
+        }
+        offset += m_strtab_size;
+    }
+    const char shstrtab[] = "\0.dynsym\0.dynstr\0.rel.plt\0.plt\0.text\0.got"
+        "\0.symtab\0.strtab\0.shstrtab";
+    const uint32_t names[kSectionCount] = {0, 1, 9, 17, 26, 31, 37, 42, 50, 58};
+    m_sections[kShstrtabSec] = {offset, sizeof(shstrtab)};
+    fwrite(shstrtab, 1, sizeof(shstrtab), m_elf_file);
+    offset += sizeof(shstrtab);
+    auto shdr_offset = alignTo(offset, 4);
+    padding.assign(shdr_offset - offset, 0);
+    fwrite(padding.data(), 1, padding.size(), m_elf_file);
+
+    Elf32_Shdr shdrs[kSectionCount];
+    std::memset(shdrs, 0, sizeof(shdrs));
+    for (unsigned i = 1; i < kSectionCount; ++i) {
+        shdrs[i].sh_name = names[i];
+        shdrs[i].sh_offset = m_sections[i].m_offset;
+        shdrs[i].sh_size = m_sections[i].m_size;
+        shdrs[i].sh_addralign = 4;
+    }
+    auto set_alloc = [&](unsigned index, Elf32_Word type, Elf32_Word flags) {
+        shdrs[index].sh_type = type;
+        shdrs[index].sh_flags = SHF_ALLOC | flags;
+        shdrs[index].sh_addr = kBaseAddr + m_sections[index].m_offset;
+    };
+    set_alloc(kDynsymSec, SHT_DYNSYM, 0);
+    shdrs[kDynsymSec].sh_link = kDynstrSec;
+    shdrs[kDynsymSec].sh_info = 1;
+    shdrs[kDynsymSec].sh_entsize = sizeof(Elf32_Sym);
+    set_alloc(kDynstrSec, SHT_STRTAB, 0);
+    shdrs[kDynstrSec].sh_addralign = 1;
+    set_alloc(kRelPltSec, SHT_REL, SHF_INFO_LINK);
+    shdrs[kRelPltSec].sh_link = kDynsymSec;
+    shdrs[kRelPltSec].sh_info = kGotSec;
+    shdrs[kRelPltSec].sh_entsize = sizeof(Elf32_Rel);
+    set_alloc(kPltSec, SHT_PROGBITS, SHF_EXECINSTR);
+    shdrs[kPltSec].sh_entsize = 4;
+    set_alloc(kTextSec, SHT_PROGBITS, SHF_EXECINSTR);
+    set_alloc(kGotSec, SHT_PROGBITS, SHF_WRITE);
+    shdrs[kGotSec].sh_entsize = 4;
+    if (!m_config.m_strip) {
+        shdrs[kSymtabSec].sh_type = SHT_SYMTAB;
+        shdrs[kSymtabSec].sh_link = kStrtabSec;
+        // all symbols are local
+        shdrs[kSymtabSec].sh_info = m_symbol_count;
+        shdrs[kSymtabSec].sh_entsize = sizeof(Elf32_Sym);
+        shdrs[kStrtabSec].sh_type = SHT_STRTAB;
+        shdrs[kStrtabSec].sh_addralign = 1;
+    } else {
+        // stripped files keep the section slots as SHT_NULL
+        shdrs[kSymtabSec].sh_name = 0;
+        shdrs[kStrtabSec].sh_name = 0;
+    }
+    shdrs[kShstrtabSec].sh_type = SHT_STRTAB;
+    shdrs[kShstrtabSec].sh_addralign = 1;
+    fwrite(shdrs, sizeof(shdrs), 1, m_elf_file);
+
+    Elf32_Ehdr ehdr;
+    std::memset(&ehdr, 0, sizeof(ehdr));
+    std::memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS32;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type = ET_EXEC;
+    ehdr.e_machine = EM_ARM;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_entry = m_entry_addr;
+    ehdr.e_phoff = sizeof(Elf32_Ehdr);
+    ehdr.e_shoff = shdr_offset;
+    ehdr.e_flags = EF_ARM_EABI_VER5;
+    ehdr.e_ehsize = sizeof(Elf32_Ehdr);
+    ehdr.e_phentsize = sizeof(Elf32_Phdr);
+    ehdr.e_phnum = 2;
+    ehdr.e_shentsize = sizeof(Elf32_Shdr);
+    ehdr.e_shnum = kSectionCount;
+    ehdr.e_shstrndx = kShstrtabSec;
+
+    Elf32_Phdr phdrs[2];
+    std::memset(phdrs, 0, sizeof(phdrs));
+    phdrs[0].p_type = PT_LOAD;
+    phdrs[0].p_offset = 0;
+    phdrs[0].p_vaddr = phdrs[0].p_paddr = kBaseAddr;
+    phdrs[0].p_filesz = phdrs[0].p_memsz =
+        m_sections[kTextSec].m_offset + m_sections[kTextSec].m_size;
+    phdrs[0].p_flags = PF_R | PF_X;
+    phdrs[0].p_align = kPageSize;
+    phdrs[1].p_type = PT_LOAD;
+    phdrs[1].p_offset = m_sections[kGotSec].m_offset;
+    phdrs[1].p_vaddr = phdrs[1].p_paddr = m_got_addr;
+    phdrs[1].p_filesz = phdrs[1].p_memsz = m_sections[kGotSec].m_size;
+    phdrs[1].p_flags = PF_R | PF_W;
+    phdrs[1].p_align = kPageSize;
+
+    if (fseeko(m_elf_file, 0, SEEK_SET) != 0) {
+        return false;
+    }
+    fwrite(&ehdr, sizeof(ehdr), 1, m_elf_file);
+    fwrite(phdrs, sizeof(phdrs), 1, m_elf_file);
+    return !ferror(m_elf_file);
+}
+
+bool Generator::generate() {
+    m_symtab_spool = tmpfile();
+    m_strtab_spool = tmpfile();
+    if (m_symtab_spool == nullptr || m_strtab_spool == nullptr) {
+        return false;
+    }
+    addString("");
+    m_mapping_names[static_cast<unsigned>(Kind::kArm)] = addString("$a");
+    m_mapping_names[static_cast<unsigned>(Kind::kThumb)] = addString("$t");
+    m_mapping_names[static_cast<unsigned>(Kind::kData)] = addString("$d");
+    addSymbol(0, 0, 0, SHN_UNDEF);
+    fprintf(m_labels_file, "# seed %llu\n",
+            static_cast<unsigned long long>(m_config.m_seed));
+
+    computeLayout();
+    writeDynamicSections();
+    generatePLT();
+    generateText();
+    bool result = writeTrailer();
+    fclose(m_symtab_spool);
+    fclose(m_strtab_spool);
+    return result && !ferror(m_labels_file);
+}
+}
+
+bool isValidConfig(const Config &config) {
+    return config.m_text_size >= kMinTextSize
+        && config.m_text_size <= kMaxTextSize
+        && config.m_import_count <= kMaxImportCount
+        && config.m_switch_percent + config.m_it_percent <= 100;
+}
+
+bool generateElf(const Config &config, FILE *elf_file, FILE *labels_file) {
+    Generator generator{config, elf_file, labels_file};
+    return generator.generate();
+}
+}
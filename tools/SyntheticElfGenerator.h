@@ -0,0 +1,50 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+namespace synthetic {
+
+// largest function including its literal pool in bytes
+const uint32_t kMaxFunctionSize = 4096;
+const uint64_t kMinTextSize = 4 * kMaxFunctionSize;
+// addresses and offsets of ELF32 are limited to 4GB
+const uint64_t kMaxTextSize = 0xe0000000ULL;
+const unsigned kMaxImportCount = 32;
+
+/*
+ * Defaults are the ones of synthetic-elf-gen.
+ */
+struct Config {
+    uint64_t m_seed = 1;
+    uint32_t m_text_size = 1 << 20;
+    unsigned m_arm_percent = 20;
+    unsigned m_data_percent = 10;
+    unsigned m_switch_percent = 3;
+    unsigned m_it_percent = 8;
+    unsigned m_import_count = 16;
+    bool m_strip = false;
+};
+
+/*
+ * Returns true if the text size is within limits and percentages add up.
+ */
+bool isValidConfig(const Config &config);
+
+/*
+ * Writes an ARM ELF file mixing ARM and Thumb-2 functions, IT blocks,
+ * literal pools, switch tables, PLT stubs, and data. Ground truth labels
+ * are written to labels_file. Output only depends on config, the same seed
+ * gives the same file on every platform. elf_file must be seekable.
+ * Returns false on write errors.
+ */
+bool generateElf(const Config &config, FILE *elf_file, FILE *labels_file);
+}
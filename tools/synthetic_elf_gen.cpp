@@ -0,0 +1,130 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+//
+// Command line driver of the synthetic ELF generator, see
+// SyntheticElfGenerator.h for what is generated.
+
+#include "SyntheticElfGenerator.h"
+#include <util/cmdline.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace synthetic;
+
+namespace {
+/*
+ * Parses sizes like 4096, 64K, 16M, or 2G.
+ */
+bool parseSize(const std::string &str, uint64_t &size) {
+    char *end;
+    size = std::strtoull(str.c_str(), &end, 10);
+    if (end == str.c_str()) {
+        return false;
+    }
+    switch (*end) {
+        case 'k':
+        case 'K':
+            size <<= 10;
+            ++end;
+            break;
+        case 'm':
+        case 'M':
+            size <<= 20;
+            ++end;
+            break;
+        case 'g':
+        case 'G':
+            size <<= 30;
+            ++end;
+            break;
+        default:
+            break;
+    }
+    return *end == '\0';
+}
+}
+
+int main(int argc, char **argv) {
+    cmdline::parser cmd_parser;
+    cmd_parser.add<std::string>("output", 'o', "Path of generated ELF file",
+                                true, "");
+    cmd_parser.add<std::string>("labels", 'l',
+                                "Path of ground truth labels, defaults to "
+                                    "output with .labels appended",
+                                false, "");
+    cmd_parser.add<std::string>("size", 'n',
+                                "Size of .text, e.g., 1M or 2G", false, "1M");
+    cmd_parser.add<unsigned long long>("seed", 's', "Random seed", false, 1);
+    cmd_parser.add<unsigned>("arm", 'a', "Percentage of ARM functions",
+                             false, 20);
+    cmd_parser.add<unsigned>("data", 'd',
+                             "Percentage of functions followed by data",
+                             false, 10);
+    cmd_parser.add<unsigned>("switch", 'w',
+                             "Percentage of items being switch tables",
+                             false, 3);
+    cmd_parser.add<unsigned>("it", 'i',
+                             "Percentage of items being IT blocks or "
+                                 "conditionally executed",
+                             false, 8);
+    cmd_parser.add<unsigned>("imports", 'p', "Number of PLT stubs", false, 16);
+    cmd_parser.add("strip", 'x', "Omit .symtab and mapping symbols");
+    cmd_parser.parse_check(argc, argv);
+
+    Config config;
+    config.m_seed = cmd_parser.get<unsigned long long>("seed");
+    config.m_arm_percent = cmd_parser.get<unsigned>("arm");
+    config.m_data_percent = cmd_parser.get<unsigned>("data");
+    config.m_switch_percent = cmd_parser.get<unsigned>("switch");
+    config.m_it_percent = cmd_parser.get<unsigned>("it");
+    config.m_import_count = std::min<unsigned>
+        (cmd_parser.get<unsigned>("imports"), kMaxImportCount);
+    config.m_strip = cmd_parser.exist("strip");
+    uint64_t text_size;
+    if (!parseSize(cmd_parser.get<std::string>("size"), text_size)
+        || text_size < kMinTextSize || text_size > kMaxTextSize) {
+        std::cerr << "invalid size or percentages\n";
+        return 2;
+    }
+    config.m_text_size = static_cast<uint32_t>(text_size & ~3ULL);
+    if (!isValidConfig(config)) {
+        std::cerr << "invalid size or percentages\n";
+        return 2;
+    }
+
+    auto output_path = cmd_parser.get<std::string>("output");
+    auto labels_path = cmd_parser.get<std::string>("labels");
+    if (labels_path.empty()) {
+        labels_path = output_path + ".labels";
+    }
+    FILE *elf_file = fopen(output_path.c_str(), "wb");
+    if (elf_file == nullptr) {
+        std::cerr << output_path << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+    FILE *labels_file = fopen(labels_path.c_str(), "w");
+    if (labels_file == nullptr) {
+        std::cerr << labels_path << ": " << strerror(errno) << "\n";
+        fclose(elf_file);
+        return 1;
+    }
+    bool written = generateElf(config, elf_file, labels_file);
+    written = (fclose(elf_file) == 0) && written;
+    written = (fclose(labels_file) == 0) && written;
+    if (!written) {
+        std::cerr << "failed to write " << output_path << "\n";
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// This file is distributed under BSD License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Copyright (c) 2016 University of Kaiserslautern.
+//
+// Compares two decision traces written by 'spedi --trace' and reports the
+// first diverging decision together with the decisions leading to it.
+// Exits with 0 if both traces are equal, 1 if they diverge, and 2 if a
+// trace can not be read.
+
+#include "disasm/DecisionTrace.h"
+#include <util/cmdline.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace disasm;
+
+namespace {
+
+void printRecord(const char *prefix,
+                 size_t index,
+                 const std::vector<TraceRecord> &records) {
+    if (index < records.size()) {
+        printf("%s #%zu %s\n", prefix, index,
+               DecisionTrace::describe(records[index]).c_str());
+    } else {
+        printf("%s #%zu <end of trace>\n", prefix, index);
+    }
+}
+}
+
+int main(int argc, char **argv) {
+    cmdline::parser cmd_parser;
+    cmd_parser.add<unsigned>("context", 'c',
+                             "Number of equal decisions shown before the "
+                                 "first diverging one",
+                             false, 3);
+    cmd_parser.footer("<expected trace> <actual trace>");
+    cmd_parser.parse_check(argc, argv);
+    if (cmd_parser.rest().size() != 2) {
+        std::fprintf(stderr, "%s", cmd_parser.usage().c_str());
+        return 2;
+    }
+    const auto &expected_path = cmd_parser.rest()[0];
+    const auto &actual_path = cmd_parser.rest()[1];
+    std::vector<TraceRecord> expected;
+    std::vector<TraceRecord> actual;
+    if (!DecisionTrace::read(expected_path, expected)) {
+        std::fprintf(stderr, "%s: not a readable decision trace\n",
+                     expected_path.c_str());
+        return 2;
+    }
+    if (!DecisionTrace::read(actual_path, actual)) {
+        std::fprintf(stderr, "%s: not a readable decision trace\n",
+                     actual_path.c_str());
+        return 2;
+    }
+    auto mismatch = std::mismatch
+        (expected.begin(),
+         expected.begin() + std::min(expected.size(), actual.size()),
+         actual.begin());
+    auto index = static_cast<size_t>(mismatch.first - expected.begin());
+    if (index == expected.size() && index == actual.size()) {
+        printf("traces are equal, %zu decisions\n", expected.size());
+        return 0;
+    }
+    printf("traces diverge at decision #%zu\n", index);
+    auto context = cmd_parser.get<unsigned>("context");
+    for (size_t i = index - std::min<size_t>(index, context); i < index; ++i) {
+        printRecord(" ", i, expected);
+    }
+    printRecord("-", index, expected);
+    printRecord("+", index, actual);
+    printf("expected %zu decisions, actual %zu\n",
+           expected.size(), actual.size());
+    return 1;
+}